@@ -4,9 +4,11 @@
 #include <linux/compiler.h>
 #include <linux/fs.h>
 #include <linux/gfp.h>
+#include <linux/hashtable.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/printk.h>
+#include <linux/rcupdate.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/version.h>
@@ -16,6 +18,8 @@
 #include "ksud.h"
 #include "selinux/selinux.h"
 #include "allowlist.h"
+#include "audit.h"
+#include "event_queue.h"
 #include "manager.h"
 #include "syscall_hook_manager.h"
 
@@ -81,19 +85,69 @@ static void init_default_profiles()
     default_non_root_profile.umount_modules = true;
 }
 
+// A root profile shared by name. Profiles whose rp_config.template_name
+// matches use it in place of their own copy, so updating the template
+// reaches every app at once. Entries are only freed on exit, su follows
+// p->template without a lock. The profile itself is replaced as a whole
+// under RCU, removing a template sets it to NULL.
+struct root_template {
+    struct list_head list;
+    char name[KSU_MAX_PACKAGE_NAME];
+    struct root_profile __rcu *profile;
+};
+
+static LIST_HEAD(root_templates);
+static DEFINE_MUTEX(root_template_mutex);
+
 struct perm_data {
     struct list_head list;
+    struct hlist_node node; // in allow_list_uid_table
+    struct root_template *template; // from rp_config.template_name, or NULL
     struct app_profile profile;
 };
 
 static struct list_head allow_list;
 
+// Profiles indexed by current_uid, so the per-uid lookups done on every
+// setuid do not walk the whole list. allow_list keeps the insertion order
+// for persisting and listing.
+#define ALLOW_LIST_HASH_BITS 8
+static DEFINE_HASHTABLE(allow_list_uid_table, ALLOW_LIST_HASH_BITS);
+
+static void allow_list_hash_add(struct perm_data *new)
+{
+    struct hlist_head *head = &allow_list_uid_table[hash_min(
+        new->profile.current_uid, ALLOW_LIST_HASH_BITS)];
+    struct hlist_node *last = NULL;
+    struct hlist_node *pos;
+
+    // keep bucket order equal to list order, uid lookups return the first
+    // profile added for a shared uid as the list walk did
+    hlist_for_each (pos, head)
+        last = pos;
+
+    if (last)
+        hlist_add_behind(&new->node, last);
+    else
+        hlist_add_head(&new->node, head);
+}
+
 static uint8_t allow_list_bitmap[PAGE_SIZE] __read_mostly __aligned(PAGE_SIZE);
 #define BITMAP_UID_MAX ((sizeof(allow_list_bitmap) * BITS_PER_BYTE) - 1)
 
 #define KERNEL_SU_ALLOWLIST "/data/adb/ksu/.allowlist"
+#define KERNEL_SU_ROOT_TEMPLATES "/data/adb/ksu/.root_templates"
+
+#define ROOT_TEMPLATE_FORMAT_VERSION 1 // u32
+
+// on disk, after magic and version
+struct root_template_record {
+    char name[KSU_MAX_PACKAGE_NAME];
+    struct root_profile profile;
+};
 
 void persistent_allow_list(void);
+static void persistent_root_templates(void);
 
 void ksu_show_allow_list(void)
 {
@@ -125,22 +179,17 @@ static void ksu_grant_root_to_shell()
 bool ksu_get_app_profile(struct app_profile *profile)
 {
     struct perm_data *p = NULL;
-    struct list_head *pos = NULL;
-    bool found = false;
 
-    list_for_each (pos, &allow_list) {
-        p = list_entry(pos, struct perm_data, list);
-        bool uid_match = profile->current_uid == p->profile.current_uid;
-        if (uid_match) {
+    hash_for_each_possible (allow_list_uid_table, p, node,
+                            profile->current_uid) {
+        if (profile->current_uid == p->profile.current_uid) {
             // found it, override it with ours
             memcpy(profile, &p->profile, sizeof(*profile));
-            found = true;
-            goto exit;
+            return true;
         }
     }
 
-exit:
-    return found;
+    return false;
 }
 
 static inline bool forbid_system_uid(uid_t uid)
@@ -150,6 +199,15 @@ static inline bool forbid_system_uid(uid_t uid)
     return uid < SHELL_UID && uid != SYSTEM_UID;
 }
 
+static bool root_profile_valid(const struct root_profile *profile)
+{
+    if (profile->groups_count < 0 || profile->groups_count > KSU_MAX_GROUPS) {
+        return false;
+    }
+
+    return strnlen(profile->selinux_domain, KSU_SELINUX_DOMAIN) != 0;
+}
+
 static bool profile_valid(struct app_profile *profile)
 {
     if (!profile) {
@@ -162,22 +220,156 @@ static bool profile_valid(struct app_profile *profile)
     }
 
     if (profile->allow_su) {
-        if (profile->rp_config.profile.groups_count > KSU_MAX_GROUPS) {
+        if (!root_profile_valid(&profile->rp_config.profile)) {
             return false;
         }
+    }
+
+    return true;
+}
+
+static struct root_template *find_root_template(const char *name)
+{
+    struct root_template *t;
+
+    if (!name[0]) {
+        return NULL;
+    }
+
+    list_for_each_entry (t, &root_templates, list) {
+        if (!strcmp(t->name, name)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void link_root_template(struct perm_data *p)
+{
+    struct root_template *t = NULL;
 
-        if (strlen(profile->rp_config.profile.selinux_domain) == 0) {
+    if (p->profile.allow_su) {
+        mutex_lock(&root_template_mutex);
+        t = find_root_template(p->profile.rp_config.template_name);
+        mutex_unlock(&root_template_mutex);
+    }
+    WRITE_ONCE(p->template, t);
+}
+
+bool ksu_set_root_template(const char *name,
+                           const struct root_profile *profile, bool persist)
+{
+    struct root_template *t;
+    struct root_profile *new, *old;
+    struct perm_data *p;
+    bool changed = true, rewritten = false;
+    size_t len = strnlen(name, KSU_MAX_PACKAGE_NAME);
+
+    if (len == 0 || len == KSU_MAX_PACKAGE_NAME ||
+        !root_profile_valid(profile)) {
+        pr_err("Failed to set root template: invalid template!\n");
+        return false;
+    }
+
+    new = kmemdup(profile, sizeof(*profile), GFP_KERNEL);
+    if (!new) {
+        pr_err("ksu_set_root_template alloc failed\n");
+        return false;
+    }
+
+    mutex_lock(&root_template_mutex);
+    t = find_root_template(name);
+    if (!t) {
+        t = kzalloc(sizeof(*t), GFP_KERNEL);
+        if (!t) {
+            mutex_unlock(&root_template_mutex);
+            kfree(new);
+            pr_err("ksu_set_root_template alloc failed\n");
             return false;
         }
+        memcpy(t->name, name, len + 1);
+        list_add_tail(&t->list, &root_templates);
+    }
+    old = rcu_dereference_protected(t->profile,
+                                    lockdep_is_held(&root_template_mutex));
+    if (old && !memcmp(old, new, sizeof(*new))) {
+        // the manager registers every template on load, skip the grace period
+        mutex_unlock(&root_template_mutex);
+        kfree(new);
+        old = NULL;
+        changed = false;
+    } else {
+        // su may be copying the old profile, never write it in place
+        rcu_assign_pointer(t->profile, new);
+        mutex_unlock(&root_template_mutex);
     }
 
+    // link the profiles that were set before the template, and keep their
+    // own copy equal to it for when the template is gone
+    mutex_lock(&allowlist_mutex);
+    list_for_each_entry (p, &allow_list, list) {
+        struct root_profile *copy = &p->profile.rp_config.profile;
+
+        if (!p->profile.allow_su ||
+            strcmp(p->profile.rp_config.template_name, name)) {
+            continue;
+        }
+        if (!READ_ONCE(p->template)) {
+            WRITE_ONCE(p->template, t);
+        }
+        if (memcmp(copy, profile, sizeof(*copy))) {
+            memcpy(copy, profile, sizeof(*copy));
+            rewritten = true;
+        }
+    }
+    mutex_unlock(&allowlist_mutex);
+
+    if (old) {
+        synchronize_rcu();
+        kfree(old);
+    }
+
+    // the manager re-registers every template on each load, only write
+    // back what actually changed
+    if (persist && changed) {
+        persistent_root_templates();
+    }
+    if (persist && rewritten) {
+        persistent_allow_list();
+    }
+
+    pr_info("set root template: %s, uid: %d, gid: %d, context: %s\n", name,
+            profile->uid, profile->gid, profile->selinux_domain);
+    return true;
+}
+
+bool ksu_remove_root_template(const char *name)
+{
+    struct root_template *t;
+    struct root_profile *old = NULL;
+
+    mutex_lock(&root_template_mutex);
+    t = find_root_template(name);
+    if (t) {
+        old = rcu_dereference_protected(
+            t->profile, lockdep_is_held(&root_template_mutex));
+        RCU_INIT_POINTER(t->profile, NULL);
+    }
+    mutex_unlock(&root_template_mutex);
+
+    if (!old) {
+        return false;
+    }
+
+    synchronize_rcu();
+    kfree(old);
+    persistent_root_templates();
     return true;
 }
 
 bool ksu_set_app_profile(struct app_profile *profile, bool persist)
 {
     struct perm_data *p = NULL;
-    struct list_head *pos = NULL;
     bool result = false;
 
     if (!profile_valid(profile)) {
@@ -185,13 +377,14 @@ bool ksu_set_app_profile(struct app_profile *profile, bool persist)
         return false;
     }
 
-    list_for_each (pos, &allow_list) {
-        p = list_entry(pos, struct perm_data, list);
+    hash_for_each_possible (allow_list_uid_table, p, node,
+                            profile->current_uid) {
         // both uid and package must match, otherwise it will break multiple package with different user id
         if (profile->current_uid == p->profile.current_uid &&
             !strcmp(profile->key, p->profile.key)) {
             // found it, just override it all!
             memcpy(&p->profile, profile, sizeof(*profile));
+            link_root_template(p);
             result = true;
             goto out;
         }
@@ -205,6 +398,7 @@ bool ksu_set_app_profile(struct app_profile *profile, bool persist)
     }
 
     memcpy(&p->profile, profile, sizeof(*profile));
+    link_root_template(p);
     if (profile->allow_su) {
         pr_info("set root profile, key: %s, uid: %d, gid: %d, context: %s\n",
                 profile->key, profile->current_uid,
@@ -216,6 +410,7 @@ bool ksu_set_app_profile(struct app_profile *profile, bool persist)
                 profile->nrp_config.profile.umount_modules);
     }
     list_add_tail(&p->list, &allow_list);
+    allow_list_hash_add(p);
 
 out:
     if (profile->current_uid <= BITMAP_UID_MAX) {
@@ -260,6 +455,9 @@ out:
         persistent_allow_list();
         // FIXME: use a new flag
         ksu_mark_running_process();
+        ksu_event_emit(KSU_EVENT_APP_PROFILE_CHANGED, profile->current_uid);
+        ksu_audit(KSU_AUDIT_PROFILE_CHANGED, profile->current_uid,
+                  profile->allow_su);
     }
 
     return result;
@@ -328,22 +526,28 @@ bool ksu_uid_should_umount(uid_t uid)
     }
 }
 
-struct root_profile *ksu_get_root_profile(uid_t uid)
+void ksu_get_root_profile(uid_t uid, struct root_profile *profile)
 {
+    const struct root_profile *src = &default_root_profile;
     struct perm_data *p = NULL;
-    struct list_head *pos = NULL;
 
-    list_for_each (pos, &allow_list) {
-        p = list_entry(pos, struct perm_data, list);
+    rcu_read_lock();
+    hash_for_each_possible (allow_list_uid_table, p, node, uid) {
         if (uid == p->profile.current_uid && p->profile.allow_su) {
             if (!p->profile.rp_config.use_default) {
-                return &p->profile.rp_config.profile;
+                struct root_template *t = READ_ONCE(p->template);
+                const struct root_profile *shared =
+                    t ? rcu_dereference(t->profile) : NULL;
+
+                src = shared ? shared : &p->profile.rp_config.profile;
+                break;
             }
         }
     }
 
-    // use default profile
-    return &default_root_profile;
+    // copied out, the template may be replaced once we leave the section
+    memcpy(profile, src, sizeof(*profile));
+    rcu_read_unlock();
 }
 
 bool ksu_get_allow_list(int *array, int *length, bool allow)
@@ -405,29 +609,132 @@ unlock:
     kfree(_cb);
 }
 
-void persistent_allow_list()
+// run func in init's context, where the files under /data can be written
+static void queue_persist_work(task_work_func_t func)
 {
     struct task_struct *tsk;
 
     tsk = get_pid_task(find_vpid(1), PIDTYPE_PID);
     if (!tsk) {
-        pr_err("save_allow_list find init task err\n");
+        pr_err("persist: find init task err\n");
         return;
     }
 
     struct callback_head *cb =
         kzalloc(sizeof(struct callback_head), GFP_KERNEL);
     if (!cb) {
-        pr_err("save_allow_list alloc cb err\b");
+        pr_err("persist: alloc cb err\n");
         goto put_task;
     }
-    cb->func = do_persistent_allow_list;
+    cb->func = func;
     task_work_add(tsk, cb, TWA_RESUME);
 
 put_task:
     put_task_struct(tsk);
 }
 
+void persistent_allow_list()
+{
+    queue_persist_work(do_persistent_allow_list);
+}
+
+static void do_persistent_root_templates(struct callback_head *_cb)
+{
+    u32 magic = FILE_MAGIC;
+    u32 version = ROOT_TEMPLATE_FORMAT_VERSION;
+    struct root_template_record *record;
+    struct root_template *t;
+    loff_t off = 0;
+
+    record = kmalloc(sizeof(*record), GFP_KERNEL);
+    if (!record) {
+        pr_err("save_root_templates alloc failed\n");
+        kfree(_cb);
+        return;
+    }
+
+    mutex_lock(&root_template_mutex);
+    struct file *fp = filp_open(KERNEL_SU_ROOT_TEMPLATES,
+                                O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (IS_ERR(fp)) {
+        pr_err("save_root_templates create file failed: %ld\n", PTR_ERR(fp));
+        goto unlock;
+    }
+
+    if (kernel_write(fp, &magic, sizeof(magic), &off) != sizeof(magic) ||
+        kernel_write(fp, &version, sizeof(version), &off) != sizeof(version)) {
+        pr_err("save_root_templates write header failed.\n");
+        goto close_file;
+    }
+
+    list_for_each_entry (t, &root_templates, list) {
+        struct root_profile *profile = rcu_dereference_protected(
+            t->profile, lockdep_is_held(&root_template_mutex));
+
+        // removed templates are not written, so they stay gone after reboot
+        if (!profile) {
+            continue;
+        }
+        memcpy(record->name, t->name, sizeof(record->name));
+        memcpy(&record->profile, profile, sizeof(record->profile));
+        if (kernel_write(fp, record, sizeof(*record), &off) !=
+            sizeof(*record)) {
+            pr_err("save_root_templates write %s failed.\n", t->name);
+            break;
+        }
+    }
+
+close_file:
+    filp_close(fp, 0);
+unlock:
+    mutex_unlock(&root_template_mutex);
+    kfree(record);
+    kfree(_cb);
+}
+
+static void persistent_root_templates(void)
+{
+    queue_persist_work(do_persistent_root_templates);
+}
+
+// Load the templates before the app profiles, so these link on set
+static void load_root_templates(void)
+{
+    struct root_template_record *record;
+    loff_t off = 0;
+    struct file *fp;
+    u32 magic;
+    u32 version;
+
+    fp = filp_open(KERNEL_SU_ROOT_TEMPLATES, O_RDONLY, 0);
+    if (IS_ERR(fp)) {
+        pr_info("load_root_templates open file failed: %ld\n", PTR_ERR(fp));
+        return;
+    }
+
+    if (kernel_read(fp, &magic, sizeof(magic), &off) != sizeof(magic) ||
+        magic != FILE_MAGIC ||
+        kernel_read(fp, &version, sizeof(version), &off) != sizeof(version) ||
+        version != ROOT_TEMPLATE_FORMAT_VERSION) {
+        pr_err("root templates file invalid!\n");
+        goto close_file;
+    }
+
+    record = kmalloc(sizeof(*record), GFP_KERNEL);
+    if (!record) {
+        goto close_file;
+    }
+
+    while (kernel_read(fp, record, sizeof(*record), &off) == sizeof(*record)) {
+        record->name[sizeof(record->name) - 1] = '\0';
+        ksu_set_root_template(record->name, &record->profile, false);
+    }
+    kfree(record);
+
+close_file:
+    filp_close(fp, 0);
+}
+
 void ksu_load_allow_list()
 {
     loff_t off = 0;
@@ -441,6 +748,8 @@ void ksu_load_allow_list()
     ksu_grant_root_to_shell();
 #endif
 
+    load_root_templates();
+
     // load allowlist now!
     fp = filp_open(KERNEL_SU_ALLOWLIST, O_RDONLY, 0);
     if (IS_ERR(fp)) {
@@ -493,7 +802,7 @@ void ksu_prune_allowlist(bool (*is_uid_valid)(uid_t, char *, void *),
         return;
     }
 
-    bool modified = false;
+    u32 pruned = 0;
     // TODO: use RCU!
     mutex_lock(&allowlist_mutex);
     list_for_each_entry_safe (np, n, &allow_list, list) {
@@ -502,9 +811,10 @@ void ksu_prune_allowlist(bool (*is_uid_valid)(uid_t, char *, void *),
         // we use this uid for special cases, don't prune it!
         bool is_preserved_uid = uid == KSU_APP_PROFILE_PRESERVE_UID;
         if (!is_preserved_uid && !is_uid_valid(uid, package, data)) {
-            modified = true;
+            pruned++;
             pr_info("prune uid: %d, package: %s\n", uid, package);
             list_del(&np->list);
+            hash_del(&np->node);
             if (likely(uid <= BITMAP_UID_MAX)) {
                 allow_list_bitmap[uid / BITS_PER_BYTE] &=
                     ~(1 << (uid % BITS_PER_BYTE));
@@ -516,8 +826,9 @@ void ksu_prune_allowlist(bool (*is_uid_valid)(uid_t, char *, void *),
     }
     mutex_unlock(&allowlist_mutex);
 
-    if (modified) {
+    if (pruned) {
         persistent_allow_list();
+        ksu_event_emit(KSU_EVENT_ALLOWLIST_PRUNED, pruned);
     }
 }
 
@@ -540,12 +851,27 @@ void ksu_allowlist_exit(void)
 {
     struct perm_data *np = NULL;
     struct perm_data *n = NULL;
+    struct root_template *t, *nt;
 
     // free allowlist
     mutex_lock(&allowlist_mutex);
     list_for_each_entry_safe (np, n, &allow_list, list) {
         list_del(&np->list);
+        hash_del(&np->node);
         kfree(np);
     }
     mutex_unlock(&allowlist_mutex);
+
+    mutex_lock(&root_template_mutex);
+    list_for_each_entry_safe (t, nt, &root_templates, list) {
+        list_del(&t->list);
+        kfree(rcu_dereference_protected(
+            t->profile, lockdep_is_held(&root_template_mutex)));
+        kfree(t);
+    }
+    mutex_unlock(&root_template_mutex);
 }
+
+#ifdef CONFIG_KSU_KUNIT_TEST
+#include "tests/allowlist_test.c"
+#endif
@@ -34,8 +34,14 @@ void ksu_prune_allowlist(bool (*is_uid_exist)(uid_t, char *, void *), void *data
 bool ksu_get_app_profile(struct app_profile *);
 bool ksu_set_app_profile(struct app_profile *, bool persist);
 
+// Shared root profiles, referenced by rp_config.template_name
+bool ksu_set_root_template(const char *name, const struct root_profile *profile,
+                           bool persist);
+bool ksu_remove_root_template(const char *name);
+
 bool ksu_uid_should_umount(uid_t uid);
-struct root_profile *ksu_get_root_profile(uid_t uid);
+// Copies the root profile su grants to uid
+void ksu_get_root_profile(uid_t uid, struct root_profile *profile);
 
 static inline bool is_appuid(uid_t uid)
 {
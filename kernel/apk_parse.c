@@ -0,0 +1,130 @@
+#include <linux/kernel.h>
+#include <linux/printk.h>
+#include <linux/string.h>
+#include <linux/types.h>
+
+#include "apk_parse.h"
+#include "klog.h" // IWYU pragma: keep
+
+#define SIG_BLOCK_MAX_PAIRS 10
+
+#define APK_SIGNATURE_SCHEME_V2_BLOCK_ID 0x7109871au
+// http://aospxref.com/android-14.0.0_r2/xref/frameworks/base/core/java/android/util/apk/ApkSignatureSchemeV3Verifier.java#73
+#define APK_SIGNATURE_SCHEME_V3_BLOCK_ID 0xf05368c0u
+// http://aospxref.com/android-14.0.0_r2/xref/frameworks/base/core/java/android/util/apk/ApkSignatureSchemeV3Verifier.java#74
+#define APK_SIGNATURE_SCHEME_V3_1_BLOCK_ID 0x1b93ad61u
+
+// Every length read from the APK is checked against the buffer before it
+// is used.
+
+// https://en.wikipedia.org/wiki/Zip_(file_format)#End_of_central_directory_record_(EOCD)
+long find_eocd(const u8 *tail, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i <= EOCD_MAX_COMMENT && i + EOCD_SIZE <= len; i++) {
+        const u8 *eocd = tail + len - i - EOCD_SIZE;
+        if (load_u16(eocd + 20) == i && load_u32(eocd) == EOCD_MAGIC)
+            return eocd - tail;
+    }
+    return -1;
+}
+
+// Walk the v2 signer of a signature scheme v2 block value:
+// signers, signer, signed data, digests (skipped), certificates, certificate
+static bool parse_v2_block(const u8 *p, u64 len, struct apk_sig_info *info)
+{
+    u64 off = 0;
+    u32 size;
+
+    // signer-sequence length, signer length, signed data length
+    if (len < 0x4 * 4)
+        return false;
+    off += 0x4 * 3;
+
+    size = load_u32(p + off); // digests-sequence length
+    off += 0x4;
+    if (size > len - off)
+        return false;
+    off += size;
+
+    if (len - off < 0x4 * 2)
+        return false;
+    off += 0x4; // certificates length
+    size = load_u32(p + off); // certificate length
+    off += 0x4;
+    if (size > len - off)
+        return false;
+
+    info->cert = p + off;
+    info->cert_size = size;
+    return true;
+}
+
+bool parse_signing_block(const u8 *blk, u64 len, struct apk_sig_info *info)
+{
+    u64 size_of_block, off = 8, end;
+    int pairs = 0;
+
+    memset(info, 0, sizeof(*info));
+    if (len < 8 + 24)
+        return false;
+
+    size_of_block = load_u64(blk);
+    if (size_of_block != len - 8 || load_u64(blk + len - 24) != size_of_block)
+        return false;
+    end = len - 24;
+
+    while (pairs++ < SIG_BLOCK_MAX_PAIRS && end - off >= 8) {
+        u64 pair_len = load_u64(blk + off); // sequence length
+        u32 id;
+
+        off += 8;
+        if (pair_len < 4 || pair_len > end - off)
+            break;
+
+        id = load_u32(blk + off);
+        if (id == APK_SIGNATURE_SCHEME_V2_BLOCK_ID) {
+            info->v2_blocks++;
+            info->cert = NULL;
+            info->cert_size = 0;
+            parse_v2_block(blk + off + 4, pair_len - 4, info);
+        } else if (id == APK_SIGNATURE_SCHEME_V3_BLOCK_ID ||
+                   id == APK_SIGNATURE_SCHEME_V3_1_BLOCK_ID) {
+            info->v3_exist = true;
+        } else {
+#ifdef CONFIG_KSU_DEBUG
+            pr_info("Unknown id: 0x%08x\n", id);
+#endif
+        }
+        off += pair_len;
+    }
+
+    return true;
+}
+
+bool check_cert(const u8 *cert, u32 size, unsigned expected_size,
+                const char *expected_sha256)
+{
+#define CERT_MAX_LENGTH 1024
+    unsigned char digest[APK_SHA256_SIZE];
+    char hash_str[APK_SHA256_SIZE * 2 + 1];
+
+    if (!cert || size != expected_size)
+        return false;
+
+    if (size > CERT_MAX_LENGTH) {
+        pr_info("cert length overlimit\n");
+        return false;
+    }
+
+    if (ksu_sha256(cert, size, digest)) {
+        pr_info("sha256 error\n");
+        return false;
+    }
+
+    hash_str[APK_SHA256_SIZE * 2] = '\0';
+    bin2hex(hash_str, digest, APK_SHA256_SIZE);
+    pr_info("sha256: %s, expected: %s\n", hash_str, expected_sha256);
+    return strcmp(expected_sha256, hash_str) == 0;
+}
@@ -0,0 +1,66 @@
+#ifndef __KSU_H_APK_PARSE
+#define __KSU_H_APK_PARSE
+
+#include <linux/string.h>
+#include <linux/types.h>
+
+/*
+ * Parsers for the parts of an APK that is_manager_apk looks at. They only
+ * read the buffers they are given and build in userspace as well, see
+ * tests/apk_parse.
+ */
+
+#define APK_SIG_BLOCK_MAGIC "APK Sig Block 42"
+#define EOCD_MAGIC 0x06054b50u
+#define EOCD_SIZE 22
+#define EOCD_MAX_COMMENT 0xffff
+#define SIG_BLOCK_MAX_SIZE (1 << 20)
+
+#define APK_SHA256_SIZE 32
+
+// What the signing block says, see parse_signing_block
+struct apk_sig_info {
+    int v2_blocks;
+    bool v3_exist;
+    const u8 *cert; // first certificate of the last v2 signer, in the block
+    u32 cert_size;
+};
+
+static inline u16 load_u16(const u8 *p)
+{
+    u16 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u32 load_u32(const u8 *p)
+{
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u64 load_u64(const u8 *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Offset of the end of central directory record in the last len bytes of
+// the file, or -1
+long find_eocd(const u8 *tail, size_t len);
+
+// Parse the APK signing block, blk holds the whole block including the
+// leading size field and the trailing size and magic
+bool parse_signing_block(const u8 *blk, u64 len, struct apk_sig_info *info);
+
+// Whether cert has the expected size and sha256, given as lowercase hex
+bool check_cert(const u8 *cert, u32 size, unsigned expected_size,
+                const char *expected_sha256);
+
+// Provided by the caller of check_cert, 0 on success
+int ksu_sha256(const unsigned char *data, unsigned int datalen,
+               unsigned char *digest);
+
+#endif
@@ -2,7 +2,9 @@
 #include <linux/fs.h>
 #include <linux/gfp.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/string.h>
 #include <linux/version.h>
 #ifdef CONFIG_KSU_DEBUG
 #include <linux/moduleparam.h>
@@ -14,6 +16,7 @@
 #include <crypto/sha.h>
 #endif
 
+#include "apk_parse.h"
 #include "apk_sign.h"
 #include "klog.h" // IWYU pragma: keep
 
@@ -52,13 +55,14 @@ static int calc_hash(struct crypto_shash *alg, const unsigned char *data,
     return ret;
 }
 
-static int ksu_sha256(const unsigned char *data, unsigned int datalen,
-              unsigned char *digest)
+int ksu_sha256(const unsigned char *data, unsigned int datalen,
+               unsigned char *digest)
 {
     struct crypto_shash *alg;
     char *hash_alg_name = "sha256";
     int ret;
 
+    BUILD_BUG_ON(APK_SHA256_SIZE != SHA256_DIGEST_SIZE);
     alg = crypto_alloc_shash(hash_alg_name, 0, 0);
     if (IS_ERR(alg)) {
         pr_info("can't alloc alg %s\n", hash_alg_name);
@@ -69,51 +73,46 @@ static int ksu_sha256(const unsigned char *data, unsigned int datalen,
     return ret;
 }
 
-static bool check_block(struct file *fp, u32 *size4, loff_t *pos, u32 *offset,
-            unsigned expected_size, const char *expected_sha256)
-{
-    kernel_read(fp, size4, 0x4, pos); // signer-sequence length
-    kernel_read(fp, size4, 0x4, pos); // signer length
-    kernel_read(fp, size4, 0x4, pos); // signed data length
-
-    *offset += 0x4 * 3;
+// most APKs carry no zip comment, try a small tail before the full range
+#define EOCD_QUICK_TAIL 4096
 
-    kernel_read(fp, size4, 0x4, pos); // digests-sequence length
+static bool read_exact(struct file *fp, void *buf, size_t len, loff_t pos)
+{
+    return kernel_read(fp, buf, len, &pos) == len;
+}
 
-    *pos += *size4;
-    *offset += 0x4 + *size4;
+// Read the central directory offset from the EOCD, with one read for
+// APKs without a zip comment and one more for the rest.
+static bool read_cd_offset(struct file *fp, loff_t file_size, u32 *cd_offset)
+{
+    size_t max_len = min_t(loff_t, file_size, EOCD_MAX_COMMENT + EOCD_SIZE);
+    size_t len = min_t(size_t, max_len, EOCD_QUICK_TAIL);
+    long eocd = -1;
+    u8 *tail;
 
-    kernel_read(fp, size4, 0x4, pos); // certificates length
-    kernel_read(fp, size4, 0x4, pos); // certificate length
-    *offset += 0x4 * 2;
+    if (file_size < EOCD_SIZE)
+        return false;
 
-    if (*size4 == expected_size) {
-        *offset += *size4;
+    tail = kvmalloc(max_len, GFP_KERNEL);
+    if (!tail)
+        return false;
 
-#define CERT_MAX_LENGTH 1024
-        char cert[CERT_MAX_LENGTH];
-        if (*size4 > CERT_MAX_LENGTH) {
-            pr_info("cert length overlimit\n");
-            return false;
-        }
-        kernel_read(fp, cert, *size4, pos);
-        unsigned char digest[SHA256_DIGEST_SIZE];
-        if (IS_ERR(ksu_sha256(cert, *size4, digest))) {
-            pr_info("sha256 error\n");
-            return false;
-        }
+    while (read_exact(fp, tail, len, file_size - len)) {
+        eocd = find_eocd(tail, len);
+        if (eocd >= 0 || len == max_len)
+            break;
+        len = max_len;
+    }
 
-        char hash_str[SHA256_DIGEST_SIZE * 2 + 1];
-        hash_str[SHA256_DIGEST_SIZE * 2] = '\0';
+    if (eocd >= 0)
+        *cd_offset = load_u32(tail + eocd + 16);
+    kvfree(tail);
 
-        bin2hex(hash_str, digest, SHA256_DIGEST_SIZE);
-        pr_info("sha256: %s, expected: %s\n", hash_str,
-            expected_sha256);
-        if (strcmp(expected_sha256, hash_str) == 0) {
-            return true;
-        }
+    if (eocd < 0) {
+        pr_info("error: cannot find eocd\n");
+        return false;
     }
-    return false;
+    return true;
 }
 
 struct zip_entry_header {
@@ -148,8 +147,10 @@ static bool has_v1_signature_file(struct file *fp)
         // Read the entry file name
         if (header.file_name_length == sizeof(MANIFEST) - 1) {
             char fileName[sizeof(MANIFEST)];
-            kernel_read(fp, fileName,
-                           header.file_name_length, &pos);
+            if (kernel_read(fp, fileName, header.file_name_length, &pos) !=
+                header.file_name_length) {
+                return false;
+            }
             fileName[header.file_name_length] = '\0';
 
             // Check if the entry matches META-INF/MANIFEST.MF
@@ -173,18 +174,13 @@ static __always_inline bool check_v2_signature(char *path,
                            unsigned expected_size,
                            const char *expected_sha256)
 {
-    unsigned char buffer[0x11] = { 0 };
-    u32 size4;
-    u64 size8, size_of_block;
-
-    loff_t pos;
-
+    struct apk_sig_info info;
+    u8 footer[24];
+    u64 block_size;
+    u32 cd_offset;
+    u8 *blk = NULL;
     bool v2_signing_valid = false;
-    int v2_signing_blocks = 0;
-    bool v3_signing_exist = false;
-    bool v3_1_signing_exist = false;
 
-    int i;
     struct file *fp = filp_open(path, O_RDONLY, 0);
     if (IS_ERR(fp)) {
         pr_err("open %s error.\n", path);
@@ -194,97 +190,50 @@ static __always_inline bool check_v2_signature(char *path,
     // disable inotify for this file
     fp->f_mode |= FMODE_NONOTIFY;
 
-    // https://en.wikipedia.org/wiki/Zip_(file_format)#End_of_central_directory_record_(EOCD)
-    for (i = 0;; ++i) {
-        unsigned short n;
-        pos = generic_file_llseek(fp, -i - 2, SEEK_END);
-        kernel_read(fp, &n, 2, &pos);
-        if (n == i) {
-            pos -= 22;
-            kernel_read(fp, &size4, 4, &pos);
-            if ((size4 ^ 0xcafebabeu) == 0xccfbf1eeu) {
-                break;
-            }
-        }
-        if (i == 0xffff) {
-            pr_info("error: cannot find eocd\n");
-            goto clean;
-        }
-    }
+    if (!read_cd_offset(fp, i_size_read(file_inode(fp)), &cd_offset))
+        goto clean;
 
-    pos += 12;
-    // offset
-    kernel_read(fp, &size4, 0x4, &pos);
-    pos = size4 - 0x18;
+    // the signing block sits right before the central directory and ends
+    // with its size and magic
+    if (cd_offset < sizeof(footer) ||
+        !read_exact(fp, footer, sizeof(footer), cd_offset - sizeof(footer)) ||
+        memcmp(footer + 8, APK_SIG_BLOCK_MAGIC, 16))
+        goto clean;
 
-    kernel_read(fp, &size8, 0x8, &pos);
-    kernel_read(fp, buffer, 0x10, &pos);
-    if (strcmp((char *)buffer, "APK Sig Block 42")) {
+    block_size = load_u64(footer) + 8;
+    if (block_size > cd_offset || block_size > SIG_BLOCK_MAX_SIZE)
         goto clean;
-    }
 
-    pos = size4 - (size8 + 0x8);
-    kernel_read(fp, &size_of_block, 0x8, &pos);
-    if (size_of_block != size8) {
+    blk = kvmalloc(block_size, GFP_KERNEL);
+    if (!blk || !read_exact(fp, blk, block_size, cd_offset - block_size) ||
+        !parse_signing_block(blk, block_size, &info))
         goto clean;
-    }
 
-    int loop_count = 0;
-    while (loop_count++ < 10) {
-        uint32_t id;
-        uint32_t offset;
-        kernel_read(fp, &size8, 0x8,
-                       &pos); // sequence length
-        if (size8 == size_of_block) {
-            break;
-        }
-        kernel_read(fp, &id, 0x4, &pos); // id
-        offset = 4;
-        if (id == 0x7109871au) {
-            v2_signing_blocks++;
-            v2_signing_valid =
-                check_block(fp, &size4, &pos, &offset,
-                        expected_size, expected_sha256);
-        } else if (id == 0xf05368c0u) {
-            // http://aospxref.com/android-14.0.0_r2/xref/frameworks/base/core/java/android/util/apk/ApkSignatureSchemeV3Verifier.java#73
-            v3_signing_exist = true;
-        } else if (id == 0x1b93ad61u) {
-            // http://aospxref.com/android-14.0.0_r2/xref/frameworks/base/core/java/android/util/apk/ApkSignatureSchemeV3Verifier.java#74
-            v3_1_signing_exist = true;
-        } else {
+    if (info.v3_exist) {
 #ifdef CONFIG_KSU_DEBUG
-            pr_info("Unknown id: 0x%08x\n", id);
+        pr_err("Unexpected v3 signature scheme found!\n");
 #endif
-        }
-        pos += (size8 - offset);
+        goto clean;
     }
 
-    if (v2_signing_blocks != 1) {
+    if (info.v2_blocks != 1) {
 #ifdef CONFIG_KSU_DEBUG
-        pr_err("Unexpected v2 signature count: %d\n",
-               v2_signing_blocks);
+        pr_err("Unexpected v2 signature count: %d\n", info.v2_blocks);
 #endif
-        v2_signing_valid = false;
+        goto clean;
     }
 
-    if (v2_signing_valid) {
-        int has_v1_signing = has_v1_signature_file(fp);
-        if (has_v1_signing) {
-            pr_err("Unexpected v1 signature scheme found!\n");
-            filp_close(fp, 0);
-            return false;
-        }
-    }
-clean:
-    filp_close(fp, 0);
+    v2_signing_valid =
+        check_cert(info.cert, info.cert_size, expected_size, expected_sha256);
 
-    if (v3_signing_exist || v3_1_signing_exist) {
-#ifdef CONFIG_KSU_DEBUG
-        pr_err("Unexpected v3 signature scheme found!\n");
-#endif
-        return false;
+    if (v2_signing_valid && has_v1_signature_file(fp)) {
+        pr_err("Unexpected v1 signature scheme found!\n");
+        v2_signing_valid = false;
     }
 
+clean:
+    kvfree(blk);
+    filp_close(fp, 0);
     return v2_signing_valid;
 }
 
@@ -9,6 +9,7 @@
 
 #include "allowlist.h"
 #include "app_profile.h"
+#include "audit.h"
 #include "klog.h" // IWYU pragma: keep
 #include "selinux/selinux.h"
 #include "syscall_hook_manager.h"
@@ -91,7 +92,11 @@ void escape_with_root_profile(void)
 		return;
 	}
 
-	struct root_profile *profile = ksu_get_root_profile(cred->uid.val);
+	uid_t caller = cred->uid.val;
+	struct root_profile root_profile;
+	struct root_profile *profile = &root_profile;
+
+	ksu_get_root_profile(caller, profile);
 
 	cred->uid.val = profile->uid;
 	cred->suid.val = profile->uid;
@@ -129,6 +134,8 @@ void escape_with_root_profile(void)
 
 	setup_selinux(profile->selinux_domain);
 
+	ksu_audit(KSU_AUDIT_SU_GRANT, caller, profile->uid);
+
 	for_each_thread (p, t) {
 		ksu_set_task_tracepoint_flag(t);
 	}
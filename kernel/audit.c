@@ -0,0 +1,135 @@
+#include <linux/anon_inodes.h>
+#include <linux/cred.h>
+#include <linux/fcntl.h>
+#include <linux/fs.h>
+#include <linux/irqflags.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/version.h>
+#include <linux/vmalloc.h>
+
+#include "audit.h"
+#include "klog.h" // IWYU pragma: keep
+
+/*
+ * su audit log. Each cpu writes its own ring with interrupts off, so the
+ * writer takes no lock and never waits for a reader. The rings live in one
+ * vmalloc_user area that readers map read-only and walk by seq, without a
+ * syscall per record. A slot's seq is cleared before it is rewritten and
+ * set again afterwards, a reader that sees seq change while copying a
+ * record drops it as overwritten.
+ */
+#define KSU_AUDIT_RECORDS 256
+
+static void *audit_area;
+static size_t audit_cpu_size;
+
+static struct ksu_audit_header *audit_header(void *area, int cpu)
+{
+    return area + cpu * audit_cpu_size;
+}
+
+void ksu_audit(u32 type, uid_t uid, u32 data)
+{
+    struct ksu_audit_header *hdr;
+    struct ksu_audit_record *rec;
+    unsigned long flags;
+    void *area;
+    u64 seq;
+
+    // irqs off also keeps ksu_audit_exit from freeing the area under us
+    local_irq_save(flags);
+    area = READ_ONCE(audit_area);
+    if (unlikely(!area))
+        goto out;
+
+    hdr = audit_header(area, smp_processor_id());
+    seq = hdr->head + 1;
+    rec = (void *)hdr + KSU_AUDIT_HEADER_SIZE +
+          ((seq - 1) & (KSU_AUDIT_RECORDS - 1)) * sizeof(*rec);
+
+    WRITE_ONCE(rec->seq, 0);
+    smp_wmb();
+    rec->timestamp = ktime_get_boottime_ns();
+    rec->type = type;
+    rec->uid = uid;
+    rec->pid = task_tgid_nr(current);
+    rec->data = data;
+    get_task_comm(rec->comm, current);
+    smp_wmb();
+    WRITE_ONCE(rec->seq, seq);
+    smp_store_release(&hdr->head, seq);
+out:
+    local_irq_restore(flags);
+}
+
+u32 ksu_audit_cpu_size(void)
+{
+    return audit_cpu_size;
+}
+
+static int audit_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    return remap_vmalloc_range(vma, audit_area, vma->vm_pgoff);
+}
+
+static const struct file_operations audit_fops = {
+    .owner = THIS_MODULE,
+    .mmap = audit_mmap,
+};
+
+int ksu_audit_install_fd(void)
+{
+    if (!audit_area)
+        return -ENOMEM;
+
+    return anon_inode_getfd("[ksu_audit]", &audit_fops, NULL,
+                            O_RDONLY | O_CLOEXEC);
+}
+
+void ksu_audit_init(void)
+{
+    struct ksu_audit_header *hdr;
+    int cpu;
+
+    BUILD_BUG_ON(!is_power_of_2(KSU_AUDIT_RECORDS));
+    BUILD_BUG_ON(sizeof(struct ksu_audit_header) > KSU_AUDIT_HEADER_SIZE);
+
+    audit_cpu_size = PAGE_ALIGN(KSU_AUDIT_HEADER_SIZE +
+                                KSU_AUDIT_RECORDS *
+                                    sizeof(struct ksu_audit_record));
+    audit_area = vmalloc_user(nr_cpu_ids * audit_cpu_size);
+    if (!audit_area) {
+        pr_err("audit: alloc failed, su audit log disabled\n");
+        return;
+    }
+
+    for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+        hdr = audit_header(audit_area, cpu);
+        hdr->records = KSU_AUDIT_RECORDS;
+        hdr->record_size = sizeof(struct ksu_audit_record);
+    }
+}
+
+void ksu_audit_exit(void)
+{
+    void *area = audit_area;
+
+    // open mappings hold their own page references
+    WRITE_ONCE(audit_area, NULL);
+    synchronize_rcu();
+    vfree(area);
+}
@@ -0,0 +1,57 @@
+#ifndef __KSU_H_AUDIT
+#define __KSU_H_AUDIT
+
+#include <linux/types.h>
+
+/*
+ * Shared with the reader through mmap. Every cpu owns an area of
+ * cpu_size bytes: a header, then `records` slots starting at
+ * KSU_AUDIT_HEADER_SIZE.
+ */
+struct ksu_audit_header {
+    __u64 head; // seq of the newest record on this cpu, 0 when empty
+    __u32 records; // number of slots, a power of two
+    __u32 record_size;
+};
+
+#define KSU_AUDIT_HEADER_SIZE 64
+
+struct ksu_audit_record {
+    __u64 seq; // Slot (seq - 1) % records, written last, 0 while it is rewritten
+    __u64 timestamp; // Boot time in ns
+    __u32 type; // KSU_AUDIT_*
+    __u32 uid; // uid the record is about, see the types
+    __u32 pid; // tgid of the current task
+    __u32 data; // Type specific payload
+    char comm[16];
+};
+
+#define KSU_AUDIT_SU_GRANT 1 // uid: caller, data: uid of the root profile
+#define KSU_AUDIT_SU_DENY 2 // uid: caller, data: KSU_AUDIT_VIA_*
+// Only real unmounts are recorded, a record per kept decision would push
+// the su records out of the rings on every app launch
+#define KSU_AUDIT_UMOUNT 3 // uid: new app uid, data: 1 unmounted
+#define KSU_AUDIT_PROFILE_CHANGED 4 // uid: profile uid, data: allow_su
+
+/*
+ * su exec by a uid that is not allowed. Only execve calls that reach the
+ * sucompat hook are seen: with the sys_enter tracepoint that is marked
+ * tasks only, and disallowed apps are not marked, so most such denials go
+ * unrecorded. With CONFIG_KSU_SYSCALL_KPROBES every task's execve is
+ * hooked and every denial is recorded.
+ */
+#define KSU_AUDIT_VIA_EXECVE 0
+#define KSU_AUDIT_VIA_IOCTL 1 // KSU_IOCTL_GRANT_ROOT failed the permission check
+
+void ksu_audit(u32 type, uid_t uid, u32 data);
+
+// Geometry of the mapping returned by ksu_audit_install_fd
+u32 ksu_audit_cpu_size(void);
+
+int ksu_audit_install_fd(void);
+
+void ksu_audit_init(void);
+
+void ksu_audit_exit(void);
+
+#endif // __KSU_H_AUDIT
@@ -0,0 +1,107 @@
+#include <linux/anon_inodes.h>
+#include <linux/fcntl.h>
+#include <linux/fs.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+#include "event_queue.h"
+#include "klog.h" // IWYU pragma: keep
+
+/*
+ * Events are kept in a small ring indexed by sequence number. Every event
+ * fd keeps its own cursor in f_pos (the last sequence it has read), so
+ * readers need no per-fd state and a fresh fd replays what is still in the
+ * ring. A reader that falls more than KSU_EVENT_RING_SIZE events behind
+ * skips to the oldest one still buffered and sees the gap in seq.
+ */
+#define KSU_EVENT_RING_SIZE 64
+
+static struct ksu_event event_ring[KSU_EVENT_RING_SIZE];
+static u64 event_head; // seq of the newest event, 0 when empty
+static DEFINE_SPINLOCK(event_lock);
+static DECLARE_WAIT_QUEUE_HEAD(event_wq);
+
+void ksu_event_emit(u32 type, u32 data)
+{
+    struct ksu_event *ev;
+    unsigned long flags;
+
+    spin_lock_irqsave(&event_lock, flags);
+    ev = &event_ring[(event_head + 1) % KSU_EVENT_RING_SIZE];
+    ev->seq = event_head + 1;
+    ev->timestamp = ktime_get_boottime_ns();
+    ev->type = type;
+    ev->data = data;
+    WRITE_ONCE(event_head, ev->seq);
+    spin_unlock_irqrestore(&event_lock, flags);
+
+    wake_up_interruptible(&event_wq);
+}
+
+static bool has_event_after(u64 seq)
+{
+    return READ_ONCE(event_head) > seq;
+}
+
+static ssize_t ksu_event_read(struct file *file, char __user *buf,
+                              size_t count, loff_t *ppos)
+{
+    struct ksu_event events[8];
+    size_t max = min(count / sizeof(struct ksu_event), ARRAY_SIZE(events));
+    unsigned long flags;
+    size_t n = 0;
+    u64 next;
+
+    if (!max)
+        return -EINVAL;
+
+    if (!has_event_after(*ppos)) {
+        if (file->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        if (wait_event_interruptible(event_wq, has_event_after(*ppos)))
+            return -ERESTARTSYS;
+    }
+
+    spin_lock_irqsave(&event_lock, flags);
+    next = *ppos + 1;
+    if (event_head > KSU_EVENT_RING_SIZE &&
+        next <= event_head - KSU_EVENT_RING_SIZE)
+        next = event_head - KSU_EVENT_RING_SIZE + 1;
+    while (next <= event_head && n < max) {
+        events[n++] = event_ring[next % KSU_EVENT_RING_SIZE];
+        next++;
+    }
+    spin_unlock_irqrestore(&event_lock, flags);
+
+    if (copy_to_user(buf, events, n * sizeof(struct ksu_event))) {
+        pr_err("event: copy_to_user failed\n");
+        return -EFAULT;
+    }
+
+    *ppos = next - 1;
+    return n * sizeof(struct ksu_event);
+}
+
+static __poll_t ksu_event_poll(struct file *file, poll_table *wait)
+{
+    poll_wait(file, &event_wq, wait);
+
+    return has_event_after(file->f_pos) ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+static const struct file_operations event_fops = {
+    .owner = THIS_MODULE,
+    .read = ksu_event_read,
+    .poll = ksu_event_poll,
+};
+
+int ksu_event_install_fd(void)
+{
+    return anon_inode_getfd("[ksu_events]", &event_fops, NULL,
+                            O_RDONLY | O_CLOEXEC);
+}
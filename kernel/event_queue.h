@@ -0,0 +1,31 @@
+#ifndef __KSU_H_EVENT_QUEUE
+#define __KSU_H_EVENT_QUEUE
+
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/types.h>
+
+// Record returned by read() on the fd from KSU_IOCTL_GET_EVENT_FD
+struct ksu_event {
+    __u64 seq; // Sequence number, increases by one for every event
+    __u64 timestamp; // Boot time in ns when the event was emitted
+    __u32 type; // KSU_EVENT_*
+    __u32 data; // Event specific payload
+};
+
+// The first three match EVENT_* reported by ksud
+#define KSU_EVENT_POST_FS_DATA 1
+#define KSU_EVENT_BOOT_COMPLETED 2
+#define KSU_EVENT_MODULE_MOUNTED 3
+#define KSU_EVENT_MANAGER_CHANGED 4 // data: new manager uid, or -1 if invalidated
+#define KSU_EVENT_ALLOWLIST_PRUNED 5 // data: number of pruned profiles
+#define KSU_EVENT_SAFE_MODE 6
+#define KSU_EVENT_APP_PROFILE_CHANGED 7 // data: uid of the profile
+
+void ksu_event_emit(u32 type, u32 data);
+
+// The events reveal the manager and allowlisted uids, so they are not on the
+// driver fd every process can get; callers must check manager_or_root().
+int ksu_event_install_fd(void);
+
+#endif // __KSU_H_EVENT_QUEUE
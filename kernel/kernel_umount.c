@@ -13,6 +13,7 @@
 #include "kernel_umount.h"
 #include "klog.h" // IWYU pragma: keep
 #include "allowlist.h"
+#include "audit.h"
 #include "selinux/selinux.h"
 #include "feature.h"
 #include "ksud.h"
@@ -135,6 +136,7 @@ int ksu_handle_umount(uid_t old_uid, uid_t new_uid)
     }
     // umount the target mnt
     pr_info("handle umount for uid: %d, pid: %d\n", new_uid, current->pid);
+    ksu_audit(KSU_AUDIT_UMOUNT, new_uid, 1);
 
     tw = kzalloc(sizeof(*tw), GFP_ATOMIC);
     if (!tw)
@@ -5,12 +5,14 @@
 #include <linux/workqueue.h>
 
 #include "allowlist.h"
+#include "audit.h"
 #include "feature.h"
 #include "klog.h" // IWYU pragma: keep
 #include "throne_tracker.h"
 #include "syscall_hook_manager.h"
 #include "ksud.h"
 #include "supercalls.h"
+#include "selinux/selinux.h"
 
 int __init kernelsu_init(void)
 {
@@ -26,6 +28,8 @@ int __init kernelsu_init(void)
 
     ksu_feature_init();
 
+    ksu_audit_init();
+
     ksu_supercalls_init();
 
     ksu_syscall_hook_manager_init();
@@ -59,7 +63,11 @@ void kernelsu_exit(void)
 
     ksu_supercalls_exit();
 
+    ksu_sepolicy_exit();
+
     ksu_feature_exit();
+
+    ksu_audit_exit();
 }
 
 module_init(kernelsu_init);
@@ -20,11 +20,13 @@
 #include "manager.h"
 #include "allowlist.h"
 #include "arch.h"
+#include "event_queue.h"
 #include "klog.h" // IWYU pragma: keep
 #include "ksud.h"
 #include "util.h"
 #include "mount_hook.h"
 #include "selinux/selinux.h"
+#include "syscall_hook_manager.h"
 #include "throne_tracker.h"
 
 bool ksu_module_mounted __read_mostly = false;
@@ -118,6 +120,7 @@ void on_boot_completed(void)
     ksu_boot_completed = true;
     pr_info("on_boot_completed!\n");
     track_throne(true);
+    ksu_unmark_zygote();
 }
 
 #define MAX_ARG_STRINGS 0x7FFFFFFF
@@ -196,6 +199,25 @@ static void on_post_fs_data_cbfun(struct callback_head *cb)
 static struct callback_head on_post_fs_data_cb = { .func =
                                                        on_post_fs_data_cbfun };
 
+static void apply_kernelsu_rules_cbfun(struct callback_head *cb)
+{
+    apply_kernelsu_rules();
+}
+
+static struct callback_head apply_kernelsu_rules_cb = {
+    .func = apply_kernelsu_rules_cbfun
+};
+
+// The execve hook runs with preemption disabled, while patching the policy
+// takes ksu_rules and allocates with GFP_KERNEL. Do it when init returns to
+// userspace from this execve, which is still before second stage runs.
+static void queue_apply_kernelsu_rules(void)
+{
+    if (task_work_add(current, &apply_kernelsu_rules_cb, TWA_RESUME)) {
+        pr_err("queue apply_kernelsu_rules failed\n");
+    }
+}
+
 // IMPORTANT NOTE: the call from execve_handler_pre WON'T provided correct value for envp and flags in GKI version
 int ksu_handle_execveat_ksud(int *fd, struct filename **filename_ptr,
                              struct user_arg_ptr *argv,
@@ -234,7 +256,7 @@ int ksu_handle_execveat_ksud(int *fd, struct filename **filename_ptr,
                 pr_info("/system/bin/init first arg: %s\n", first_arg);
                 if (!strcmp(first_arg, "second_stage")) {
                     pr_info("/system/bin/init second_stage executed\n");
-                    apply_kernelsu_rules();
+                    queue_apply_kernelsu_rules();
                     init_second_stage_executed = true;
                 }
             } else {
@@ -256,7 +278,7 @@ int ksu_handle_execveat_ksud(int *fd, struct filename **filename_ptr,
                 pr_info("/init first arg: %s\n", first_arg);
                 if (!strcmp(first_arg, "--second-stage")) {
                     pr_info("/init second_stage executed\n");
-                    apply_kernelsu_rules();
+                    queue_apply_kernelsu_rules();
                     init_second_stage_executed = true;
                 }
             } else {
@@ -289,8 +311,9 @@ int ksu_handle_execveat_ksud(int *fd, struct filename **filename_ptr,
                         (!strcmp(env_value, "1") ||
                          !strcmp(env_value, "true"))) {
                         pr_info("/init second_stage executed\n");
-                        apply_kernelsu_rules();
+                        queue_apply_kernelsu_rules();
                         init_second_stage_executed = true;
+                        break;
                     }
                 }
             }
@@ -489,6 +512,7 @@ bool ksu_is_safe_mode()
         // pressed over 3 times
         pr_info("KEY_VOLUMEDOWN pressed max times, safe mode detected!\n");
         safe_mode = true;
+        ksu_event_emit(KSU_EVENT_SAFE_MODE, 0);
         return true;
     }
 
@@ -1,3 +1,5 @@
+#include <linux/ktime.h>
+#include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/types.h>
 #include <linux/version.h>
@@ -21,11 +23,34 @@ static struct policydb *get_policydb(void)
     struct policydb *db;
     struct selinux_policy *policy = selinux_state.policy;
     db = &policy->policydb;
+    ksu_set_generation(policy->latest_granting);
     return db;
 }
 
 static DEFINE_MUTEX(ksu_rules);
 
+void ksu_sepolicy_exit(void)
+{
+    mutex_lock(&ksu_rules);
+    ksu_drop_caches();
+    mutex_unlock(&ksu_rules);
+}
+
+static void policy_growth_begin(struct policydb *db, struct policy_growth *g)
+{
+    g->start = ktime_get();
+    g->avtab = db->te_avtab.nel;
+    g->types = db->p_types.nprim;
+}
+
+static void policy_growth_end(struct policydb *db,
+                              const struct policy_growth *g, const char *what)
+{
+    pr_info("%s: %lld us, avtab %u -> %u, types %u -> %u\n", what,
+            ktime_us_delta(ktime_get(), g->start), g->avtab,
+            db->te_avtab.nel, g->types, db->p_types.nprim);
+}
+
 void apply_kernelsu_rules()
 {
     struct policydb *db;
@@ -34,9 +59,12 @@ void apply_kernelsu_rules()
         pr_info("SELinux permissive or disabled, apply rules!\n");
     }
 
+    struct policy_growth growth;
+
     mutex_lock(&ksu_rules);
 
     db = get_policydb();
+    policy_growth_begin(db, &growth);
 
     ksu_permissive(db, KERNEL_SU_DOMAIN);
     ksu_typeattribute(db, KERNEL_SU_DOMAIN, "mlstrustedsubject");
@@ -127,6 +155,7 @@ void apply_kernelsu_rules()
     ksu_allow(db, "system_server", KERNEL_SU_DOMAIN, "process", "getpgid");
     ksu_allow(db, "system_server", KERNEL_SU_DOMAIN, "process", "sigkill");
 
+    policy_growth_end(db, &growth, "apply_kernelsu_rules");
     mutex_unlock(&ksu_rules);
 }
 
@@ -191,8 +220,11 @@ static void reset_avc_cache()
     selinux_xfrm_notify_policyload();
 }
 
-int handle_sepolicy(unsigned long arg3, void __user *arg4)
+// batch is NULL for a single rule, whose growth goes to the debug log
+static int __handle_sepolicy(void __user *arg4,
+                             struct ksu_sepolicy_batch *batch)
 {
+    struct policy_growth growth;
     struct policydb *db;
 
     if (!arg4) {
@@ -215,6 +247,10 @@ int handle_sepolicy(unsigned long arg3, void __user *arg4)
     mutex_lock(&ksu_rules);
 
     db = get_policydb();
+    if (!batch)
+        policy_growth_begin(db, &growth);
+    else if (!batch->rules++)
+        policy_growth_begin(db, &batch->growth);
 
     int ret = -EINVAL;
     if (cmd == CMD_NORMAL_PERM) {
@@ -464,11 +500,125 @@ int handle_sepolicy(unsigned long arg3, void __user *arg4)
     }
 
 exit:
+    // debug only, a client setting rules one ioctl at a time would flood dmesg
+    if (!batch)
+        pr_debug("sepolicy rule: %lld us, avtab %u -> %u\n",
+                 ktime_us_delta(ktime_get(), growth.start), growth.avtab,
+                 db->te_avtab.nel);
     mutex_unlock(&ksu_rules);
 
+    return ret;
+}
+
+int handle_sepolicy(unsigned long arg3, void __user *arg4)
+{
+    int ret = __handle_sepolicy(arg4, NULL);
+
     // only allow and xallow needs to reset avc cache, but we cannot do that because
     // we are in atomic context. so we just reset it every time.
     reset_avc_cache();
 
     return ret;
 }
+
+u32 ksu_sepolicy_decl_cmd(void __user *arg4)
+{
+    u32 cmd;
+
+    if (!arg4 || get_user(cmd, (u32 __user *)arg4))
+        return 0;
+    return cmd == CMD_TYPE || cmd == CMD_ATTR ? cmd : 0;
+}
+
+// Names of a run of declarations, too big for the stack
+struct sepol_decls {
+    char names[KSU_SEPOLICY_RUN_MAX][MAX_SEPOL_LEN];
+    char attrs[KSU_SEPOLICY_RUN_MAX][MAX_SEPOL_LEN];
+    const char *name_ptrs[KSU_SEPOLICY_RUN_MAX];
+    const char *attr_ptrs[KSU_SEPOLICY_RUN_MAX];
+    bool ok[KSU_SEPOLICY_RUN_MAX];
+};
+
+// Copy the names of args[i], which must still be a cmd declaration
+static bool copy_decl(struct sepol_decls *d, u32 i, void __user *arg4,
+                      u32 cmd)
+{
+    struct sepol_data data;
+
+    if (copy_from_user(&data, arg4, sizeof(data)) || data.cmd != cmd)
+        return false;
+    if (strncpy_from_user(d->names[i], data.sepol1, MAX_SEPOL_LEN) < 0)
+        return false;
+    if (cmd == CMD_TYPE &&
+        strncpy_from_user(d->attrs[i], data.sepol2, MAX_SEPOL_LEN) < 0)
+        return false;
+    d->name_ptrs[i] = d->names[i];
+    d->attr_ptrs[i] = d->attrs[i];
+    return true;
+}
+
+u32 handle_sepolicy_decls(struct ksu_sepolicy_batch *batch,
+                          void __user *const *args, u32 count, bool stop,
+                          int *results)
+{
+    struct sepol_decls *d;
+    struct policydb *db;
+    u32 cmd, i;
+
+    cmd = ksu_sepolicy_decl_cmd(args[0]);
+    d = count > 1 && cmd ? kmalloc(sizeof(*d), GFP_KERNEL) : NULL;
+    if (!d) {
+        results[0] = __handle_sepolicy(args[0], batch);
+        return 1;
+    }
+
+    count = min_t(u32, count, KSU_SEPOLICY_RUN_MAX);
+    for (i = 0; i < count; i++) {
+        if (!copy_decl(d, i, args[i], cmd))
+            break;
+    }
+    // a rule we cannot read ends the run and fails on its own
+    count = i;
+    if (!count) {
+        kfree(d);
+        results[0] = -EINVAL;
+        return 1;
+    }
+
+    if (!getenforce()) {
+        pr_info("SELinux permissive or disabled when handle policy!\n");
+    }
+
+    mutex_lock(&ksu_rules);
+
+    db = get_policydb();
+    if (!batch->rules)
+        policy_growth_begin(db, &batch->growth);
+
+    count = ksu_types(db, d->name_ptrs,
+                      cmd == CMD_TYPE ? d->attr_ptrs : NULL, count, stop,
+                      d->ok);
+    batch->rules += count;
+
+    mutex_unlock(&ksu_rules);
+
+    for (i = 0; i < count; i++) {
+        if (!d->ok[i])
+            pr_err("sepol: %d failed.\n", cmd);
+        results[i] = d->ok[i] ? 0 : -EINVAL;
+    }
+    kfree(d);
+    return count;
+}
+
+void ksu_flush_avc_cache(struct ksu_sepolicy_batch *batch)
+{
+    if (batch->rules) {
+        mutex_lock(&ksu_rules);
+        pr_info("batched sepolicy: %u rules\n", batch->rules);
+        policy_growth_end(get_policydb(), &batch->growth, "batched sepolicy");
+        mutex_unlock(&ksu_rules);
+    }
+
+    reset_avc_cache();
+}
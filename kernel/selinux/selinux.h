@@ -4,6 +4,7 @@
 #include "linux/types.h"
 #include "linux/version.h"
 #include "linux/cred.h"
+#include "linux/ktime.h"
 
 void setup_selinux(const char *);
 
@@ -23,6 +24,42 @@ void apply_kernelsu_rules();
 
 u32 ksu_get_ksu_file_sid();
 
+// Policy size when a patch started, to log how long it took and how much
+// it grew the avtab and type table
+struct policy_growth {
+    ktime_t start;
+    u32 avtab;
+    u32 types;
+};
+
+// Rules of one KSU_IOCTL_BATCH, kept on the stack of its caller
+struct ksu_sepolicy_batch {
+    struct policy_growth growth;
+    u32 rules;
+};
+
 int handle_sepolicy(unsigned long arg3, void __user *arg4);
 
+// Most SET_SEPOLICY entries of a batch applied by one
+// handle_sepolicy_decls() call
+#define KSU_SEPOLICY_RUN_MAX 64
+
+// CMD_TYPE or CMD_ATTR when the rule at arg4 declares a type or an
+// attribute, else 0
+u32 ksu_sepolicy_decl_cmd(void __user *arg4);
+
+// Apply the rules args[0..count), consecutive in a batch, and leave the
+// avc to ksu_flush_avc_cache() after the batch. A run of declarations of
+// the same kind is added with one add_types() call, any other rule is
+// applied alone. results[i] gets each result; returns how many rules were
+// applied, which with stop ends at the first failure.
+u32 handle_sepolicy_decls(struct ksu_sepolicy_batch *batch,
+                          void __user *const *args, u32 count, bool stop,
+                          int *results);
+
+void ksu_flush_avc_cache(struct ksu_sepolicy_batch *batch);
+
+// Free what the sepolicy patcher cached about the policy
+void ksu_sepolicy_exit(void);
+
 #endif
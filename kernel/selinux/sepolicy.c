@@ -20,11 +20,11 @@ static struct avtab_node *get_avtab_node(struct policydb *db,
 static bool add_rule(struct policydb *db, const char *s, const char *t,
              const char *c, const char *p, int effect, bool invert);
 
-static void add_rule_raw(struct policydb *db, struct type_datum *src,
-             struct type_datum *tgt, struct class_datum *cls,
-             struct perm_datum *perm, int effect, bool invert);
+static u32 add_rule_raw(struct policydb *db, struct type_datum *src,
+            struct type_datum *tgt, struct class_datum *cls,
+            struct perm_datum *perm, int effect, bool invert);
 
-static void add_xperm_rule_raw(struct policydb *db, struct type_datum *src,
+static u32 add_xperm_rule_raw(struct policydb *db, struct type_datum *src,
                    struct type_datum *tgt, struct class_datum *cls,
                    uint16_t low, uint16_t high, int effect,
                    bool invert);
@@ -47,7 +47,7 @@ static bool add_type(struct policydb *db, const char *type_name, bool attr);
 static bool set_type_state(struct policydb *db, const char *type_name,
                bool permissive);
 
-static void add_typeattribute_raw(struct policydb *db, struct type_datum *type,
+static bool add_typeattribute_raw(struct policydb *db, struct type_datum *type,
                   struct type_datum *attr);
 
 static bool add_typeattribute(struct policydb *db, const char *type,
@@ -140,6 +140,99 @@ static struct avtab_node *get_avtab_node(struct policydb *db,
     return node;
 }
 
+// Attributes of the policy, the candidates for a wildcard source or target.
+// Rebuilt when types are added; dropped with the other caches when the
+// policy generation changes (see ksu_set_generation).
+static struct {
+    u32 ntypes;
+    u32 count;
+    struct type_datum **attrs;
+} wildcard_attrs;
+
+static bool wildcard_attrs_valid(struct policydb *db)
+{
+    return wildcard_attrs.attrs && wildcard_attrs.ntypes == db->p_types.nprim;
+}
+
+static bool build_wildcard_attrs(struct policydb *db)
+{
+    u32 nprim = db->p_types.nprim, i, count = 0;
+
+    kfree(wildcard_attrs.attrs);
+    memset(&wildcard_attrs, 0, sizeof(wildcard_attrs));
+
+    for (i = 0; i < nprim; ++i) {
+        struct type_datum *type = db->type_val_to_struct[i];
+        if (type && type->attribute)
+            ++count;
+    }
+
+    struct type_datum **attrs =
+        kcalloc(max_t(u32, count, 1), sizeof(*attrs), GFP_KERNEL);
+    if (!attrs)
+        return false;
+
+    count = 0;
+    for (i = 0; i < nprim; ++i) {
+        struct type_datum *type = db->type_val_to_struct[i];
+        if (type && type->attribute)
+            attrs[count++] = type;
+    }
+
+    wildcard_attrs.ntypes = nprim;
+    wildcard_attrs.count = count;
+    wildcard_attrs.attrs = attrs;
+    return true;
+}
+
+// The types one side of a rule applies to: the given type, or for a
+// wildcard every attribute, or every type when the rule strips access
+// (see strip_av). Entries must still pass rule_type_matches.
+static struct type_datum **rule_types(struct policydb *db,
+                      struct type_datum **type, bool all,
+                      u32 *count)
+{
+    if (*type) {
+        *count = 1;
+        return type;
+    }
+    if (!all && (wildcard_attrs_valid(db) || build_wildcard_attrs(db))) {
+        *count = wildcard_attrs.count;
+        return wildcard_attrs.attrs;
+    }
+    *count = db->p_types.nprim;
+    return db->type_val_to_struct;
+}
+
+static bool rule_type_matches(struct type_datum *type,
+                  struct type_datum *given, bool all)
+{
+    return type && (given || all || type->attribute);
+}
+
+static struct class_datum **rule_classes(struct policydb *db,
+                     struct class_datum **cls, u32 *count)
+{
+    if (*cls) {
+        *count = 1;
+        return cls;
+    }
+    *count = db->p_classes.nprim;
+    return db->class_val_to_struct;
+}
+
+// Wildcard rules can touch tens of thousands of avtab nodes, tell module
+// authors what theirs cost.
+static void report_wildcard_rule(struct policydb *db, const char *s,
+                 const char *t, const char *c, u32 nodes,
+                 u32 nel)
+{
+    if (s && t && c)
+        return;
+    pr_info("rule %s %s %s: %u nodes, %u new\n", s ? s : "*",
+        t ? t : "*", c ? c : "*", nodes, db->te_avtab.nel - nel);
+}
+
 static bool add_rule(struct policydb *db, const char *s, const char *t,
              const char *c, const char *p, int effect, bool invert)
 {
@@ -187,182 +280,162 @@ static bool add_rule(struct policydb *db, const char *s, const char *t,
             return false;
         }
     }
-    add_rule_raw(db, src, tgt, cls, perm, effect, invert);
+    u32 nel = db->te_avtab.nel;
+    u32 nodes = add_rule_raw(db, src, tgt, cls, perm, effect, invert);
+    report_wildcard_rule(db, s, t, c, nodes, nel);
     return true;
 }
 
-static void add_rule_raw(struct policydb *db, struct type_datum *src,
-             struct type_datum *tgt, struct class_datum *cls,
-             struct perm_datum *perm, int effect, bool invert)
+static void add_avrule_node(struct policydb *db, struct type_datum *src,
+                struct type_datum *tgt, struct class_datum *cls,
+                struct perm_datum *perm, int effect, bool invert)
 {
-    if (src == NULL) {
-        struct hashtab_node *node;
-        if (strip_av(effect, invert)) {
-            ksu_hashtab_for_each(db->p_types.table, node)
-            {
-                add_rule_raw(db,
-                         (struct type_datum *)node->datum,
-                         tgt, cls, perm, effect, invert);
-            };
-        } else {
-            ksu_hashtab_for_each(db->p_types.table, node)
-            {
-                struct type_datum *type =
-                    (struct type_datum *)(node->datum);
-                if (type->attribute) {
-                    add_rule_raw(db, type, tgt, cls, perm,
-                             effect, invert);
-                }
-            };
-        }
-    } else if (tgt == NULL) {
-        struct hashtab_node *node;
-        if (strip_av(effect, invert)) {
-            ksu_hashtab_for_each(db->p_types.table, node)
-            {
-                add_rule_raw(db, src,
-                         (struct type_datum *)node->datum,
-                         cls, perm, effect, invert);
-            };
-        } else {
-            ksu_hashtab_for_each(db->p_types.table, node)
-            {
-                struct type_datum *type =
-                    (struct type_datum *)(node->datum);
-                if (type->attribute) {
-                    add_rule_raw(db, src, type, cls, perm,
-                             effect, invert);
-                }
-            };
-        }
-    } else if (cls == NULL) {
-        struct hashtab_node *node;
-        ksu_hashtab_for_each(db->p_classes.table, node)
-        {
-            add_rule_raw(db, src, tgt,
-                     (struct class_datum *)node->datum, perm,
-                     effect, invert);
-        }
+    struct avtab_key key;
+    key.source_type = src->value;
+    key.target_type = tgt->value;
+    key.target_class = cls->value;
+    key.specified = effect;
+
+    struct avtab_node *node = get_avtab_node(db, &key, NULL);
+    if (!node) {
+        pr_warn("add_rule_raw cannot found node!\n");
+        return;
+    }
+    if (invert) {
+        if (perm)
+            node->datum.u.data &= ~(1U << (perm->value - 1));
+        else
+            node->datum.u.data = 0U;
     } else {
-        struct avtab_key key;
-        key.source_type = src->value;
-        key.target_type = tgt->value;
-        key.target_class = cls->value;
-        key.specified = effect;
-
-        struct avtab_node *node = get_avtab_node(db, &key, NULL);
-        if (invert) {
-            if (perm)
-                node->datum.u.data &=
-                    ~(1U << (perm->value - 1));
-            else
-                node->datum.u.data = 0U;
-        } else {
-            if (perm)
-                node->datum.u.data |= 1U << (perm->value - 1);
-            else
-                node->datum.u.data = ~0U;
+        if (perm)
+            node->datum.u.data |= 1U << (perm->value - 1);
+        else
+            node->datum.u.data = ~0U;
+    }
+}
+
+// Returns the number of avtab nodes the rule touched.
+static u32 add_rule_raw(struct policydb *db, struct type_datum *src,
+            struct type_datum *tgt, struct class_datum *cls,
+            struct perm_datum *perm, int effect, bool invert)
+{
+    bool all = strip_av(effect, invert);
+    u32 nsrc, ntgt, ncls, i, j, k, nodes = 0;
+    struct type_datum **srcs = rule_types(db, &src, all, &nsrc);
+    struct type_datum **tgts = rule_types(db, &tgt, all, &ntgt);
+    struct class_datum **classes = rule_classes(db, &cls, &ncls);
+
+    for (i = 0; i < nsrc; ++i) {
+        if (!rule_type_matches(srcs[i], src, all))
+            continue;
+        for (j = 0; j < ntgt; ++j) {
+            if (!rule_type_matches(tgts[j], tgt, all))
+                continue;
+            for (k = 0; k < ncls; ++k) {
+                if (!classes[k])
+                    continue;
+                add_avrule_node(db, srcs[i], tgts[j], classes[k],
+                        perm, effect, invert);
+                ++nodes;
+            }
         }
     }
+    return nodes;
 }
 
 #define ioctl_driver(x) (x >> 8 & 0xFF)
 #define ioctl_func(x) (x & 0xFF)
 
 #define xperm_test(x, p) (1 & (p[x >> 5] >> (x & 0x1f)))
-#define xperm_set(x, p) (p[x >> 5] |= (1 << (x & 0x1f)))
-#define xperm_clear(x, p) (p[x >> 5] &= ~(1 << (x & 0x1f)))
+#define xperm_set(x, p) (p[x >> 5] |= (1U << (x & 0x1f)))
+#define xperm_clear(x, p) (p[x >> 5] &= ~(1U << (x & 0x1f)))
 
-static void add_xperm_rule_raw(struct policydb *db, struct type_datum *src,
-                   struct type_datum *tgt, struct class_datum *cls,
-                   uint16_t low, uint16_t high, int effect,
-                   bool invert)
+static void add_xperm_node(struct policydb *db, struct type_datum *src,
+               struct type_datum *tgt, struct class_datum *cls,
+               uint16_t low, uint16_t high, int effect, bool invert)
 {
-    if (src == NULL) {
-        struct hashtab_node *node;
-        ksu_hashtab_for_each(db->p_types.table, node)
-        {
-            struct type_datum *type =
-                (struct type_datum *)(node->datum);
-            if (type->attribute) {
-                add_xperm_rule_raw(db, type, tgt, cls, low,
-                           high, effect, invert);
-            }
-        };
-    } else if (tgt == NULL) {
-        struct hashtab_node *node;
-        ksu_hashtab_for_each(db->p_types.table, node)
-        {
-            struct type_datum *type =
-                (struct type_datum *)(node->datum);
-            if (type->attribute) {
-                add_xperm_rule_raw(db, src, type, cls, low,
-                           high, effect, invert);
-            }
-        };
-    } else if (cls == NULL) {
-        struct hashtab_node *node;
-        ksu_hashtab_for_each(db->p_classes.table, node)
-        {
-            add_xperm_rule_raw(db, src, tgt,
-                       (struct class_datum *)(node->datum),
-                       low, high, effect, invert);
-        };
+    struct avtab_key key;
+    key.source_type = src->value;
+    key.target_type = tgt->value;
+    key.target_class = cls->value;
+    key.specified = effect;
+
+    struct avtab_datum *datum;
+    struct avtab_node *node;
+    struct avtab_extended_perms xperms;
+
+    memset(&xperms, 0, sizeof(xperms));
+    if (ioctl_driver(low) != ioctl_driver(high)) {
+        xperms.specified = AVTAB_XPERMS_IOCTLDRIVER;
+        xperms.driver = 0;
     } else {
-        struct avtab_key key;
-        key.source_type = src->value;
-        key.target_type = tgt->value;
-        key.target_class = cls->value;
-        key.specified = effect;
-
-        struct avtab_datum *datum;
-        struct avtab_node *node;
-        struct avtab_extended_perms xperms;
-
-        memset(&xperms, 0, sizeof(xperms));
-        if (ioctl_driver(low) != ioctl_driver(high)) {
-            xperms.specified = AVTAB_XPERMS_IOCTLDRIVER;
-            xperms.driver = 0;
-        } else {
-            xperms.specified = AVTAB_XPERMS_IOCTLFUNCTION;
-            xperms.driver = ioctl_driver(low);
+        xperms.specified = AVTAB_XPERMS_IOCTLFUNCTION;
+        xperms.driver = ioctl_driver(low);
+    }
+    int i;
+    if (xperms.specified == AVTAB_XPERMS_IOCTLDRIVER) {
+        for (i = ioctl_driver(low); i <= ioctl_driver(high);
+             ++i) {
+            if (invert)
+                xperm_clear(i, xperms.perms.p);
+            else
+                xperm_set(i, xperms.perms.p);
         }
-        int i;
-        if (xperms.specified == AVTAB_XPERMS_IOCTLDRIVER) {
-            for (i = ioctl_driver(low); i <= ioctl_driver(high);
-                 ++i) {
-                if (invert)
-                    xperm_clear(i, xperms.perms.p);
-                else
-                    xperm_set(i, xperms.perms.p);
-            }
-        } else {
-            for (i = ioctl_func(low); i <= ioctl_func(high); ++i) {
-                if (invert)
-                    xperm_clear(i, xperms.perms.p);
-                else
-                    xperm_set(i, xperms.perms.p);
-            }
+    } else {
+        for (i = ioctl_func(low); i <= ioctl_func(high); ++i) {
+            if (invert)
+                xperm_clear(i, xperms.perms.p);
+            else
+                xperm_set(i, xperms.perms.p);
         }
+    }
 
-        node = get_avtab_node(db, &key, &xperms);
-        if (!node) {
-            pr_warn("add_xperm_rule_raw cannot found node!\n");
+    node = get_avtab_node(db, &key, &xperms);
+    if (!node) {
+        pr_warn("add_xperm_rule_raw cannot found node!\n");
+        return;
+    }
+    datum = &node->datum;
+
+    if (datum->u.xperms == NULL) {
+        datum->u.xperms =
+            (struct avtab_extended_perms *)(kzalloc(
+                sizeof(xperms), GFP_KERNEL));
+        if (!datum->u.xperms) {
+            pr_err("alloc xperms failed\n");
             return;
         }
-        datum = &node->datum;
-
-        if (datum->u.xperms == NULL) {
-            datum->u.xperms =
-                (struct avtab_extended_perms *)(kzalloc(
-                    sizeof(xperms), GFP_KERNEL));
-            if (!datum->u.xperms) {
-                pr_err("alloc xperms failed\n");
-                return;
+        memcpy(datum->u.xperms, &xperms, sizeof(xperms));
+    }
+}
+
+// Returns the number of avtab nodes the rule touched.
+static u32 add_xperm_rule_raw(struct policydb *db, struct type_datum *src,
+                  struct type_datum *tgt, struct class_datum *cls,
+                  uint16_t low, uint16_t high, int effect,
+                  bool invert)
+{
+    u32 nsrc, ntgt, ncls, i, j, k, nodes = 0;
+    struct type_datum **srcs = rule_types(db, &src, false, &nsrc);
+    struct type_datum **tgts = rule_types(db, &tgt, false, &ntgt);
+    struct class_datum **classes = rule_classes(db, &cls, &ncls);
+
+    for (i = 0; i < nsrc; ++i) {
+        if (!rule_type_matches(srcs[i], src, false))
+            continue;
+        for (j = 0; j < ntgt; ++j) {
+            if (!rule_type_matches(tgts[j], tgt, false))
+                continue;
+            for (k = 0; k < ncls; ++k) {
+                if (!classes[k])
+                    continue;
+                add_xperm_node(db, srcs[i], tgts[j], classes[k], low,
+                           high, effect, invert);
+                ++nodes;
             }
-            memcpy(datum->u.xperms, &xperms, sizeof(xperms));
         }
     }
+    return nodes;
 }
 
 static bool add_xperm_rule(struct policydb *db, const char *s, const char *t,
@@ -410,7 +483,10 @@ static bool add_xperm_rule(struct policydb *db, const char *s, const char *t,
         high = 0xFFFF;
     }
 
-    add_xperm_rule_raw(db, src, tgt, cls, low, high, effect, invert);
+    u32 nel = db->te_avtab.nel;
+    u32 nodes = add_xperm_rule_raw(db, src, tgt, cls, low, high, effect,
+                       invert);
+    report_wildcard_rule(db, s, t, c, nodes, nel);
     return true;
 }
 
@@ -448,6 +524,10 @@ static bool add_type_rule(struct policydb *db, const char *s, const char *t,
     key.specified = effect;
 
     struct avtab_node *node = get_avtab_node(db, &key, NULL);
+    if (!node) {
+        pr_warn("add_type_rule cannot found node!\n");
+        return false;
+    }
     node->datum.u.data = def->value;
 
     return true;
@@ -545,17 +625,43 @@ static bool add_filename_trans(struct policydb *db, const char *s,
     }
 
     if (trans == NULL) {
-        trans = (struct filename_trans_datum *)kcalloc(sizeof(*trans),
-                                   1, GFP_ATOMIC);
-        struct filename_trans_key *new_key =
-            (struct filename_trans_key *)kzalloc(sizeof(*new_key),
-                                 GFP_ATOMIC);
-        *new_key = key;
-        new_key->name = kstrdup(key.name, GFP_ATOMIC);
-        trans->next = last;
+        struct filename_trans_key *new_key = NULL;
+
+        // allocate everything before linking anything into the policy
+        trans = kzalloc(sizeof(*trans), GFP_KERNEL);
+        if (!trans)
+            goto oom;
+        ebitmap_init(&trans->stypes);
         trans->otype = def->value;
-        hashtab_insert(&db->filename_trans, new_key, trans,
-                   filenametr_key_params);
+        if (ebitmap_set_bit(&trans->stypes, src->value - 1, 1))
+            goto oom;
+
+        if (last) {
+            // the name already has a chain, add a datum for this otype
+            last->next = trans;
+        } else {
+            new_key = kzalloc(sizeof(*new_key), GFP_KERNEL);
+            if (!new_key)
+                goto oom;
+            *new_key = key;
+            new_key->name = kstrdup(key.name, GFP_KERNEL);
+            if (!new_key->name ||
+                hashtab_insert(&db->filename_trans, new_key, trans,
+                       filenametr_key_params))
+                goto oom;
+        }
+        db->compat_filename_trans_count++;
+        return true;
+
+oom:
+        pr_err("add_filename_trans: alloc failed\n");
+        if (new_key)
+            kfree(new_key->name);
+        kfree(new_key);
+        if (trans)
+            ebitmap_destroy(&trans->stypes);
+        kfree(trans);
+        return false;
     }
 
     db->compat_filename_trans_count++;
@@ -571,7 +677,9 @@ static bool add_genfscon(struct policydb *db, const char *fs_name,
 static void *ksu_realloc(void *old, size_t new_size, size_t old_size)
 {
     // we can't use krealloc, because it may be read-only
-    void *new = kzalloc(new_size, GFP_ATOMIC);
+    // callers hold the ksu_rules mutex, so like every allocation here this
+    // may sleep instead of draining the atomic reserves
+    void *new = kzalloc(new_size, GFP_KERNEL);
     if (!new) {
         return NULL;
     }
@@ -584,42 +692,37 @@ static void *ksu_realloc(void *old, size_t new_size, size_t old_size)
     return new;
 }
 
-static bool add_type(struct policydb *db, const char *type_name, bool attr)
-{
-    struct type_datum *type = symtab_search(&db->p_types, type_name);
-    if (type) {
-        pr_warn("Type %s already exists\n", type_name);
-        return true;
-    }
+// How many slots the per-type arrays of the policy have since we last grew
+// them, 0 until then. They are reused for the rest of the generation, so a
+// module declaring many types does not copy the whole table for each one.
+static u32 type_slots;
 
-    u32 value = ++db->p_types.nprim;
-    type = (struct type_datum *)kzalloc(sizeof(struct type_datum),
-                        GFP_ATOMIC);
-    if (!type) {
-        pr_err("add_type: alloc type_datum failed.\n");
-        return false;
-    }
+// Replaced arrays are never freed (see ksu_realloc); keep count of them.
+// With the slack below this grows logarithmically with the type count.
+static u32 type_arrays_leaked;
+static size_t type_arrays_leaked_bytes;
 
-    type->primary = 1;
-    type->value = value;
-    type->attribute = attr;
+static u32 type_arrays_capacity(struct policydb *db)
+{
+    return type_slots ? type_slots : db->p_types.nprim;
+}
 
-    char *key = kstrdup(type_name, GFP_ATOMIC);
-    if (!key) {
-        pr_err("add_type: alloc key failed.\n");
-        return false;
-    }
+// Make room for `count` more types, growing by at least an eighth of the
+// table so repeated additions are amortized O(1).
+static bool reserve_types(struct policydb *db, u32 count)
+{
+    u32 nprim = db->p_types.nprim;
+    u32 needed = nprim + count;
 
-    if (symtab_insert(&db->p_types, key, type)) {
-        pr_err("add_type: insert symtab failed.\n");
-        return false;
-    }
+    if (needed <= type_arrays_capacity(db))
+        return true;
+
+    u32 capacity = needed + max_t(u32, nprim / 8, 32);
 
     struct ebitmap *new_type_attr_map_array =
         ksu_realloc(db->type_attr_map_array,
-                value * sizeof(struct ebitmap),
-                (value - 1) * sizeof(struct ebitmap));
-
+                capacity * sizeof(struct ebitmap),
+                nprim * sizeof(struct ebitmap));
     if (!new_type_attr_map_array) {
         pr_err("add_type: alloc type_attr_map_array failed\n");
         return false;
@@ -627,40 +730,155 @@ static bool add_type(struct policydb *db, const char *type_name, bool attr)
 
     struct type_datum **new_type_val_to_struct =
         ksu_realloc(db->type_val_to_struct,
-                sizeof(*db->type_val_to_struct) * value,
-                sizeof(*db->type_val_to_struct) * (value - 1));
-
+                sizeof(*db->type_val_to_struct) * capacity,
+                sizeof(*db->type_val_to_struct) * nprim);
     if (!new_type_val_to_struct) {
         pr_err("add_type: alloc type_val_to_struct failed\n");
+        kfree(new_type_attr_map_array);
         return false;
     }
 
     char **new_val_to_name_types =
         ksu_realloc(db->sym_val_to_name[SYM_TYPES],
-                sizeof(char *) * value,
-                sizeof(char *) * (value - 1));
+                sizeof(char *) * capacity, sizeof(char *) * nprim);
     if (!new_val_to_name_types) {
         pr_err("add_type: alloc val_to_name failed\n");
+        kfree(new_type_val_to_struct);
+        kfree(new_type_attr_map_array);
         return false;
     }
 
-    db->type_attr_map_array = new_type_attr_map_array;
-    ebitmap_init(&db->type_attr_map_array[value - 1]);
-    ebitmap_set_bit(&db->type_attr_map_array[value - 1], value - 1, 1);
+    if (db->type_attr_map_array) {
+        type_arrays_leaked += 3;
+        type_arrays_leaked_bytes +=
+            nprim * (sizeof(struct ebitmap) +
+                 sizeof(*db->type_val_to_struct) + sizeof(char *));
+    }
 
+    db->type_attr_map_array = new_type_attr_map_array;
     db->type_val_to_struct = new_type_val_to_struct;
-    db->type_val_to_struct[value - 1] = type;
-
     db->sym_val_to_name[SYM_TYPES] = new_val_to_name_types;
-    db->sym_val_to_name[SYM_TYPES][value - 1] = key;
 
-    int i;
+    type_slots = capacity;
+
+    pr_info("add_type: %u type slots for %u types, %u arrays (%zu bytes) left behind\n",
+        capacity, needed, type_arrays_leaked, type_arrays_leaked_bytes);
+    return true;
+}
+
+// Add all missing names in one go: the type arrays are grown at most once
+// and the roles are walked once for the whole batch. Every allocation we
+// make is made before the policy is touched, so a failed batch leaves it as
+// it was; ebitmap nodes are the exception, they come from SELinux's own
+// GFP_ATOMIC cache, and if one fails the types added so far stay declared.
+static bool add_types(struct policydb *db, const char *const *names,
+              u32 count, bool attr)
+{
+    struct type_prealloc {
+        struct type_datum *type;
+        char *key;
+    } *pool;
+    u32 i, missing = 0;
+    bool ok = true;
+
+    for (i = 0; i < count; ++i) {
+        if (symtab_search(&db->p_types, names[i]))
+            pr_warn("Type %s already exists\n", names[i]);
+        else
+            ++missing;
+    }
+    if (!missing)
+        return true;
+
+    pool = kcalloc(missing, sizeof(*pool), GFP_KERNEL);
+    if (!pool) {
+        pr_err("add_type: alloc pool failed.\n");
+        return false;
+    }
+
+    u32 n = 0;
+    for (i = 0; i < count; ++i) {
+        if (symtab_search(&db->p_types, names[i]))
+            continue;
+        struct type_prealloc *p = &pool[n++];
+        p->type = kzalloc(sizeof(struct type_datum), GFP_KERNEL);
+        p->key = kstrdup(names[i], GFP_KERNEL);
+        if (!p->type || !p->key) {
+            pr_err("add_type: alloc type %s failed.\n", names[i]);
+            ok = false;
+            goto out;
+        }
+    }
+
+    if (!reserve_types(db, missing)) {
+        ok = false;
+        goto out;
+    }
+
+    u32 first = db->p_types.nprim;
+
+    for (i = 0; i < n; ++i) {
+        struct type_datum *type = pool[i].type;
+        char *key = pool[i].key;
+
+        // the same name twice in one batch
+        if (symtab_search(&db->p_types, key))
+            continue;
+
+        u32 value = db->p_types.nprim + 1;
+        type->primary = 1;
+        type->value = value;
+        type->attribute = attr;
+
+        // the slot is past nprim, so nothing sees it until the insert
+        struct ebitmap *map = &db->type_attr_map_array[value - 1];
+        ebitmap_init(map);
+        if (ebitmap_set_bit(map, value - 1, 1)) {
+            pr_err("add_type: set type_attr_map of %s failed.\n", key);
+            ok = false;
+            break;
+        }
+
+        if (symtab_insert(&db->p_types, key, type)) {
+            pr_err("add_type: insert symtab failed.\n");
+            ebitmap_destroy(map);
+            ok = false;
+            break;
+        }
+        pool[i].type = NULL;
+        pool[i].key = NULL;
+
+        db->type_val_to_struct[value - 1] = type;
+        db->sym_val_to_name[SYM_TYPES][value - 1] = key;
+        db->p_types.nprim = value;
+    }
+
+    u32 last = db->p_types.nprim;
     for (i = 0; i < db->p_roles.nprim; ++i) {
-        ebitmap_set_bit(&db->role_val_to_struct[i]->types, value - 1,
-                1);
+        struct ebitmap *types = &db->role_val_to_struct[i]->types;
+        u32 v;
+        for (v = first; v < last; ++v) {
+            if (ebitmap_set_bit(types, v, 1)) {
+                pr_err("add_type: add %s to role %s failed.\n",
+                       db->sym_val_to_name[SYM_TYPES][v],
+                       db->sym_val_to_name[SYM_ROLES][i]);
+                ok = false;
+            }
+        }
     }
 
-    return true;
+out:
+    for (i = 0; i < n; ++i) {
+        kfree(pool[i].type);
+        kfree(pool[i].key);
+    }
+    kfree(pool);
+    return ok;
+}
+
+static bool add_type(struct policydb *db, const char *type_name, bool attr)
+{
+    return add_types(db, &type_name, 1, attr);
 }
 
 static bool set_type_state(struct policydb *db, const char *type_name,
@@ -692,11 +910,113 @@ static bool set_type_state(struct policydb *db, const char *type_name,
     return true;
 }
 
-static void add_typeattribute_raw(struct policydb *db, struct type_datum *type,
+// Constraint expressions naming each attribute, so add_typeattribute_raw
+// only touches those instead of every constraint of every class. Built on
+// first use per policy generation; we never add constraints, so it stays
+// valid until then.
+static struct {
+    u32 nprim; // attribute values covered
+    // expressions naming value v are exprs[start[v]] .. exprs[start[v + 1] - 1]
+    u32 *start;
+    struct constraint_expr **exprs;
+} attr_constraints;
+
+static bool is_attribute_bit(struct policydb *db, u32 bit)
+{
+    struct type_datum *t = db->type_val_to_struct[bit];
+    return t && t->attribute;
+}
+
+#define for_each_names_expr(db, node, n, e)                                    \
+    ksu_hashtab_for_each(db->p_classes.table, node)                        \
+        for (n = ((struct class_datum *)node->datum)->constraints; n;     \
+             n = n->next)                                               \
+            for (e = n->expr; e; e = e->next)                          \
+                if (e->expr_type == CEXPR_NAMES && e->type_names)
+
+static bool build_attr_constraints(struct policydb *db)
+{
+    struct hashtab_node *node;
+    struct constraint_node *n;
+    struct constraint_expr *e;
+    struct ebitmap_node *enode;
+    u32 nprim = db->p_types.nprim;
+    u32 total, bit;
+
+    kfree(attr_constraints.start);
+    kfree(attr_constraints.exprs);
+    memset(&attr_constraints, 0, sizeof(attr_constraints));
+
+    u32 *start = kcalloc(nprim + 2, sizeof(*start), GFP_KERNEL);
+    if (!start)
+        return false;
+
+    {
+        for_each_names_expr(db, node, n, e)
+        {
+            ebitmap_for_each_positive_bit(&e->type_names->types, enode, bit)
+            {
+                if (bit < nprim && is_attribute_bit(db, bit))
+                    start[bit + 1]++;
+            }
+        }
+    }
+
+    for (bit = 1; bit <= nprim; ++bit)
+        start[bit] += start[bit - 1];
+    total = start[nprim];
+    start[nprim + 1] = total;
+
+    struct constraint_expr **exprs =
+        kcalloc(max_t(u32, total, 1), sizeof(*exprs), GFP_KERNEL);
+    if (!exprs) {
+        kfree(start);
+        return false;
+    }
+
+    {
+        for_each_names_expr(db, node, n, e)
+        {
+            ebitmap_for_each_positive_bit(&e->type_names->types, enode, bit)
+            {
+                if (bit < nprim && is_attribute_bit(db, bit))
+                    exprs[--start[bit + 1]] = e;
+            }
+        }
+    }
+
+    attr_constraints.nprim = nprim;
+    attr_constraints.start = start;
+    attr_constraints.exprs = exprs;
+    pr_info("indexed %u attribute constraint names\n", total);
+    return true;
+}
+
+// Fails only when an ebitmap node can't be allocated; the type may then be
+// in the attribute but missing from the names of some of its constraints.
+static bool add_typeattribute_raw(struct policydb *db, struct type_datum *type,
                   struct type_datum *attr)
 {
     struct ebitmap *sattr = &db->type_attr_map_array[type->value - 1];
-    ebitmap_set_bit(sattr, attr->value - 1, 1);
+    if (ebitmap_set_bit(sattr, attr->value - 1, 1)) {
+        pr_err("add_typeattribute: set type_attr_map failed.\n");
+        return false;
+    }
+
+    bool ok = true;
+    if (attr_constraints.start || build_attr_constraints(db)) {
+        u32 v = attr->value, i;
+        // attributes created after the index are named by no constraint
+        if (v > attr_constraints.nprim)
+            return true;
+        for (i = attr_constraints.start[v];
+             i < attr_constraints.start[v + 1]; ++i) {
+            if (ebitmap_set_bit(&attr_constraints.exprs[i]->names,
+                        type->value - 1, 1))
+                ok = false;
+        }
+        goto out;
+    }
 
     struct hashtab_node *node;
     struct constraint_node *n;
@@ -709,12 +1029,18 @@ static void add_typeattribute_raw(struct policydb *db, struct type_datum *type,
                 if (e->expr_type == CEXPR_NAMES &&
                     ebitmap_get_bit(&e->type_names->types,
                             attr->value - 1)) {
-                    ebitmap_set_bit(&e->names,
-                            type->value - 1, 1);
+                    if (ebitmap_set_bit(&e->names,
+                                type->value - 1, 1))
+                        ok = false;
                 }
             }
         }
     };
+
+out:
+    if (!ok)
+        pr_err("add_typeattribute: set constraint names failed.\n");
+    return ok;
 }
 
 static bool add_typeattribute(struct policydb *db, const char *type,
@@ -738,8 +1064,31 @@ static bool add_typeattribute(struct policydb *db, const char *type,
         return false;
     }
 
-    add_typeattribute_raw(db, type_d, attr_d);
-    return true;
+    return add_typeattribute_raw(db, type_d, attr_d);
+}
+
+// latest_granting of the selinux_policy the caches above were built for.
+// Every policy load and boolean change bumps it, so unlike the policydb
+// address it can't come back for a different policy.
+static u32 cache_generation;
+
+void ksu_set_generation(u32 generation)
+{
+    if (generation == cache_generation)
+        return;
+    ksu_drop_caches();
+    cache_generation = generation;
+}
+
+void ksu_drop_caches(void)
+{
+    kfree(wildcard_attrs.attrs);
+    memset(&wildcard_attrs, 0, sizeof(wildcard_attrs));
+    kfree(attr_constraints.start);
+    kfree(attr_constraints.exprs);
+    memset(&attr_constraints, 0, sizeof(attr_constraints));
+    // the arrays themselves belong to the policy now
+    type_slots = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -755,6 +1104,43 @@ bool ksu_attribute(struct policydb *db, const char *name)
     return add_type(db, name, true);
 }
 
+// Whether ksu_type(db, name, attr) is bound to fail
+static bool type_decl_fails(struct policydb *db, const char *name,
+                const char *attr)
+{
+    struct type_datum *type = symtab_search(&db->p_types, name);
+    struct type_datum *attr_d = symtab_search(&db->p_types, attr);
+
+    return (type && type->attribute) || !attr_d || !attr_d->attribute;
+}
+
+u32 ksu_types(struct policydb *db, const char *const *names,
+          const char *const *attrs, u32 count, bool stop, bool *ok)
+{
+    u32 i;
+
+    // with stop the run ends at the first failing declaration, which is
+    // still applied like ksu_type() would
+    if (stop && attrs) {
+        for (i = 0; i < count; ++i) {
+            if (type_decl_fails(db, names[i], attrs[i])) {
+                count = i + 1;
+                break;
+            }
+        }
+    }
+
+    if (!add_types(db, names, count, !attrs)) {
+        for (i = 0; i < count; ++i)
+            ok[i] = false;
+        return count;
+    }
+
+    for (i = 0; i < count; ++i)
+        ok[i] = !attrs || add_typeattribute(db, names[i], attrs[i]);
+    return count;
+}
+
 bool ksu_permissive(struct policydb *db, const char *type)
 {
     return set_type_state(db, type, true);
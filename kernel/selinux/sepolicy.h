@@ -5,9 +5,21 @@
 
 #include "ss/policydb.h"
 
+// Caches built while patching are valid for one generation of the policy,
+// the latest_granting of its selinux_policy; call ksu_set_generation()
+// before patching, it drops them when the generation changed.
+// ksu_drop_caches() frees them.
+void ksu_set_generation(u32 generation);
+void ksu_drop_caches(void);
+
 // Operation on types
 bool ksu_type(struct policydb *db, const char *name, const char *attr);
 bool ksu_attribute(struct policydb *db, const char *name);
+// ksu_type() for each names[i] and attrs[i], or ksu_attribute() when attrs
+// is NULL, with a single add_types() call. ok[i] gets each result. With
+// stop the run ends at the first failure; returns how many were applied.
+u32 ksu_types(struct policydb *db, const char *const *names,
+          const char *const *attrs, u32 count, bool stop, bool *ok);
 bool ksu_permissive(struct policydb *db, const char *type);
 bool ksu_enforce(struct policydb *db, const char *type);
 bool ksu_typeattribute(struct policydb *db, const char *type, const char *attr);
@@ -38,6 +38,7 @@
 #include "supercalls.h"
 #include "syscall_hook_manager.h"
 #include "kernel_umount.h"
+#include "sucompat.h"
 
 static bool ksu_enhanced_security_enabled = false;
 
@@ -115,6 +116,8 @@ int ksu_handle_setresuid(uid_t ruid, uid_t euid, uid_t suid)
         ksu_seccomp_allow_cache(current->seccomp.filter, __NR_reboot);
         ksu_set_task_tracepoint_flag(current);
         spin_unlock_irq(&current->sighand->siglock);
+        // the manager is the most frequent su caller
+        ksu_sucompat_map_redirect();
         return 0;
     }
 
@@ -126,6 +129,7 @@ int ksu_handle_setresuid(uid_t ruid, uid_t euid, uid_t suid)
             spin_unlock_irq(&current->sighand->siglock);
         }
         ksu_set_task_tracepoint_flag(current);
+        ksu_sucompat_map_redirect();
     } else {
         ksu_clear_task_tracepoint_flag_if_needed(current);
     }
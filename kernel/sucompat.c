@@ -1,4 +1,11 @@
+#include <linux/anon_inodes.h>
 #include <linux/compiler_types.h>
+#include <linux/err.h>
+#include <linux/fcntl.h>
+#include <linux/hash.h>
+#include <linux/mman.h>
+#include <linux/slab.h>
+#include <linux/task_work.h>
 #include <linux/preempt.h>
 #include <linux/printk.h>
 #include <linux/mm.h>
@@ -13,6 +20,7 @@
 #include <linux/ptrace.h>
 
 #include "allowlist.h"
+#include "audit.h"
 #include "feature.h"
 #include "klog.h" // IWYU pragma: keep
 #include "ksud.h"
@@ -46,10 +54,114 @@ static const struct ksu_feature_handler su_compat_handler = {
     .set_handler = su_compat_feature_set,
 };
 
+/*
+ * The paths su is redirected to, kept in one read-only page. The manager
+ * and allowed apps get it mapped after their setresuid from zygote and the
+ * processes they fork inherit it, so a redirect is just a pointer into that
+ * mapping. Tasks without it (shells, children that exec'd something else)
+ * still get the path copied below their stack pointer.
+ */
+struct redirect_paths {
+    char sh[sizeof(SH_PATH)];
+    char ksud[sizeof(KSUD_PATH)];
+};
+
+static struct page *redirect_page;
+
+// Where the page is mapped for each uid. Only a hint: it is checked
+// against current->mm before use, so collisions and stale entries are fine.
+#define REDIRECT_ADDR_BITS 6
+static unsigned long redirect_addr[1 << REDIRECT_ADDR_BITS];
+
+static unsigned long *redirect_addr_slot(uid_t uid)
+{
+    return &redirect_addr[hash_32(uid, REDIRECT_ADDR_BITS)];
+}
+
+static int redirect_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    if (!redirect_page)
+        return -ENODEV;
+
+    if ((vma->vm_flags & VM_WRITE) || vma->vm_end - vma->vm_start != PAGE_SIZE)
+        return -EINVAL;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    return vm_insert_page(vma, vma->vm_start, redirect_page);
+}
+
+static const struct file_operations redirect_fops = {
+    .owner = THIS_MODULE,
+    .mmap = redirect_mmap,
+};
+
+static char __user *redirect_user_path(size_t offset)
+{
+    struct mm_struct *mm = current->mm;
+    struct vm_area_struct *vma;
+    unsigned long addr = READ_ONCE(*redirect_addr_slot(current_uid().val));
+    bool mapped;
+
+    if (!addr || !mm || !mmap_read_trylock(mm))
+        return NULL;
+
+    vma = find_vma(mm, addr);
+    mapped = vma && vma->vm_start == addr && vma->vm_file &&
+             vma->vm_file->f_op == &redirect_fops;
+    mmap_read_unlock(mm);
+
+    return mapped ? (char __user *)(addr + offset) : NULL;
+}
+
+static void map_redirect_paths(struct callback_head *cb)
+{
+    uid_t uid = current_uid().val;
+    struct file *file;
+    unsigned long addr;
+
+    kfree(cb);
+
+    file = anon_inode_getfile("[ksu_redirect]", &redirect_fops, NULL,
+                              O_RDONLY);
+    if (IS_ERR(file))
+        return;
+
+    // processes forked from zygote share its layout, so the address of the
+    // previous process of this uid is usually free here as well
+    addr = vm_mmap(file, READ_ONCE(*redirect_addr_slot(uid)), PAGE_SIZE,
+                   PROT_READ, MAP_SHARED, 0);
+    fput(file);
+    if (IS_ERR_VALUE(addr)) {
+        pr_warn("map redirect paths failed: %ld\n", (long)addr);
+        return;
+    }
+
+    WRITE_ONCE(*redirect_addr_slot(uid), addr);
+}
+
+void ksu_sucompat_map_redirect(void)
+{
+    struct callback_head *cb;
+
+    if (!redirect_page || !ksu_su_compat_enabled)
+        return;
+
+    cb = kzalloc(sizeof(*cb), GFP_ATOMIC);
+    if (!cb)
+        return;
+
+    init_task_work(cb, map_redirect_paths);
+    if (task_work_add(current, cb, TWA_RESUME))
+        kfree(cb);
+}
+
 static void __user *userspace_stack_buffer(const void *d, size_t len)
 {
-    // To avoid having to mmap a page in userspace, just write below the stack
-    // pointer.
+    // Without the redirect mapping, just write below the stack pointer.
     char __user *p = (void __user *)current_user_stack_pointer() - len;
 
     return copy_to_user(p, d, len) ? NULL : p;
@@ -57,32 +169,41 @@ static void __user *userspace_stack_buffer(const void *d, size_t len)
 
 static char __user *sh_user_path(void)
 {
-    static const char sh_path[] = "/system/bin/sh";
+    static const char sh_path[] = SH_PATH;
+    char __user *p = redirect_user_path(offsetof(struct redirect_paths, sh));
 
-    return userspace_stack_buffer(sh_path, sizeof(sh_path));
+    return likely(p) ? p : userspace_stack_buffer(sh_path, sizeof(sh_path));
 }
 
 static char __user *ksud_user_path(void)
 {
     static const char ksud_path[] = KSUD_PATH;
+    char __user *p = redirect_user_path(offsetof(struct redirect_paths, ksud));
 
-    return userspace_stack_buffer(ksud_path, sizeof(ksud_path));
+    return likely(p) ? p : userspace_stack_buffer(ksud_path, sizeof(ksud_path));
 }
 
-int ksu_handle_faccessat(int *dfd, const char __user **filename_user, int *mode,
-                         int *__unused_flags)
+// path holds the first sizeof(SU_PATH) + 1 bytes of a user filename,
+// zero padded, so "/system/bin/su" matches and "/system/bin/sux" does not.
+static __always_inline bool is_su_path(const char *path)
 {
     const char su[] = SU_PATH;
 
+    return !memcmp(path, su, sizeof(su));
+}
+
+int ksu_handle_faccessat(int *dfd, const char __user **filename_user, int *mode,
+                         int *__unused_flags)
+{
     if (!ksu_is_allow_uid_for_current(current_uid().val)) {
         return 0;
     }
 
-    char path[sizeof(su) + 1];
+    char path[sizeof(SU_PATH) + 1];
     memset(path, 0, sizeof(path));
     strncpy_from_user_nofault(path, *filename_user, sizeof(path));
 
-    if (unlikely(!memcmp(path, su, sizeof(su)))) {
+    if (unlikely(is_su_path(path))) {
         pr_info("faccessat su->sh!\n");
         *filename_user = sh_user_path();
     }
@@ -92,9 +213,6 @@ int ksu_handle_faccessat(int *dfd, const char __user **filename_user, int *mode,
 
 int ksu_handle_stat(int *dfd, const char __user **filename_user, int *flags)
 {
-    // const char sh[] = SH_PATH;
-    const char su[] = SU_PATH;
-
     if (!ksu_is_allow_uid_for_current(current_uid().val)) {
         return 0;
     }
@@ -103,11 +221,11 @@ int ksu_handle_stat(int *dfd, const char __user **filename_user, int *flags)
         return 0;
     }
 
-    char path[sizeof(su) + 1];
+    char path[sizeof(SU_PATH) + 1];
     memset(path, 0, sizeof(path));
     strncpy_from_user_nofault(path, *filename_user, sizeof(path));
 
-    if (unlikely(!memcmp(path, su, sizeof(su)))) {
+    if (unlikely(is_su_path(path))) {
         pr_info("newfstatat su->sh!\n");
         *filename_user = sh_user_path();
     }
@@ -115,20 +233,40 @@ int ksu_handle_stat(int *dfd, const char __user **filename_user, int *flags)
     return 0;
 }
 
+// Only reached when the filename page is not present, kept out of line.
+static noinline __cold long strncpy_from_user_rescue(char *dst,
+                                                     const char __user *src,
+                                                     long count)
+{
+    long ret;
+
+    /* This is crazy, but we know what we are doing:
+     * Temporarily exit atomic context to handle page faults, then restore it */
+    pr_info("Access filename failed, try rescue..\n");
+    preempt_enable_no_resched_notrace();
+    ret = strncpy_from_user(dst, src, count);
+    preempt_disable_notrace();
+
+    return ret;
+}
+
 int ksu_handle_execve_sucompat(const char __user **filename_user,
                                void *__never_use_argv, void *__never_use_envp,
                                int *__never_use_flags)
 {
-    const char su[] = SU_PATH;
     const char __user *fn;
-    char path[sizeof(su) + 1];
+    char path[sizeof(SU_PATH) + 1];
     long ret;
     unsigned long addr;
+    uid_t uid = current_uid().val;
+    bool allowed;
 
     if (unlikely(!filename_user))
         return 0;
 
-    if (!ksu_is_allow_uid_for_current(current_uid().val))
+    // root outside our domain (init) execs a lot and never asks for su
+    allowed = ksu_is_allow_uid_for_current(uid);
+    if (!allowed && uid == 0)
         return 0;
 
     addr = untagged_addr((unsigned long)*filename_user);
@@ -140,22 +278,23 @@ int ksu_handle_execve_sucompat(const char __user **filename_user,
         ret = strncpy_from_user_nofault(path, fn, sizeof(path));
     }
 
-    if (ret < 0 && preempt_count()) {
-        /* This is crazy, but we know what we are doing:
-         * Temporarily exit atomic context to handle page faults, then restore it */
-        pr_info("Access filename failed, try rescue..\n");
-        preempt_enable_no_resched_notrace();
-        ret = strncpy_from_user(path, fn, sizeof(path));
-        preempt_disable_notrace();
-    }
+    if (unlikely(ret < 0) && allowed && preempt_count())
+        ret = strncpy_from_user_rescue(path, fn, sizeof(path));
 
     if (ret < 0) {
-        pr_warn("Access filename when execve failed: %ld", ret);
+        // other uids cannot get su out of this exec anyway
+        if (allowed)
+            pr_warn("Access filename when execve failed: %ld", ret);
         return 0;
     }
 
-    if (likely(memcmp(path, su, sizeof(su))))
+    if (likely(!is_su_path(path)))
+        return 0;
+
+    if (!allowed) {
+        ksu_audit(KSU_AUDIT_SU_DENY, uid, KSU_AUDIT_VIA_EXECVE);
         return 0;
+    }
 
     pr_info("sys_execve su found\n");
     *filename_user = ksud_user_path();
@@ -168,12 +307,34 @@ int ksu_handle_execve_sucompat(const char __user **filename_user,
 // sucompat: permitted process can execute 'su' to gain root access.
 void ksu_sucompat_init()
 {
+    struct redirect_paths *paths;
+
     if (ksu_register_feature_handler(&su_compat_handler)) {
         pr_err("Failed to register su_compat feature handler\n");
     }
+
+    BUILD_BUG_ON(sizeof(struct redirect_paths) > PAGE_SIZE);
+    redirect_page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+    if (!redirect_page) {
+        pr_warn("alloc redirect page failed, su paths go on the stack\n");
+        return;
+    }
+    paths = page_address(redirect_page);
+    memcpy(paths->sh, SH_PATH, sizeof(paths->sh));
+    memcpy(paths->ksud, KSUD_PATH, sizeof(paths->ksud));
 }
 
 void ksu_sucompat_exit()
 {
     ksu_unregister_feature_handler(KSU_FEATURE_SU_COMPAT);
+
+    // processes that still map the page hold their own reference
+    if (redirect_page) {
+        put_page(redirect_page);
+        redirect_page = NULL;
+    }
 }
+
+#ifdef CONFIG_KSU_KUNIT_TEST
+#include "tests/sucompat_test.c"
+#endif
@@ -7,6 +7,9 @@ extern bool ksu_su_compat_enabled;
 void ksu_sucompat_init(void);
 void ksu_sucompat_exit(void);
 
+// Queue mapping the su redirect paths into current, for allowed apps
+void ksu_sucompat_map_redirect(void);
+
 // Handler functions exported for hook_manager
 int ksu_handle_faccessat(int *dfd, const char __user **filename_user,
 			 int *mode, int *__unused_flags);
@@ -15,6 +15,8 @@
 #include "supercalls.h"
 #include "arch.h"
 #include "allowlist.h"
+#include "audit.h"
+#include "event_queue.h"
 #include "feature.h"
 #include "klog.h" // IWYU pragma: keep
 #include "ksu.h"
@@ -100,6 +102,7 @@ static int do_report_event(void __user *arg)
             post_fs_data_lock = true;
             pr_info("post-fs-data triggered\n");
             on_post_fs_data();
+            ksu_event_emit(KSU_EVENT_POST_FS_DATA, 0);
         }
         break;
     }
@@ -112,12 +115,14 @@ static int do_report_event(void __user *arg)
 #endif
             pr_info("boot_complete triggered\n");
             on_boot_completed();
+            ksu_event_emit(KSU_EVENT_BOOT_COMPLETED, 0);
         }
         break;
     }
     case EVENT_MODULE_MOUNTED: {
         pr_info("module mounted!\n");
         on_module_mounted();
+        ksu_event_emit(KSU_EVENT_MODULE_MOUNTED, 0);
         break;
     }
     default:
@@ -287,6 +292,59 @@ static int do_set_app_profile(void __user *arg)
     return 0;
 }
 
+static int do_set_root_template(void __user *arg)
+{
+    struct ksu_set_root_template_cmd cmd;
+
+    if (copy_from_user(&cmd, arg, sizeof(cmd))) {
+        pr_err("set_root_template: copy_from_user failed\n");
+        return -EFAULT;
+    }
+    cmd.name[sizeof(cmd.name) - 1] = '\0';
+
+    if (cmd.remove) {
+        return ksu_remove_root_template(cmd.name) ? 0 : -ENOENT;
+    }
+
+    if (!ksu_set_root_template(cmd.name, &cmd.profile, true)) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int do_get_audit_fd(void __user *arg)
+{
+    struct ksu_get_audit_fd_cmd cmd = {};
+    int fd;
+
+    fd = ksu_audit_install_fd();
+    if (fd < 0) {
+        return fd;
+    }
+
+    cmd.fd = fd;
+    cmd.nr_cpus = nr_cpu_ids;
+    cmd.cpu_size = ksu_audit_cpu_size();
+
+    if (copy_to_user(arg, &cmd, sizeof(cmd))) {
+        pr_err("get_audit_fd: copy_to_user failed\n");
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+        close_fd(fd);
+#else
+        ksys_close(fd);
+#endif
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+static int do_get_event_fd(void __user *arg)
+{
+    return ksu_event_install_fd();
+}
+
 static int do_get_feature(void __user *arg)
 {
     struct ksu_get_feature_cmd cmd;
@@ -452,6 +510,19 @@ static int do_manage_mark(void __user *arg)
     return 0;
 }
 
+static int do_mark_stats(void __user *arg)
+{
+    struct ksu_mark_stats_cmd cmd;
+
+    ksu_get_mark_stats(&cmd);
+    if (copy_to_user(arg, &cmd, sizeof(cmd))) {
+        pr_err("mark_stats: copy_to_user failed\n");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
 static int do_nuke_ext4_sysfs(void __user *arg)
 {
     struct ksu_nuke_ext4_sysfs_cmd cmd;
@@ -587,6 +658,8 @@ static int add_try_umount(void __user *arg)
     return 0;
 }
 
+static int do_batch(void __user *arg);
+
 // IOCTL handlers mapping table
 static const struct ksu_ioctl_cmd_map ksu_ioctl_handlers[] = {
     { .cmd = KSU_IOCTL_GRANT_ROOT, .name = "GRANT_ROOT", .handler = do_grant_root, .perm_check = allowed_for_su },
@@ -607,9 +680,148 @@ static const struct ksu_ioctl_cmd_map ksu_ioctl_handlers[] = {
     { .cmd = KSU_IOCTL_MANAGE_MARK, .name = "MANAGE_MARK", .handler = do_manage_mark, .perm_check = manager_or_root },
     { .cmd = KSU_IOCTL_NUKE_EXT4_SYSFS, .name = "NUKE_EXT4_SYSFS", .handler = do_nuke_ext4_sysfs, .perm_check = manager_or_root },
     { .cmd = KSU_IOCTL_ADD_TRY_UMOUNT, .name = "ADD_TRY_UMOUNT", .handler = add_try_umount, .perm_check = manager_or_root },
+    { .cmd = KSU_IOCTL_BATCH, .name = "BATCH", .handler = do_batch, .perm_check = manager_or_root },
+    { .cmd = KSU_IOCTL_MARK_STATS, .name = "MARK_STATS", .handler = do_mark_stats, .perm_check = manager_or_root },
+    { .cmd = KSU_IOCTL_SET_ROOT_TEMPLATE, .name = "SET_ROOT_TEMPLATE", .handler = do_set_root_template, .perm_check = manager_or_root },
+    { .cmd = KSU_IOCTL_GET_AUDIT_FD, .name = "GET_AUDIT_FD", .handler = do_get_audit_fd, .perm_check = manager_or_root },
+    { .cmd = KSU_IOCTL_GET_EVENT_FD, .name = "GET_EVENT_FD", .handler = do_get_event_fd, .perm_check = manager_or_root },
     { .cmd = 0, .name = NULL, .handler = NULL, .perm_check = NULL } // Sentinel
 };
 
+static const struct ksu_ioctl_cmd_map *ksu_find_ioctl_handler(unsigned int cmd)
+{
+    int i;
+
+    for (i = 0; ksu_ioctl_handlers[i].handler; i++) {
+        if (cmd == ksu_ioctl_handlers[i].cmd)
+            return &ksu_ioctl_handlers[i];
+    }
+
+    return NULL;
+}
+
+// Apply the SET_SEPOLICY entry at entries[0] without touching the avc, along
+// with the declarations of the same kind right after it, so a module's run
+// of types shares one add_types() call. They pass the same only_root check
+// as the first. Results but the last are written back here, the last is
+// left in *result. Returns how many entries were applied, 0 on a fault.
+static u32 do_set_sepolicy_run(struct ksu_sepolicy_batch *batch,
+                               struct ksu_batch_entry __user *entries,
+                               u32 count, bool stop, s32 *result)
+{
+    void __user *args[KSU_SEPOLICY_RUN_MAX];
+    int results[KSU_SEPOLICY_RUN_MAX];
+    struct ksu_set_sepolicy_cmd cmd;
+    struct ksu_batch_entry entry;
+    u32 decl = 0, n, i;
+
+    count = min_t(u32, count, KSU_SEPOLICY_RUN_MAX);
+    for (n = 0; n < count; n++) {
+        if (copy_from_user(&entry, &entries[n], sizeof(entry)) ||
+            entry.cmd != KSU_IOCTL_SET_SEPOLICY ||
+            copy_from_user(&cmd, (void __user *)entry.arg, sizeof(cmd)))
+            break;
+        args[n] = (void __user *)cmd.arg;
+        if (!n && !(decl = ksu_sepolicy_decl_cmd(args[0]))) {
+            n = 1;
+            break;
+        }
+        if (n && ksu_sepolicy_decl_cmd(args[n]) != decl)
+            break;
+    }
+
+    if (!n) {
+        *result = -EFAULT;
+        return 1;
+    }
+
+    n = handle_sepolicy_decls(batch, args, n, stop, results);
+    for (i = 0; i + 1 < n; i++) {
+        if (put_user(results[i], &entries[i].result))
+            return 0;
+    }
+    *result = results[n - 1];
+    return n;
+}
+
+// Run several commands in one ioctl. Every entry goes through its own
+// permission check and reports its own result; sepolicy rules in the batch
+// share a single avc reset at the end.
+static int do_batch(void __user *arg)
+{
+    struct ksu_batch_cmd cmd;
+    struct ksu_batch_entry __user *entries;
+    struct ksu_batch_entry entry;
+    const struct ksu_ioctl_cmd_map *map;
+    struct ksu_sepolicy_batch sepolicy = {};
+    bool flush_avc = false;
+    int ret = 0;
+    u32 i;
+
+    if (copy_from_user(&cmd, arg, sizeof(cmd))) {
+        pr_err("batch: copy_from_user failed\n");
+        return -EFAULT;
+    }
+
+    if (cmd.count > KSU_BATCH_MAX) {
+        pr_err("batch: too many entries: %u\n", cmd.count);
+        return -E2BIG;
+    }
+
+    entries = (struct ksu_batch_entry __user *)cmd.entries;
+    for (i = 0; i < cmd.count; i++) {
+        if (copy_from_user(&entry, &entries[i], sizeof(entry))) {
+            ret = -EFAULT;
+            break;
+        }
+
+        map = ksu_find_ioctl_handler(entry.cmd);
+        if (!map || entry.cmd == KSU_IOCTL_BATCH) {
+            entry.result = -ENOTTY;
+        } else if (map->perm_check && !map->perm_check()) {
+            if (entry.cmd == KSU_IOCTL_GRANT_ROOT) {
+                ksu_audit(KSU_AUDIT_SU_DENY, current_uid().val, KSU_AUDIT_VIA_IOCTL);
+            }
+            entry.result = -EPERM;
+        } else {
+            if (entry.cmd == KSU_IOCTL_SET_SEPOLICY) {
+                u32 n = do_set_sepolicy_run(
+                    &sepolicy, &entries[i], cmd.count - i,
+                    cmd.flags & KSU_BATCH_STOP_ON_ERROR, &entry.result);
+                flush_avc = true;
+                if (!n) {
+                    ret = -EFAULT;
+                    break;
+                }
+                i += n - 1;
+            } else {
+                entry.result = map->handler((void __user *)entry.arg);
+            }
+        }
+
+        if (put_user(entry.result, &entries[i].result)) {
+            ret = -EFAULT;
+            break;
+        }
+
+        if (entry.result < 0 && (cmd.flags & KSU_BATCH_STOP_ON_ERROR)) {
+            i++;
+            break;
+        }
+    }
+
+    if (flush_avc)
+        ksu_flush_avc_cache(&sepolicy);
+
+    cmd.completed = i;
+    if (copy_to_user(arg, &cmd, sizeof(cmd))) {
+        pr_err("batch: copy_to_user failed\n");
+        return -EFAULT;
+    }
+
+    return ret;
+}
+
 struct ksu_install_fd_tw {
     struct callback_head cb;
     int __user *outp;
@@ -693,28 +905,30 @@ void ksu_supercalls_exit(void){
 static long anon_ksu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
     void __user *argp = (void __user *)arg;
-    int i;
+    const struct ksu_ioctl_cmd_map *map;
 
 #ifdef CONFIG_KSU_DEBUG
     pr_info("ksu ioctl: cmd=0x%x from uid=%d\n", cmd, current_uid().val);
 #endif
 
-    for (i = 0; ksu_ioctl_handlers[i].handler; i++) {
-        if (cmd == ksu_ioctl_handlers[i].cmd) {
-            // Check permission first
-            if (ksu_ioctl_handlers[i].perm_check &&
-                !ksu_ioctl_handlers[i].perm_check()) {
-                pr_warn("ksu ioctl: permission denied for cmd=0x%x uid=%d\n",
-                    cmd, current_uid().val);
-                return -EPERM;
-            }
-            // Execute handler
-            return ksu_ioctl_handlers[i].handler(argp);
+    map = ksu_find_ioctl_handler(cmd);
+    if (!map) {
+        pr_warn("ksu ioctl: unsupported command 0x%x\n", cmd);
+        return -ENOTTY;
+    }
+
+    // Check permission first
+    if (map->perm_check && !map->perm_check()) {
+        pr_warn("ksu ioctl: permission denied for cmd=0x%x uid=%d\n",
+            cmd, current_uid().val);
+        if (cmd == KSU_IOCTL_GRANT_ROOT) {
+            ksu_audit(KSU_AUDIT_SU_DENY, current_uid().val, KSU_AUDIT_VIA_IOCTL);
         }
+        return -EPERM;
     }
 
-    pr_warn("ksu ioctl: unsupported command 0x%x\n", cmd);
-    return -ENOTTY;
+    // Execute handler
+    return map->handler(argp);
 }
 
 // File release handler
@@ -89,6 +89,31 @@ struct ksu_manage_mark_cmd {
 #define KSU_MARK_UNMARK 3
 #define KSU_MARK_REFRESH 4
 
+struct ksu_mark_stats_cmd {
+    __u32 marked; // Output: marked user tasks, the sum of the categories below
+    __u32 init;
+    __u32 zygote; // zygote and its children before setresuid
+    __u32 ksu_domain; // root in the su domain
+    __u32 shell;
+    __u32 allowed; // allowed uids and the manager
+    __u32 other; // marked by hand or by another tracepoint user
+    __s32 tracepoint_reg_count; // Output: sys_enter users, 1 is just us
+    __aligned_u64 slow_path_syscalls; // Output: syscalls of marked tasks
+    __aligned_u64 hooked_syscalls; // Output: of those, the ones we handle
+};
+
+struct ksu_set_root_template_cmd {
+    char name[KSU_MAX_PACKAGE_NAME]; // Input: template id, as in rp_config.template_name
+    __u32 remove; // Input: 1 to remove the template, the profile is then ignored
+    struct root_profile profile; // Input: the shared root profile
+};
+
+struct ksu_get_audit_fd_cmd {
+    __s32 fd; // Output: read-only fd of the su audit rings, see audit.h
+    __u32 nr_cpus; // Output: number of per-cpu rings in the mapping
+    __u32 cpu_size; // Output: bytes of one ring, mmap nr_cpus * cpu_size
+};
+
 struct ksu_nuke_ext4_sysfs_cmd {
     __aligned_u64 arg; // Input: mnt pointer
 };
@@ -103,6 +128,21 @@ struct ksu_add_try_umount_cmd {
 #define KSU_UMOUNT_ADD 1   // add entry (path + flags)
 #define KSU_UMOUNT_DEL 2   // delete entry, strcmp
 
+struct ksu_batch_entry {
+    __u32 cmd; // Input: KSU_IOCTL_* of the sub command
+    __s32 result; // Output: return value of the sub command
+    __aligned_u64 arg; // Input: pointer to the sub command's struct
+};
+
+struct ksu_batch_cmd {
+    __aligned_u64 entries; // Input: pointer to struct ksu_batch_entry array
+    __u32 count; // Input: number of entries
+    __u32 flags; // Input: KSU_BATCH_*
+    __u32 completed; // Output: number of entries executed
+};
+
+#define KSU_BATCH_STOP_ON_ERROR (1 << 0) // stop at the first failing entry
+#define KSU_BATCH_MAX 1024
 
 // IOCTL command definitions
 #define KSU_IOCTL_GRANT_ROOT _IOC(_IOC_NONE, 'K', 1, 0)
@@ -123,6 +163,11 @@ struct ksu_add_try_umount_cmd {
 #define KSU_IOCTL_MANAGE_MARK _IOC(_IOC_READ|_IOC_WRITE, 'K', 16, 0)
 #define KSU_IOCTL_NUKE_EXT4_SYSFS _IOC(_IOC_WRITE, 'K', 17, 0)
 #define KSU_IOCTL_ADD_TRY_UMOUNT _IOC(_IOC_WRITE, 'K', 18, 0)
+#define KSU_IOCTL_BATCH _IOC(_IOC_READ|_IOC_WRITE, 'K', 19, 0)
+#define KSU_IOCTL_MARK_STATS _IOC(_IOC_READ, 'K', 20, 0)
+#define KSU_IOCTL_SET_ROOT_TEMPLATE _IOC(_IOC_WRITE, 'K', 21, 0)
+#define KSU_IOCTL_GET_AUDIT_FD _IOC(_IOC_READ, 'K', 22, 0)
+#define KSU_IOCTL_GET_EVENT_FD _IOC(_IOC_NONE, 'K', 23, 0) // returns a read-only fd of struct ksu_event
 
 // IOCTL handler types
 typedef int (*ksu_ioctl_handler_t)(void __user *arg);
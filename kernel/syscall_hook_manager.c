@@ -8,15 +8,18 @@
 #include <asm/syscall.h>
 #include <linux/ptrace.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 #include <trace/events/syscalls.h>
 
 #include "allowlist.h"
 #include "arch.h"
 #include "klog.h" // IWYU pragma: keep
+#include "manager.h"
 #include "syscall_hook_manager.h"
 #include "sucompat.h"
 #include "setuid_hook.h"
 #include "selinux/selinux.h"
+#include "supercalls.h"
 #include "util.h"
 
 // Tracepoint registration count management
@@ -25,6 +28,20 @@
 static int tracepoint_reg_count = 0;
 static DEFINE_SPINLOCK(tracepoint_reg_lock);
 
+// Syscalls that entered our sys_enter handler, i.e. made by marked tasks,
+// and the ones among them (or among kprobe hits) that we actually handle
+static DEFINE_PER_CPU(u64, slow_path_syscalls);
+static DEFINE_PER_CPU(u64, hooked_syscalls);
+
+static bool ksu_task_marked(struct task_struct *t)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+	return test_task_syscall_work(t, SYSCALL_TRACEPOINT);
+#else
+	return test_tsk_thread_flag(t, TIF_SYSCALL_TRACEPOINT);
+#endif
+}
+
 void ksu_clear_task_tracepoint_flag_if_needed(struct task_struct *t)
 {
 	unsigned long flags;
@@ -61,6 +78,23 @@ void ksu_unmark_all_process(void)
 	pr_info("hook_manager: unmark all user process done!\n");
 }
 
+// After boot zygote's setresuid is caught by a kprobe instead of its mark
+static bool zygote_setresuid_hooked;
+
+// Tasks whose su related syscalls we handle
+static bool ksu_should_mark_task(struct task_struct *t, const struct cred *cred)
+{
+	int uid = cred->uid.val;
+	bool ksu_root_process = uid == 0 && is_task_ksu_domain(cred);
+	bool is_zygote_process =
+		!READ_ONCE(zygote_setresuid_hooked) && is_zygote(cred);
+	bool is_shell = uid == 2000;
+	// before boot completed, we shall mark init for marking zygote
+	bool is_init = t->pid == 1;
+	return ksu_root_process || is_zygote_process || is_shell || is_init ||
+	       ksu_is_allow_uid(uid);
+}
+
 static void ksu_mark_running_process_locked()
 {
 	struct task_struct *p, *t;
@@ -71,14 +105,7 @@ static void ksu_mark_running_process_locked()
 		}
 		int uid = task_uid(t).val;
         const struct cred *cred = get_task_cred(t);
-		bool ksu_root_process =
-			uid == 0 && is_task_ksu_domain(cred);
-        bool is_zygote_process = is_zygote(cred);
-        bool is_shell = uid == 2000;
-        // before boot completed, we shall mark init for marking zygote
-        bool is_init = t->pid == 1;
-		if (ksu_root_process || is_zygote_process  || is_shell || is_init
-            || ksu_is_allow_uid(uid)) {
+		if (ksu_should_mark_task(t, cred)) {
 			ksu_set_task_tracepoint_flag(t);
 			pr_info("hook_manager: mark process: pid:%d, uid: %d, comm:%s\n",
 					t->pid, uid, t->comm);
@@ -95,6 +122,8 @@ static void ksu_mark_running_process_locked()
 void ksu_mark_running_process()
 {
 	unsigned long flags;
+	if (IS_ENABLED(CONFIG_KSU_SYSCALL_KPROBES))
+		return;
 	spin_lock_irqsave(&tracepoint_reg_lock, flags);
 	if (tracepoint_reg_count <= 1) {
 		ksu_mark_running_process_locked();
@@ -116,11 +145,7 @@ int ksu_get_task_mark(pid_t pid)
 	if (task) {
 		get_task_struct(task);
 		rcu_read_unlock();
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
-		marked = test_task_syscall_work(task, SYSCALL_TRACEPOINT) ? 1 : 0;
-#else
-		marked = test_tsk_thread_flag(task, TIF_SYSCALL_TRACEPOINT) ? 1 : 0;
-#endif
+		marked = ksu_task_marked(task) ? 1 : 0;
 		put_task_struct(task);
 	} else {
 		rcu_read_unlock();
@@ -157,7 +182,126 @@ int ksu_set_task_mark(pid_t pid, bool mark)
 	return ret;
 }
 
-#ifdef CONFIG_KRETPROBES
+void ksu_get_mark_stats(struct ksu_mark_stats_cmd *stats)
+{
+	struct task_struct *p, *t;
+	unsigned long flags;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread (p, t) {
+		if (!t->mm || !ksu_task_marked(t))
+			continue;
+		const struct cred *cred = get_task_cred(t);
+		int uid = cred->uid.val;
+		stats->marked++;
+		if (t->pid == 1)
+			stats->init++;
+		else if (is_zygote(cred))
+			stats->zygote++;
+		else if (uid == 0 && is_task_ksu_domain(cred))
+			stats->ksu_domain++;
+		else if (uid == 2000)
+			stats->shell++;
+		else if (ksu_is_allow_uid(uid) || uid == ksu_get_manager_uid())
+			stats->allowed++;
+		else
+			stats->other++;
+		put_cred(cred);
+	}
+	read_unlock(&tasklist_lock);
+
+	spin_lock_irqsave(&tracepoint_reg_lock, flags);
+	stats->tracepoint_reg_count = tracepoint_reg_count;
+	spin_unlock_irqrestore(&tracepoint_reg_lock, flags);
+
+	for_each_possible_cpu (cpu) {
+		stats->slow_path_syscalls += per_cpu(slow_path_syscalls, cpu);
+		stats->hooked_syscalls += per_cpu(hooked_syscalls, cpu);
+	}
+}
+
+#ifndef CONFIG_KSU_SYSCALL_KPROBES
+// Zygote is marked so that its children reach ksu_handle_setresuid, but that
+// sends every syscall of its preloading and forking down the slow path.
+// Once booted, a kprobe on the setresuid implementation catches the uid
+// transition of unmarked zygote tasks instead, and only children that end
+// up allowed get marked there.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 17, 0)
+#define SETRESUID_IMPL_SYMBOL "__sys_setresuid"
+#else
+#define SETRESUID_IMPL_SYMBOL "sys_setresuid"
+#endif
+
+static int zygote_setresuid_handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+	// zygote is handled here only, even when marked, since handling it
+	// may unmark it before this probe runs; sys_enter skips it
+	if (!is_zygote(current_cred()))
+		return 0;
+
+	this_cpu_inc(hooked_syscalls);
+	ksu_handle_setresuid((uid_t)PT_REGS_PARM1(regs),
+			     (uid_t)PT_REGS_PARM2(regs),
+			     (uid_t)PT_REGS_PARM3(regs));
+	return 0;
+}
+
+static struct kprobe zygote_setresuid_kp = {
+	.symbol_name = SETRESUID_IMPL_SYMBOL,
+	.pre_handler = zygote_setresuid_handler_pre,
+};
+
+void ksu_unmark_zygote(void)
+{
+	struct task_struct *p, *t;
+	unsigned long flags;
+	int ret, count = 0;
+
+	if (zygote_setresuid_hooked)
+		return;
+
+	ret = register_kprobe(&zygote_setresuid_kp);
+	pr_info("hook_manager: register %s kprobe: %d\n", SETRESUID_IMPL_SYMBOL,
+		ret);
+	if (ret)
+		return; // keep zygote marked
+
+	WRITE_ONCE(zygote_setresuid_hooked, true);
+
+	spin_lock_irqsave(&tracepoint_reg_lock, flags);
+	if (tracepoint_reg_count <= 1) {
+		read_lock(&tasklist_lock);
+		for_each_process_thread (p, t) {
+			if (!t->mm)
+				continue;
+			const struct cred *cred = get_task_cred(t);
+			if (is_zygote(cred)) {
+				ksu_clear_task_tracepoint_flag(t);
+				count++;
+			}
+			put_cred(cred);
+		}
+		read_unlock(&tasklist_lock);
+	}
+	spin_unlock_irqrestore(&tracepoint_reg_lock, flags);
+
+	pr_info("hook_manager: unmarked %d zygote tasks\n", count);
+}
+#else
+void ksu_unmark_zygote(void)
+{
+}
+#endif
+
+// Only the tracepoint backend needs to know about other tracepoint users
+#if defined(CONFIG_KRETPROBES) && !defined(CONFIG_KSU_SYSCALL_KPROBES)
+#define KSU_REGFUNC_KRETPROBES
+#endif
+
+#ifdef KSU_REGFUNC_KRETPROBES
 
 static struct kretprobe *init_kretprobe(const char *name,
 										kretprobe_handler_t handler)
@@ -261,7 +405,10 @@ int ksu_handle_init_mark_tracker(const char __user **filename_user)
         pr_info("ksu_handle_init_mark_tracker: %ld\n", ret);
     }
 
-    if (likely(strstr(path, "/app_process") == NULL && strstr(path, "/adbd") == NULL && strstr(path, "/ksud") == NULL)) {
+    // a restarted zygote needs no mark once its setresuid has a kprobe
+    if (likely((strstr(path, "/app_process") == NULL ||
+                READ_ONCE(zygote_setresuid_hooked)) &&
+               strstr(path, "/adbd") == NULL && strstr(path, "/ksud") == NULL)) {
 		pr_info("hook_manager: unmark %d exec %s", current->pid, path);
         ksu_clear_task_tracepoint_flag_if_needed(current);
     }
@@ -269,11 +416,103 @@ int ksu_handle_init_mark_tracker(const char __user **filename_user)
     return 0;
 }
 
-#ifdef CONFIG_HAVE_SYSCALL_TRACEPOINTS
+#ifdef CONFIG_KSU_SYSCALL_KPROBES
+// Each kprobe sits on a syscall wrapper, whose only argument is the user
+// pt_regs; writing there redirects the syscall like the tracepoint does.
+static int newfstatat_handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+	struct pt_regs *real_regs = PT_REAL_REGS(regs);
+	int *dfd = (int *)&PT_REGS_PARM1(real_regs);
+	const char __user **filename_user =
+		(const char __user **)&PT_REGS_PARM2(real_regs);
+	int *flags = (int *)&PT_REGS_SYSCALL_PARM4(real_regs);
+
+	this_cpu_inc(hooked_syscalls);
+	if (ksu_su_compat_enabled)
+		ksu_handle_stat(dfd, filename_user, flags);
+	return 0;
+}
+
+static int faccessat_handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+	struct pt_regs *real_regs = PT_REAL_REGS(regs);
+	int *dfd = (int *)&PT_REGS_PARM1(real_regs);
+	const char __user **filename_user =
+		(const char __user **)&PT_REGS_PARM2(real_regs);
+	int *mode = (int *)&PT_REGS_PARM3(real_regs);
+
+	this_cpu_inc(hooked_syscalls);
+	if (ksu_su_compat_enabled)
+		ksu_handle_faccessat(dfd, filename_user, mode, NULL);
+	return 0;
+}
+
+static int execve_handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+	struct pt_regs *real_regs = PT_REAL_REGS(regs);
+	const char __user **filename_user =
+		(const char __user **)&PT_REGS_PARM1(real_regs);
+
+	this_cpu_inc(hooked_syscalls);
+	// nothing is marked, so init's children need no tracking
+	if (ksu_su_compat_enabled)
+		ksu_handle_execve_sucompat(filename_user, NULL, NULL, NULL);
+	return 0;
+}
+
+static int setresuid_handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+	struct pt_regs *real_regs = PT_REAL_REGS(regs);
+
+	this_cpu_inc(hooked_syscalls);
+	// the tasks the tracepoint backend would have marked
+	if (!ksu_should_mark_task(current, current_cred()))
+		return 0;
+
+	ksu_handle_setresuid((uid_t)PT_REGS_PARM1(real_regs),
+			     (uid_t)PT_REGS_PARM2(real_regs),
+			     (uid_t)PT_REGS_PARM3(real_regs));
+	return 0;
+}
+
+static struct kprobe syscall_kps[] = {
+	{ .symbol_name = SYS_NEWFSTATAT_SYMBOL,
+	  .pre_handler = newfstatat_handler_pre },
+	{ .symbol_name = SYS_FACCESSAT_SYMBOL,
+	  .pre_handler = faccessat_handler_pre },
+	{ .symbol_name = SYS_EXECVE_SYMBOL, .pre_handler = execve_handler_pre },
+	{ .symbol_name = SYS_SETRESUID_SYMBOL,
+	  .pre_handler = setresuid_handler_pre },
+};
+static bool syscall_kps_registered[ARRAY_SIZE(syscall_kps)];
+
+static void register_syscall_kprobes(void)
+{
+	int i, ret;
+	for (i = 0; i < ARRAY_SIZE(syscall_kps); i++) {
+		ret = register_kprobe(&syscall_kps[i]);
+		syscall_kps_registered[i] = !ret;
+		pr_info("hook_manager: register %s kprobe: %d\n",
+			syscall_kps[i].symbol_name, ret);
+	}
+}
+
+static void unregister_syscall_kprobes(void)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(syscall_kps); i++) {
+		if (syscall_kps_registered[i])
+			unregister_kprobe(&syscall_kps[i]);
+		syscall_kps_registered[i] = false;
+	}
+}
+#elif defined(CONFIG_HAVE_SYSCALL_TRACEPOINTS)
 // Generic sys_enter handler that dispatches to specific handlers
 static void ksu_sys_enter_handler(void *data, struct pt_regs *regs, long id)
 {
+	this_cpu_inc(slow_path_syscalls);
 	if (unlikely(check_syscall_fastpath(id))) {
+		this_cpu_inc(hooked_syscalls);
 		if (ksu_su_compat_enabled) {
 			// Handle newfstatat
 			if (id == __NR_newfstatat) {
@@ -308,8 +547,10 @@ static void ksu_sys_enter_handler(void *data, struct pt_regs *regs, long id)
 			}
 		}
 
-        // Handle setresuid
-		if (id == __NR_setresuid) {
+        // Handle setresuid, zygote's is left to zygote_setresuid_kp
+		if (id == __NR_setresuid &&
+		    !(READ_ONCE(zygote_setresuid_hooked) &&
+		      is_zygote(current_cred()))) {
 			uid_t ruid = (uid_t)PT_REGS_PARM1(regs);
 			uid_t euid = (uid_t)PT_REGS_PARM2(regs);
 			uid_t suid = (uid_t)PT_REGS_PARM3(regs);
@@ -322,19 +563,21 @@ static void ksu_sys_enter_handler(void *data, struct pt_regs *regs, long id)
 
 void ksu_syscall_hook_manager_init(void)
 {
-	int ret;
+	int __maybe_unused ret;
 	pr_info("hook_manager: ksu_hook_manager_init called\n");
 
-#ifdef CONFIG_KRETPROBES
+#ifdef KSU_REGFUNC_KRETPROBES
 	// Register kretprobe for syscall_regfunc
 	syscall_regfunc_rp = init_kretprobe("syscall_regfunc", syscall_regfunc_handler);
 	// Register kretprobe for syscall_unregfunc
 	syscall_unregfunc_rp = init_kretprobe("syscall_unregfunc", syscall_unregfunc_handler);
 #endif
 
-#ifdef CONFIG_HAVE_SYSCALL_TRACEPOINTS
+#if defined(CONFIG_KSU_SYSCALL_KPROBES)
+	register_syscall_kprobes();
+#elif defined(CONFIG_HAVE_SYSCALL_TRACEPOINTS)
 	ret = register_trace_sys_enter(ksu_sys_enter_handler, NULL);
-#ifndef CONFIG_KRETPROBES
+#ifndef KSU_REGFUNC_KRETPROBES
 	ksu_mark_running_process_locked();
 #endif
 	if (ret) {
@@ -351,13 +594,21 @@ void ksu_syscall_hook_manager_init(void)
 void ksu_syscall_hook_manager_exit(void)
 {
 	pr_info("hook_manager: ksu_hook_manager_exit called\n");
-#ifdef CONFIG_HAVE_SYSCALL_TRACEPOINTS
+#if defined(CONFIG_KSU_SYSCALL_KPROBES)
+	unregister_syscall_kprobes();
+	pr_info("hook_manager: syscall kprobes unregistered\n");
+#elif defined(CONFIG_HAVE_SYSCALL_TRACEPOINTS)
 	unregister_trace_sys_enter(ksu_sys_enter_handler, NULL);
 	tracepoint_synchronize_unregister();
 	pr_info("hook_manager: sys_enter tracepoint unregistered\n");
 #endif
 
-#ifdef CONFIG_KRETPROBES
+#ifndef CONFIG_KSU_SYSCALL_KPROBES
+	if (zygote_setresuid_hooked)
+		unregister_kprobe(&zygote_setresuid_kp);
+#endif
+
+#ifdef KSU_REGFUNC_KRETPROBES
 	destroy_kretprobe(&syscall_regfunc_rp);
 	destroy_kretprobe(&syscall_unregfunc_rp);
 #endif
@@ -13,15 +13,24 @@ void ksu_syscall_hook_manager_exit(void);
 void ksu_mark_all_process(void);
 void ksu_unmark_all_process(void);
 void ksu_mark_running_process(void);
+// Hand zygote's uid transition to a narrower hook and drop its mark
+void ksu_unmark_zygote(void);
 
 // Per-task mark operations
 int ksu_get_task_mark(pid_t pid);
 int ksu_set_task_mark(pid_t pid, bool mark);
 
+// Census of marked tasks and hook counters
+struct ksu_mark_stats_cmd;
+void ksu_get_mark_stats(struct ksu_mark_stats_cmd *stats);
 
+
+// With CONFIG_KSU_SYSCALL_KPROBES the hooks are kprobes that every task
+// hits, so there is nothing to mark.
 static inline void ksu_set_task_tracepoint_flag(struct task_struct *t)
 {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+#if defined(CONFIG_KSU_SYSCALL_KPROBES)
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
     set_task_syscall_work(t, SYSCALL_TRACEPOINT);
 #else
     set_tsk_thread_flag(t, TIF_SYSCALL_TRACEPOINT);
@@ -30,7 +39,8 @@ static inline void ksu_set_task_tracepoint_flag(struct task_struct *t)
 
 static inline void ksu_clear_task_tracepoint_flag(struct task_struct *t)
 {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+#if defined(CONFIG_KSU_SYSCALL_KPROBES)
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
     clear_task_syscall_work(t, SYSCALL_TRACEPOINT);
 #else
     clear_tsk_thread_flag(t, TIF_SYSCALL_TRACEPOINT);
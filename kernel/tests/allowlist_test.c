@@ -0,0 +1,328 @@
+/*
+ * KUnit suites for allowlist.c, which includes this file when
+ * CONFIG_KSU_KUNIT_TEST is set so the tests can reset its static state.
+ * Every case starts from an empty allowlist, so only run them on a test
+ * kernel, see tests/.kunitconfig.
+ */
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#define TEST_APP_UID 10123
+// an app of secondary user 10, above BITMAP_UID_MAX
+#define TEST_HIGH_UID (10 * PER_USER_RANGE + TEST_APP_UID)
+
+static void allowlist_test_reset(void)
+{
+    ksu_allowlist_exit();
+    memset(allow_list_bitmap, 0, sizeof(allow_list_bitmap));
+    allow_list_pointer = 0;
+    ksu_allowlist_init();
+    ksu_invalidate_manager_uid();
+}
+
+static int allowlist_test_init(struct kunit *test)
+{
+    allowlist_test_reset();
+    return 0;
+}
+
+static void allowlist_test_exit(struct kunit *test)
+{
+    allowlist_test_reset();
+}
+
+static void fill_profile(struct app_profile *profile, const char *key,
+                         uid_t uid, bool allow_su)
+{
+    memset(profile, 0, sizeof(*profile));
+    profile->version = KSU_APP_PROFILE_VER;
+    strscpy(profile->key, key, sizeof(profile->key));
+    profile->current_uid = uid;
+    profile->allow_su = allow_su;
+    if (allow_su) {
+        profile->rp_config.use_default = false;
+        profile->rp_config.profile.uid = 2000;
+        profile->rp_config.profile.gid = 2000;
+        strscpy(profile->rp_config.profile.selinux_domain,
+                KSU_DEFAULT_SELINUX_DOMAIN,
+                sizeof(profile->rp_config.profile.selinux_domain));
+    } else {
+        profile->nrp_config.use_default = true;
+    }
+}
+
+static struct app_profile *test_profile(struct kunit *test, const char *key,
+                                        uid_t uid, bool allow_su)
+{
+    struct app_profile *profile = kunit_kmalloc(test, sizeof(*profile),
+                                                GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, profile);
+    fill_profile(profile, key, uid, allow_su);
+    return profile;
+}
+
+static void test_is_allow_uid(struct kunit *test)
+{
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_APP_UID, true),
+                                false));
+    KUNIT_EXPECT_TRUE(test, __ksu_is_allow_uid(TEST_APP_UID));
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(TEST_APP_UID + 1));
+
+    // revoking clears the bit again
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_APP_UID, false),
+                                false));
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(TEST_APP_UID));
+}
+
+static void test_is_allow_uid_high(struct kunit *test)
+{
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_HIGH_UID, true),
+                                false));
+    KUNIT_EXPECT_TRUE(test, __ksu_is_allow_uid(TEST_HIGH_UID));
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(TEST_HIGH_UID + 1));
+
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_HIGH_UID, false),
+                                false));
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(TEST_HIGH_UID));
+}
+
+static void test_is_allow_uid_special(struct kunit *test)
+{
+    // system uids below shell are never allowed, even with a profile
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "radio", 1001, true),
+                                false));
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(1001));
+
+    // the manager is allowed without a profile
+    ksu_set_manager_uid(TEST_APP_UID);
+    KUNIT_EXPECT_TRUE(test, __ksu_is_allow_uid(TEST_APP_UID));
+}
+
+static void test_set_app_profile(struct kunit *test)
+{
+    struct app_profile *profile = test_profile(test, "a", TEST_APP_UID, true);
+    struct app_profile *got =
+        kunit_kzalloc(test, sizeof(*got), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, got);
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+
+    // same key and uid overrides the profile
+    profile->rp_config.profile.uid = 1000;
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+    got->current_uid = TEST_APP_UID;
+    KUNIT_ASSERT_TRUE(test, ksu_get_app_profile(got));
+    KUNIT_EXPECT_EQ(test, got->rp_config.profile.uid, 1000);
+
+    // a shared uid resolves to the package added first
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "b", TEST_APP_UID, false),
+                                false));
+    memset(got, 0, sizeof(*got));
+    got->current_uid = TEST_APP_UID;
+    KUNIT_ASSERT_TRUE(test, ksu_get_app_profile(got));
+    KUNIT_EXPECT_STREQ(test, got->key, "a");
+
+    got->current_uid = TEST_APP_UID + 1;
+    KUNIT_EXPECT_FALSE(test, ksu_get_app_profile(got));
+}
+
+static void test_set_app_profile_invalid(struct kunit *test)
+{
+    struct app_profile *profile = test_profile(test, "a", TEST_APP_UID, true);
+
+    profile->rp_config.profile.groups_count = KSU_MAX_GROUPS + 1;
+    KUNIT_EXPECT_FALSE(test, ksu_set_app_profile(profile, false));
+
+    profile = test_profile(test, "a", TEST_APP_UID, true);
+    profile->rp_config.profile.selinux_domain[0] = '\0';
+    KUNIT_EXPECT_FALSE(test, ksu_set_app_profile(profile, false));
+
+    profile = test_profile(test, "a", TEST_APP_UID, true);
+    profile->version = KSU_APP_PROFILE_VER - 1;
+    KUNIT_EXPECT_FALSE(test, ksu_set_app_profile(profile, false));
+
+    KUNIT_EXPECT_FALSE(test, __ksu_is_allow_uid(TEST_APP_UID));
+}
+
+static void test_uid_should_umount(struct kunit *test)
+{
+    struct app_profile *profile;
+
+    // no profile: the default non root profile, umount
+    KUNIT_EXPECT_TRUE(test, ksu_uid_should_umount(TEST_APP_UID));
+
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_APP_UID, true),
+                                false));
+    KUNIT_EXPECT_FALSE(test, ksu_uid_should_umount(TEST_APP_UID));
+
+    profile = test_profile(test, "b", TEST_APP_UID + 1, false);
+    profile->nrp_config.use_default = false;
+    profile->nrp_config.profile.umount_modules = false;
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+    KUNIT_EXPECT_FALSE(test, ksu_uid_should_umount(TEST_APP_UID + 1));
+
+    // "$" replaces the default non root profile
+    profile = test_profile(test, "$", 9999, false);
+    profile->nrp_config.profile.umount_modules = false;
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+    KUNIT_EXPECT_FALSE(test, ksu_uid_should_umount(TEST_APP_UID + 2));
+
+    ksu_set_manager_uid(TEST_APP_UID + 3);
+    KUNIT_EXPECT_FALSE(test, ksu_uid_should_umount(TEST_APP_UID + 3));
+}
+
+static void test_get_root_profile(struct kunit *test)
+{
+    struct root_profile *got = kunit_kzalloc(test, sizeof(*got), GFP_KERNEL);
+    struct app_profile *profile;
+
+    KUNIT_ASSERT_NOT_NULL(test, got);
+
+    // no profile: the default root profile
+    ksu_get_root_profile(TEST_APP_UID, got);
+    KUNIT_EXPECT_EQ(test, got->uid, 0);
+    KUNIT_EXPECT_STREQ(test, got->selinux_domain, KSU_DEFAULT_SELINUX_DOMAIN);
+
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(
+                                test_profile(test, "a", TEST_APP_UID, true),
+                                false));
+    ksu_get_root_profile(TEST_APP_UID, got);
+    KUNIT_EXPECT_EQ(test, got->uid, 2000);
+
+    profile = test_profile(test, "b", TEST_APP_UID + 1, true);
+    profile->rp_config.use_default = true;
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+    ksu_get_root_profile(TEST_APP_UID + 1, got);
+    KUNIT_EXPECT_EQ(test, got->uid, 0);
+}
+
+static void test_get_root_profile_template(struct kunit *test)
+{
+    struct root_profile *got = kunit_kzalloc(test, sizeof(*got), GFP_KERNEL);
+    struct app_profile *profile = test_profile(test, "a", TEST_APP_UID, true);
+    struct app_profile *stored =
+        test_profile(test, "a", TEST_APP_UID, false);
+    struct root_profile template;
+
+    KUNIT_ASSERT_NOT_NULL(test, got);
+    strscpy(profile->rp_config.template_name, "t",
+            sizeof(profile->rp_config.template_name));
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+
+    memcpy(&template, &profile->rp_config.profile, sizeof(template));
+    template.uid = 1000;
+    KUNIT_ASSERT_TRUE(test, ksu_set_root_template("t", &template, false));
+    ksu_get_root_profile(TEST_APP_UID, got);
+    KUNIT_EXPECT_EQ(test, got->uid, 1000);
+
+    // the copy kept in the app profile follows the template
+    KUNIT_ASSERT_TRUE(test, ksu_get_app_profile(stored));
+    KUNIT_EXPECT_EQ(test, stored->rp_config.profile.uid, 1000);
+
+    // profiles set after the template link to it as well
+    profile->current_uid = TEST_APP_UID + 1;
+    strscpy(profile->key, "b", sizeof(profile->key));
+    KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+    ksu_get_root_profile(TEST_APP_UID + 1, got);
+    KUNIT_EXPECT_EQ(test, got->uid, 1000);
+}
+
+/*
+ * Timed cases, the results are in the KUnit log. Half of the profiles use
+ * uids of user 10, which are beyond the bitmap. Two in sixteen are
+ * allowed, which keeps the allowed uids of user 10 within allow_list_arr.
+ */
+static const int bench_sizes[] = { 10, 1000, 10000 };
+
+static void bench_size_desc(const int *size, char *desc)
+{
+    snprintf(desc, KUNIT_PARAM_DESC_SIZE, "%d profiles", *size);
+}
+
+KUNIT_ARRAY_PARAM(bench_size, bench_sizes, bench_size_desc);
+
+static uid_t bench_uid(int i)
+{
+    return (i & 1 ? 10 * PER_USER_RANGE : 0) + FIRST_APPLICATION_UID + i / 2;
+}
+
+static void bench_allowlist(struct kunit *test)
+{
+    const int n = *(const int *)test->param_value;
+    struct app_profile *profile = test_profile(test, "", 0, false);
+    struct root_profile *root = kunit_kzalloc(test, sizeof(*root), GFP_KERNEL);
+    int i, expected = 0, allowed = 0, umount = 0, granted = 0;
+    u64 start, set_ns, allow_ns, umount_ns, root_ns;
+    char key[32];
+
+    KUNIT_ASSERT_NOT_NULL(test, root);
+
+    start = ktime_get_ns();
+    for (i = 0; i < n; i++) {
+        bool allow_su = i % 16 < 2;
+
+        snprintf(key, sizeof(key), "bench.pkg%d", i);
+        fill_profile(profile, key, bench_uid(i), allow_su);
+        KUNIT_ASSERT_TRUE(test, ksu_set_app_profile(profile, false));
+        expected += allow_su;
+    }
+    set_ns = ktime_get_ns() - start;
+
+    start = ktime_get_ns();
+    for (i = 0; i < n; i++)
+        allowed += __ksu_is_allow_uid(bench_uid(i));
+    allow_ns = ktime_get_ns() - start;
+
+    start = ktime_get_ns();
+    for (i = 0; i < n; i++)
+        umount += ksu_uid_should_umount(bench_uid(i));
+    umount_ns = ktime_get_ns() - start;
+
+    start = ktime_get_ns();
+    for (i = 0; i < n; i++) {
+        ksu_get_root_profile(bench_uid(i), root);
+        granted += root->uid == 2000;
+    }
+    root_ns = ktime_get_ns() - start;
+
+    KUNIT_EXPECT_EQ(test, allowed, expected);
+    KUNIT_EXPECT_EQ(test, umount, n - expected);
+    KUNIT_EXPECT_EQ(test, granted, expected);
+
+    kunit_info(test,
+               "%d profiles: set %llu ns, is_allow_uid %llu ns, "
+               "uid_should_umount %llu ns, get_root_profile %llu ns per call\n",
+               n, div_u64(set_ns, n), div_u64(allow_ns, n),
+               div_u64(umount_ns, n), div_u64(root_ns, n));
+}
+
+static struct kunit_case allowlist_test_cases[] = {
+    KUNIT_CASE(test_is_allow_uid),
+    KUNIT_CASE(test_is_allow_uid_high),
+    KUNIT_CASE(test_is_allow_uid_special),
+    KUNIT_CASE(test_set_app_profile),
+    KUNIT_CASE(test_set_app_profile_invalid),
+    KUNIT_CASE(test_uid_should_umount),
+    KUNIT_CASE(test_get_root_profile),
+    KUNIT_CASE(test_get_root_profile_template),
+    KUNIT_CASE_PARAM(bench_allowlist, bench_size_gen_params),
+    {}
+};
+
+static struct kunit_suite allowlist_test_suite = {
+    .name = "ksu_allowlist",
+    .init = allowlist_test_init,
+    .exit = allowlist_test_exit,
+    .test_cases = allowlist_test_cases,
+};
+
+kunit_test_suite(allowlist_test_suite);
@@ -0,0 +1,55 @@
+#include <openssl/sha.h>
+
+#include "apk_parse.h"
+#include "apk_tail.h"
+
+int ksu_sha256(const unsigned char *data, unsigned int datalen,
+               unsigned char *digest)
+{
+    SHA256(data, datalen, digest);
+    return 0;
+}
+
+bool apk_tail_check(const uint8_t *data, size_t size, unsigned expected_size,
+                    const char *expected_sha256)
+{
+    size_t tail = size < EOCD_MAX_COMMENT + EOCD_SIZE ?
+                      size :
+                      EOCD_MAX_COMMENT + EOCD_SIZE;
+    const u8 *footer, *eocd_p;
+    struct apk_sig_info info;
+    u64 base, cd, block_size;
+    long eocd;
+
+    eocd = find_eocd(data + size - tail, tail);
+    if (eocd < 0)
+        return false;
+    eocd_p = data + size - tail + eocd;
+
+    // the EOCD follows the central directory, which tells where data
+    // starts in the file
+    base = (u64)load_u32(eocd_p + 16) + load_u32(eocd_p + 12);
+    if (base < (u64)(eocd_p - data))
+        return false;
+    base -= eocd_p - data;
+    if (load_u32(eocd_p + 16) < base)
+        return false;
+    cd = load_u32(eocd_p + 16) - base;
+
+    // the same checks as check_v2_signature, on file offsets within data
+    if (cd < 24 || cd > size)
+        return false;
+    footer = data + cd - 24;
+    if (memcmp(footer + 8, APK_SIG_BLOCK_MAGIC, 16))
+        return false;
+
+    block_size = load_u64(footer) + 8;
+    if (block_size > cd || block_size > SIG_BLOCK_MAX_SIZE)
+        return false;
+
+    if (!parse_signing_block(data + cd - block_size, block_size, &info) ||
+        info.v3_exist || info.v2_blocks != 1)
+        return false;
+
+    return check_cert(info.cert, info.cert_size, expected_size, expected_sha256);
+}
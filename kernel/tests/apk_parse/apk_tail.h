@@ -0,0 +1,29 @@
+#ifndef APK_PARSE_APK_TAIL_H
+#define APK_PARSE_APK_TAIL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The manager's certificate, the defaults of kernel/Makefile
+#ifndef EXPECTED_SIZE
+#define EXPECTED_SIZE 0x0385
+#endif
+#ifndef EXPECTED_HASH
+#define EXPECTED_HASH "b10b03393e1f7df49a6dcd97cdb6478fb19cb5efd2024841be1129fd807697ed"
+#endif
+
+/*
+ * check_v2_signature over a buffer: data is the end of an APK, at least
+ * its signing block, central directory and EOCD. The v1 manifest check
+ * needs the start of the file and is left out.
+ */
+bool apk_tail_check(const uint8_t *data, size_t size, unsigned expected_size,
+                    const char *expected_sha256);
+
+static inline bool apk_tail_is_manager(const uint8_t *data, size_t size)
+{
+    return apk_tail_check(data, size, EXPECTED_SIZE, EXPECTED_HASH);
+}
+
+#endif
@@ -0,0 +1,88 @@
+//
+// Throughput of the APK signing block parsers over a corpus of APK tails.
+// Prints the verdict for every file, so a rewritten parser can be checked
+// against the current one on the same corpus.
+// Usage: apk_parse_bench [-t seconds per file] file...
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "apk_tail.h"
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *buf = NULL;
+    long len;
+
+    if (!fp)
+        return NULL;
+    if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) >= 0 &&
+        fseek(fp, 0, SEEK_SET) == 0) {
+        // one spare byte, malloc(0) may return NULL
+        buf = malloc(len + 1);
+        if (buf && fread(buf, 1, len, fp) != (size_t)len) {
+            free(buf);
+            buf = NULL;
+        }
+        *size = len;
+    }
+    fclose(fp);
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    double budget = 0.2, total_time = 0;
+    unsigned long long total_bytes = 0;
+    int i = 1, files = 0;
+
+    if (argc > 2 && !strcmp(argv[1], "-t")) {
+        budget = atof(argv[2]);
+        i = 3;
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-t seconds] file...\n", argv[0]);
+        return 1;
+    }
+
+    for (; i < argc; i++) {
+        unsigned long iterations = 0;
+        double start, elapsed;
+        bool manager = false;
+        size_t size;
+        uint8_t *data = read_file(argv[i], &size);
+
+        if (!data) {
+            perror(argv[i]);
+            return 1;
+        }
+
+        start = now();
+        do {
+            manager = apk_tail_is_manager(data, size);
+            iterations++;
+        } while ((elapsed = now() - start) < budget);
+
+        printf("%-40s %-8s %10.0f ns %10.1f MB/s\n", argv[i],
+               manager ? "manager" : "reject", elapsed / iterations * 1e9,
+               size * (double)iterations / elapsed / 1e6);
+        total_bytes += size * (unsigned long long)iterations;
+        total_time += elapsed;
+        files++;
+        free(data);
+    }
+
+    printf("%d files, %.1f MB/s overall\n", files, total_bytes / total_time / 1e6);
+    return 0;
+}
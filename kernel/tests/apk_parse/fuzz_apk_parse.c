@@ -0,0 +1,9 @@
+// libFuzzer target for the APK signing block parsers in kernel/apk_parse.c.
+// Seed it with the corpus from gen_corpus.py, see the Makefile.
+#include "apk_tail.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    apk_tail_is_manager(data, size);
+    return 0;
+}
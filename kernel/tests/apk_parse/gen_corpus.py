@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Write a seed corpus of APK tails for apk_parse_fuzz and apk_parse_bench.
+
+Every file is the end of an APK: the signing block, the central directory
+and the EOCD record. Well formed ones use --cert as the v2 certificate, so
+the manager's certificate gives an accepted case. Add tails of real APKs
+next to them with `tail -c 2M app.apk > corpus/real-app`.
+"""
+
+import argparse
+import os
+import struct
+
+V2_ID = 0x7109871A
+V3_ID = 0xF05368C0
+V3_1_ID = 0x1B93AD61
+MAGIC = b"APK Sig Block 42"
+
+
+def v2_value(cert, digests=b"\0" * 40, cert_len=None, digests_len=None):
+    certs = struct.pack("<I", len(cert) if cert_len is None else cert_len) + cert
+    signed = (
+        struct.pack("<I", len(digests) if digests_len is None else digests_len)
+        + digests
+        + struct.pack("<I", len(certs))
+        + certs
+    )
+    signer = struct.pack("<I", len(signed)) + signed
+    return struct.pack("<II", len(signer) + 4, len(signer)) + signer
+
+
+def pair(block_id, value, length=None):
+    body = struct.pack("<I", block_id) + value
+    return struct.pack("<Q", len(body) if length is None else length) + body
+
+
+def signing_block(pairs, lead=None, trail=None):
+    body = b"".join(pairs)
+    size = len(body) + 8 + 16
+    return (
+        struct.pack("<Q", size if lead is None else lead)
+        + body
+        + struct.pack("<Q", size if trail is None else trail)
+        + MAGIC
+    )
+
+
+def apk_tail(block, comment=b"", cd=b"PK\x01\x02" + b"\0" * 42):
+    # the tail starts at file offset 0, so the block ends at the cd offset
+    eocd = struct.pack(
+        "<IHHHHIIH", 0x06054B50, 0, 0, 1, 1, len(cd), len(block), len(comment)
+    )
+    return block + cd + eocd + comment
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("out", help="corpus directory")
+    parser.add_argument("--cert", help="DER certificate for the v2 signer")
+    args = parser.parse_args()
+
+    cert = b"\x30\x82" + bytes(range(256)) * 3 + b"\0" * 131  # 0x385 bytes
+    if args.cert:
+        with open(args.cert, "rb") as f:
+            cert = f.read()
+
+    v2 = pair(V2_ID, v2_value(cert))
+    cases = {
+        "v2": apk_tail(signing_block([v2])),
+        "v2_comment": apk_tail(signing_block([v2]), comment=b"c" * 5000),
+        "v2_padding": apk_tail(signing_block([pair(0x42726577, b"\0" * 4096), v2])),
+        "v2_and_v3": apk_tail(signing_block([v2, pair(V3_ID, b"\0" * 64)])),
+        "v2_and_v3_1": apk_tail(signing_block([v2, pair(V3_1_ID, b"\0" * 64)])),
+        "two_v2": apk_tail(signing_block([v2, v2])),
+        "many_pairs": apk_tail(signing_block([pair(1, b"\0" * 8)] * 20 + [v2])),
+        "size_mismatch": apk_tail(signing_block([v2], trail=1)),
+        "block_too_big": apk_tail(signing_block([v2], lead=1 << 40, trail=1 << 40)),
+        "pair_overflow": apk_tail(
+            signing_block([pair(V2_ID, v2_value(cert), length=(1 << 64) - 1)])
+        ),
+        "cert_overflow": apk_tail(
+            signing_block([pair(V2_ID, v2_value(cert, cert_len=0xFFFFFFFF))])
+        ),
+        "digests_overflow": apk_tail(
+            signing_block([pair(V2_ID, v2_value(cert, digests_len=0xFFFFFFF0))])
+        ),
+        "short_v2": apk_tail(signing_block([pair(V2_ID, b"\0" * 8)])),
+        "no_block": apk_tail(b"\0" * 64),
+        "no_eocd": signing_block([v2]) + b"\0" * 64,
+        "empty": b"",
+    }
+
+    os.makedirs(args.out, exist_ok=True)
+    for name, data in cases.items():
+        with open(os.path.join(args.out, name), "wb") as f:
+            f.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#ifndef APK_PARSE_SHIM_KERNEL_H
+#define APK_PARSE_SHIM_KERNEL_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+static inline char *bin2hex(char *dst, const void *src, size_t count)
+{
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *p = src;
+
+    while (count--) {
+        *dst++ = hex[*p >> 4];
+        *dst++ = hex[*p++ & 0xf];
+    }
+    return dst;
+}
+
+// decimal only, with an optional trailing newline like the kernel's
+static inline int kstrtou32(const char *s, unsigned int base, uint32_t *res)
+{
+    uint64_t v = 0;
+
+    if (base != 10 || !*s)
+        return -EINVAL;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        v = v * 10 + (*s - '0');
+        if (v > UINT32_MAX)
+            return -ERANGE;
+    }
+    if (*s == '\n')
+        s++;
+    if (*s)
+        return -EINVAL;
+    *res = v;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef APK_PARSE_SHIM_PRINTK_H
+#define APK_PARSE_SHIM_PRINTK_H
+
+#include <stdio.h>
+
+#define pr_fmt(fmt) fmt
+
+// quiet unless APK_PARSE_VERBOSE, logging would dominate fuzz and bench runs
+#ifdef APK_PARSE_VERBOSE
+#define pr_info(fmt, ...) fprintf(stderr, pr_fmt(fmt), ##__VA_ARGS__)
+#else
+#define pr_info(fmt, ...)                                \
+    do {                                                 \
+        if (0)                                           \
+            fprintf(stderr, pr_fmt(fmt), ##__VA_ARGS__); \
+    } while (0)
+#endif
+#define pr_err(fmt, ...) fprintf(stderr, pr_fmt(fmt), ##__VA_ARGS__)
+
+#endif
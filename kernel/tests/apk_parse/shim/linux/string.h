@@ -0,0 +1,22 @@
+#ifndef APK_PARSE_SHIM_STRING_H
+#define APK_PARSE_SHIM_STRING_H
+
+#include <string.h>
+#include <sys/types.h>
+
+static inline ssize_t strscpy(char *dst, const char *src, size_t count)
+{
+    size_t len = strnlen(src, count);
+
+    if (!count)
+        return -1;
+    if (len == count) {
+        memcpy(dst, src, count - 1);
+        dst[count - 1] = '\0';
+        return -1;
+    }
+    memcpy(dst, src, len + 1);
+    return len;
+}
+
+#endif
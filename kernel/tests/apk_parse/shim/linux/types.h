@@ -0,0 +1,21 @@
+// Userspace stand-in for the kernel headers the host builds use
+#ifndef APK_PARSE_SHIM_TYPES_H
+#define APK_PARSE_SHIM_TYPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef long long s64;
+
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef unsigned long long __u64;
+
+#endif
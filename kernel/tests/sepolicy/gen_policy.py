@@ -0,0 +1,355 @@
+#!/usr/bin/env python3
+"""Write a synthetic Android-like binary sepolicy and module rules for
+sepolicy_bench.
+
+The policy is compiled from CIL with libsepol.so.2. It has the types,
+attributes and classes apply_kernelsu_rules() uses, --types more types split
+between domains and files, attribute rules that are kept as attributes, MLS
+constraints on attributes, conditional rules, name transitions, xperms and
+ocontexts, so every part of the policy the patcher touches is there. The
+module rules are in ksud syntax with runs of type declarations, as modules
+write them. A real policy works as well: `adb pull /sys/fs/selinux/policy`.
+"""
+
+import argparse
+import ctypes
+import ctypes.util
+import os
+import random
+
+COMMONS = {
+    "file": "ioctl read write create getattr setattr lock relabelfrom "
+    "relabelto append map unlink link rename execute quotaon mounton "
+    "audit_access open execmod watch watch_mount watch_sb watch_with_perm "
+    "watch_reads",
+    "socket": "ioctl read write create getattr setattr lock relabelfrom "
+    "relabelto append map bind connect listen accept getopt setopt shutdown "
+    "recvfrom sendto name_bind",
+    "cap": "chown dac_override dac_read_search fowner fsetid kill setgid "
+    "setuid setpcap linux_immutable net_bind_service net_broadcast net_admin "
+    "net_raw ipc_lock ipc_owner sys_module sys_rawio sys_chroot sys_ptrace "
+    "sys_pacct sys_admin sys_boot sys_nice sys_resource sys_time "
+    "sys_tty_config mknod lease audit_write audit_control setfcap",
+}
+
+# class: (common, own permissions)
+CLASSES = {
+    "file": ("file", "execute_no_trans entrypoint"),
+    "dir": ("file", "add_name remove_name reparent search rmdir"),
+    "lnk_file": ("file", ""),
+    "chr_file": ("file", ""),
+    "blk_file": ("file", ""),
+    "sock_file": ("file", ""),
+    "fifo_file": ("file", ""),
+    "fd": (None, "use"),
+    "process": (
+        None,
+        "fork transition sigchld sigkill sigstop signull signal ptrace "
+        "getsched setsched getsession getpgid setpgid getcap setcap share "
+        "getattr setexec setfscreate noatsecure siginh setrlimit rlimitinh "
+        "dyntransition setcurrent execmem execstack execheap setkeycreate "
+        "setsockcreate getrlimit",
+    ),
+    "capability": ("cap", ""),
+    "capability2": (
+        None,
+        "mac_override mac_admin syslog wake_alarm block_suspend audit_read "
+        "perfmon bpf checkpoint_restore",
+    ),
+    "binder": (None, "impersonate call set_context_mgr transfer"),
+    "filesystem": (
+        None,
+        "mount remount unmount getattr relabelfrom relabelto associate "
+        "quotamod quotaget watch",
+    ),
+    "security": (
+        None,
+        "compute_av compute_create compute_member check_context load_policy "
+        "compute_relabel compute_user setenforce setbool setsecparam "
+        "setcheckreqprot read_policy validate_trans",
+    ),
+    "tcp_socket": ("socket", "node_bind name_connect"),
+    "udp_socket": ("socket", "node_bind"),
+    "unix_stream_socket": ("socket", "connectto"),
+    "unix_dgram_socket": ("socket", ""),
+    "netlink_socket": ("socket", ""),
+    "service_manager": (None, "add find list"),
+    "property_service": (None, "set"),
+}
+
+# Android has about 130 classes, most of them sockets
+EXTRA_CLASSES = 100
+
+DOMAINS = [
+    "kernel", "su", "init", "zygote", "system_server", "servicemanager",
+    "hwservicemanager", "logd", "shell", "adbd", "vold", "untrusted_app",
+    "platform_app", "priv_app", "system_app",
+]
+FILES = [
+    "adb_data_file", "apk_data_file", "shell_data_file",
+    "packages_list_file", "system_data_file", "system_file", "rootfs",
+    "proc", "sysfs", "device", "null_device", "app_data_file", "tmpfs",
+    "labeledfs", "port", "node", "netif", "unlabeled", "fuse",
+]
+ATTRIBUTES = [
+    "domain", "file_type", "fs_type", "dev_type", "exec_type", "data_file_type",
+    "system_file_type", "mlstrustedsubject", "mlstrustedobject", "netdomain",
+    "bluetoothdomain", "appdomain", "coredomain", "binderservicedomain",
+    "untrusted_app_all", "proc_type", "sysfs_type", "app_data_file_type",
+]
+FILE_CLASSES = ["file", "dir", "lnk_file", "chr_file", "blk_file",
+                "sock_file", "fifo_file"]
+
+
+def perms(cls):
+    common, own = CLASSES.get(cls, ("socket", ""))
+    return (COMMONS[common].split() if common else []) + own.split()
+
+
+def some(rng, items, lo, hi):
+    return rng.sample(items, min(len(items), rng.randint(lo, hi)))
+
+
+def cil_policy(ntypes, rng):
+    out = []
+    add = out.append
+    for name, ps in COMMONS.items():
+        add(f"(common {name} ({ps}))")
+    classes = dict(CLASSES)
+    for i in range(EXTRA_CLASSES):
+        classes[f"socket_{i}"] = ("socket", "")
+    for name, (common, own) in classes.items():
+        add(f"(class {name} ({own}))")
+        if common:
+            add(f"(classcommon {name} {common})")
+    add(f"(classorder ({' '.join(classes)}))")
+
+    add("(mls true)")
+    add("(handleunknown allow)")
+    add("(sensitivity s0)")
+    add("(sensitivityorder (s0))")
+    cats = " ".join(f"c{i}" for i in range(256))
+    for i in range(256):
+        add(f"(category c{i})")
+    add(f"(categoryorder ({cats}))")
+    add("(sensitivitycategory s0 (range c0 c255))")
+    add("(user u)")
+    add("(role r)")
+    add("(role object_r)")
+    add("(userrole u object_r)")
+    add("(userrole u r)")
+    add("(userlevel u (s0))")
+    add("(userrange u ((s0) (s0 (range c0 c255))))")
+    for sid in ("kernel", "security", "unlabeled", "file", "port", "node",
+                "netif"):
+        add(f"(sid {sid})")
+    add("(sidorder (kernel security unlabeled file port node netif))")
+
+    domains = list(DOMAINS) + [f"dom_{i}" for i in range(ntypes // 6)]
+    files = list(FILES) + [
+        f"file_{i}" for i in range(ntypes - len(domains) - len(FILES))
+    ]
+    attrs = list(ATTRIBUTES) + [f"attr_{i}" for i in range(ntypes // 12)]
+    for t in domains + files:
+        add(f"(type {t})")
+    for a in attrs:
+        add(f"(typeattribute {a})")
+    add("(roletype r domain)")
+    add("(roletype object_r file_type)")
+
+    members = {a: set() for a in attrs}
+    members["domain"].update(domains)
+    members["file_type"].update(files)
+    members["mlstrustedsubject"].update(
+        ["kernel", "init", "zygote", "system_server", "vold"])
+    members["mlstrustedobject"].update(some(rng, files, 10, 40))
+    members["netdomain"].update(some(rng, domains, len(domains) // 3,
+                                     len(domains) // 2))
+    members["bluetoothdomain"].update(some(rng, domains, 3, 10))
+    members["appdomain"].update(
+        ["untrusted_app", "platform_app", "priv_app", "system_app"])
+    members["coredomain"].update(some(rng, domains, len(domains) // 2,
+                                      len(domains)))
+    for a in attrs:
+        pool = domains if a.endswith("domain") or a.startswith("untrusted") \
+            else files
+        if len(members[a]) < 2:
+            members[a].update(some(rng, pool, 2, max(2, len(pool) // 20)))
+    for a, ts in members.items():
+        add(f"(typeattributeset {a} ({' '.join(sorted(ts))}))")
+
+    subjects = domains + [a for a in attrs if a.endswith("domain")]
+    objects = files + domains + attrs
+    class_names = list(classes)
+
+    def allow(kind, src, tgt, cls, ps):
+        add(f"({kind} {src} {tgt} ({cls} ({' '.join(ps)})))")
+
+    # every attribute is used, else CIL drops it from the binary
+    for a in attrs:
+        allow("allow", "domain", a, "dir", ["search", "getattr"])
+    for d in domains:
+        allow("allow", d, d, "process", ["fork", "sigchld", "getattr"])
+        allow("allow", d, d, "fd", ["use"])
+        for _ in range(rng.randint(8, 24)):
+            cls = rng.choice(FILE_CLASSES if rng.random() < 0.7
+                             else class_names)
+            allow("allow", d, rng.choice(objects), cls,
+                  some(rng, perms(cls), 1, 6))
+        if rng.random() < 0.2:
+            allow("dontaudit", d, rng.choice(objects), "dir", ["write"])
+        if rng.random() < 0.1:
+            allow("auditallow", d, rng.choice(files), "file", ["write"])
+    for _ in range(len(attrs) * 4):
+        cls = rng.choice(FILE_CLASSES)
+        allow("allow", rng.choice(subjects), rng.choice(attrs), cls,
+              some(rng, perms(cls), 1, 4))
+    allow("allow", "kernel", "kernel", "security", ["load_policy"])
+    for d in some(rng, domains, 10, 30):
+        add(f"(allowx {d} {rng.choice(files)} "
+            f"(ioctl chr_file (range 0x5400 0x54ff)))")
+
+    for i in range(16):
+        add(f"(boolean b{i} {'true' if i % 2 else 'false'})")
+        body = " ".join(
+            f"(allow {rng.choice(domains)} {rng.choice(files)} "
+            f"(file (read open)))" for _ in range(rng.randint(2, 10)))
+        add(f"(booleanif b{i} (true {body}))")
+
+    for _ in range(ntypes // 4):
+        add(f"(typetransition {rng.choice(domains)} {rng.choice(files)} "
+            f"file \"n{rng.randrange(1 << 20)}\" {rng.choice(files)})")
+    for _ in range(ntypes // 8):
+        add(f"(typetransition {rng.choice(domains)} {rng.choice(files)} "
+            f"process {rng.choice(domains)})")
+
+    for cls in FILE_CLASSES:
+        add(f"(mlsconstrain ({cls} (write setattr append unlink rename)) "
+            f"(or (eq l1 l2) (or (eq t1 mlstrustedsubject) "
+            f"(eq t2 mlstrustedobject))))")
+        add(f"(mlsconstrain ({cls} (read getattr open)) "
+            f"(or (dom l1 l2) (eq t1 mlstrustedsubject)))")
+    add("(mlsconstrain (process (transition dyntransition)) "
+        "(or (eq h1 h2) (eq t1 mlstrustedsubject)))")
+    add("(constrain (process (transition)) "
+        "(or (eq u1 u2) (eq t1 appdomain)))")
+
+    ctx = "(u object_r {} ((s0) (s0)))"
+    add("(sidcontext kernel (u r kernel ((s0) (s0))))")
+    add("(sidcontext security (u r kernel ((s0) (s0))))")
+    for sid in ("unlabeled", "file", "port", "node", "netif"):
+        name = sid if sid in FILES else "unlabeled"
+        add(f"(sidcontext {sid} {ctx.format(name)})")
+    add(f"(fsuse xattr ext4 {ctx.format('labeledfs')})")
+    add(f"(fsuse task pipefs {ctx.format('tmpfs')})")
+    for i in range(64):
+        add(f"(portcon tcp {1000 + i} {ctx.format('port')})")
+    add(f"(netifcon lo {ctx.format('netif')} {ctx.format('netif')})")
+    add(f"(nodecon (127.0.0.1) (255.255.255.255) {ctx.format('node')})")
+    add(f"(genfscon proc / {ctx.format('proc')})")
+    for i in range(200):
+        add(f"(genfscon proc /p{i} {ctx.format(rng.choice(files))})")
+    add(f"(genfscon sysfs / {ctx.format('sysfs')})")
+    return "\n".join(out) + "\n", domains, files, attrs
+
+
+def compile_policy(cil, version, path):
+    sepol = ctypes.CDLL(ctypes.util.find_library("sepol") or "libsepol.so.2")
+    libc = ctypes.CDLL(None)
+    libc.free.argtypes = [ctypes.c_void_p]
+    db = ctypes.c_void_p()
+    pdb = ctypes.c_void_p()
+    data = ctypes.c_void_p()
+    size = ctypes.c_size_t()
+    sepol.cil_db_init(ctypes.byref(db))
+    sepol.cil_set_mls(db, 1)
+    sepol.cil_set_policy_version(db, version)
+    sepol.cil_set_target_platform(db, 0)
+    # keep attributes as attributes, like Android does
+    sepol.cil_set_attrs_expand_generated(db, 0)
+    sepol.cil_set_attrs_expand_size(db, 1)
+    src = cil.encode()
+    steps = [
+        ("cil_add_file", lambda: sepol.cil_add_file(
+            db, b"policy.cil", src, ctypes.c_size_t(len(src)))),
+        ("cil_compile", lambda: sepol.cil_compile(db)),
+        ("cil_build_policydb", lambda: sepol.cil_build_policydb(
+            db, ctypes.byref(pdb))),
+        ("sepol_policydb_to_image", lambda: sepol.sepol_policydb_to_image(
+            None, pdb, ctypes.byref(data), ctypes.byref(size))),
+    ]
+    for name, step in steps:
+        if step():
+            raise SystemExit(f"{name} failed")
+    with open(path, "wb") as f:
+        f.write(ctypes.string_at(data, size.value))
+    libc.free(data)
+    sepol.sepol_policydb_free(pdb)
+    sepol.cil_db_destroy(ctypes.byref(db))
+
+
+def module_rules(domains, files, attrs, rng):
+    out = []
+    add = out.append
+    # a module declares its types first; ksud sends each as one rule
+    mod_domains = [f"mod_d{i}" for i in range(16)]
+    mod_files = [f"mod_f{i}" for i in range(48)]
+    for d in mod_domains:
+        add(f"type {d}")
+    for f in mod_files:
+        add(f"type {f} file_type")
+    add("attribute mod_attr")
+    add("attribute mod_exec")
+    for f in mod_files[:8]:
+        add(f"typeattribute {f} mlstrustedobject")
+        add(f"typeattribute {f} mod_attr")
+    add(f"type mod_multi {{ {' '.join(['file_type', 'mod_attr'])} }}")
+    add("permissive mod_d0")
+    add("allow mod_d0 * * *")
+    add("allow * mod_f0 file *")
+    add("dontaudit mod_d1 * * *")
+    add("allow mod_attr mod_attr file { read write open }")
+    for d in mod_domains:
+        add(f"typeattribute {d} mlstrustedsubject")
+        add(f"allow {d} {{ {' '.join(rng.sample(mod_files, 4))} }} "
+            "{ file dir } { read write open getattr }")
+        add(f"allow {{ {' '.join(rng.sample(domains, 3))} }} {d} "
+            "{ fd binder } *")
+        add(f"allow {d} {rng.choice(domains)} process "
+            "{ sigchld sigkill transition }")
+        add(f"type_transition {rng.choice(domains)} {rng.choice(files)} "
+            f"file {rng.choice(mod_files)} \"mod.{d}\"")
+        add(f"allowxperm {d} {rng.choice(mod_files)} chr_file ioctl "
+            "0x5400-0x54ff")
+    for _ in range(256):
+        add(f"allow {rng.choice(domains)} {rng.choice(files + attrs)} "
+            f"{rng.choice(FILE_CLASSES)} {{ read open getattr }}")
+    add("allow domain system_data_file dir *")
+    add("auditallow mod_d2 kernel security *")
+    add("type_change mod_d3 system_file file mod_f1")
+    add("type_member mod_d3 system_file dir mod_f2")
+    add("enforce mod_d0")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("out", help="fixture directory")
+    parser.add_argument("--types", type=int, default=3000,
+                        help="domains and files besides the named ones")
+    parser.add_argument("--version", type=int, default=30,
+                        help="binary policy version, 33 for compact "
+                        "name transitions")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    os.makedirs(args.out, exist_ok=True)
+    cil, domains, files, attrs = cil_policy(args.types, rng)
+    compile_policy(cil, args.version, os.path.join(args.out, "sepolicy"))
+    with open(os.path.join(args.out, "module.rule"), "w") as f:
+        f.write(module_rules(domains, files, attrs, rng))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1023 @@
+//
+// Reader for the kernel binary policy format (versions 15 to 33), after
+// policydb_read() in security/selinux/ss/policydb.c. It fills the shim
+// policydb with what the patcher touches: the symbol tables, avtab,
+// constraints, filename transitions and the type attribute map. Sections
+// the patcher never looks at (conditionals, role transitions, ocontexts,
+// genfs, range transitions) are parsed and counted, then dropped.
+//
+#include <endian.h>
+
+#include <linux/slab.h>
+
+#include "policy_load.h"
+
+#define POLICYDB_MAGIC 0xf97cff8c
+#define POLICYDB_STRING "SE Linux"
+#define POLICYDB_CONFIG_MLS 1
+#define REJECT_UNKNOWN 0x00000002
+#define ALLOW_UNKNOWN 0x00000004
+
+#define TYPEDATUM_PROPERTY_PRIMARY 0x0001
+#define TYPEDATUM_PROPERTY_ATTRIBUTE 0x0002
+
+struct policy_file {
+    const u8 *data;
+    size_t len;
+    size_t pos;
+};
+
+extern const struct hashtab_key_params policydb_filenametr_key_params;
+
+static int next_entry(void *buf, struct policy_file *fp, size_t bytes)
+{
+    if (fp->len - fp->pos < bytes)
+        return -EINVAL;
+    memcpy(buf, fp->data + fp->pos, bytes);
+    fp->pos += bytes;
+    return 0;
+}
+
+static int read_u32s(struct policy_file *fp, u32 *buf, u32 n)
+{
+    u32 i;
+
+    if (next_entry(buf, fp, sizeof(u32) * n))
+        return -EINVAL;
+    for (i = 0; i < n; i++)
+        buf[i] = le32toh(buf[i]);
+    return 0;
+}
+
+static int str_read(char **strp, struct policy_file *fp, u32 len)
+{
+    char *str;
+
+    if (!len || len > fp->len - fp->pos)
+        return -EINVAL;
+    str = kmalloc(len + 1, GFP_KERNEL);
+    if (!str)
+        return -ENOMEM;
+    memcpy(str, fp->data + fp->pos, len);
+    str[len] = '\0';
+    fp->pos += len;
+    *strp = str;
+    return 0;
+}
+
+static int ebitmap_read(struct ebitmap *e, struct policy_file *fp)
+{
+    u32 buf[3], mapunit, count, i;
+
+    ebitmap_init(e);
+    if (read_u32s(fp, buf, 3))
+        return -EINVAL;
+    mapunit = buf[0];
+    count = buf[2];
+    if (mapunit != 64)
+        return -EINVAL;
+
+    for (i = 0; i < count; i++) {
+        u32 startbit, bit;
+        u64 map;
+
+        if (read_u32s(fp, &startbit, 1) ||
+            next_entry(&map, fp, sizeof(map)))
+            return -EINVAL;
+        if (startbit & 63)
+            return -EINVAL;
+        map = le64toh(map);
+        for (bit = 0; map; bit++, map >>= 1) {
+            if ((map & 1) && ebitmap_set_bit(e, startbit + bit, 1))
+                return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+static int mls_read_level(struct policy_file *fp)
+{
+    struct ebitmap cat;
+    u32 sens;
+    int rc;
+
+    if (read_u32s(fp, &sens, 1))
+        return -EINVAL;
+    rc = ebitmap_read(&cat, fp);
+    ebitmap_destroy(&cat);
+    return rc;
+}
+
+static int mls_read_range(struct policy_file *fp)
+{
+    struct ebitmap cat;
+    u32 items, buf[2];
+    int rc;
+
+    if (read_u32s(fp, &items, 1) || !items || items > 2 ||
+        read_u32s(fp, buf, items))
+        return -EINVAL;
+
+    rc = ebitmap_read(&cat, fp);
+    ebitmap_destroy(&cat);
+    if (!rc && items > 1) {
+        rc = ebitmap_read(&cat, fp);
+        ebitmap_destroy(&cat);
+    }
+    return rc;
+}
+
+static int context_read(struct policydb *p, struct policy_file *fp)
+{
+    u32 buf[3];
+
+    if (read_u32s(fp, buf, 3))
+        return -EINVAL;
+    if (p->policyvers >= POLICYDB_VERSION_MLS)
+        return mls_read_range(fp);
+    return 0;
+}
+
+static int symtab_read_key(struct symtab *s, struct policy_file *fp,
+                           u32 len, void *datum)
+{
+    char *key;
+    int rc = str_read(&key, fp, len);
+
+    if (rc)
+        return rc;
+    rc = symtab_insert(s, key, datum);
+    if (rc)
+        kfree(key);
+    return rc;
+}
+
+static int perm_read(struct policydb *p, struct symtab *s,
+                     struct policy_file *fp)
+{
+    struct perm_datum *perdatum;
+    u32 buf[2];
+    int rc;
+
+    if (read_u32s(fp, buf, 2))
+        return -EINVAL;
+    perdatum = kzalloc(sizeof(*perdatum), GFP_KERNEL);
+    if (!perdatum)
+        return -ENOMEM;
+    perdatum->value = buf[1];
+    rc = symtab_read_key(s, fp, buf[0], perdatum);
+    if (rc)
+        kfree(perdatum);
+    return rc;
+}
+
+static int common_read(struct policydb *p, struct symtab *s,
+                       struct policy_file *fp)
+{
+    struct common_datum *comdatum;
+    u32 buf[4], i;
+    int rc;
+
+    if (read_u32s(fp, buf, 4))
+        return -EINVAL;
+    comdatum = kzalloc(sizeof(*comdatum), GFP_KERNEL);
+    if (!comdatum)
+        return -ENOMEM;
+    comdatum->value = buf[1];
+    rc = symtab_init(&comdatum->permissions, buf[3]);
+    if (!rc)
+        rc = symtab_read_key(s, fp, buf[0], comdatum);
+    if (rc) {
+        kfree(comdatum);
+        return rc;
+    }
+    comdatum->permissions.nprim = buf[2];
+
+    for (i = 0; i < buf[3]; i++) {
+        rc = perm_read(p, &comdatum->permissions, fp);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+static int type_set_read(struct type_set *t, struct policy_file *fp)
+{
+    if (ebitmap_read(&t->types, fp) || ebitmap_read(&t->negset, fp) ||
+        read_u32s(fp, &t->flags, 1))
+        return -EINVAL;
+    return 0;
+}
+
+static int read_cons_helper(struct policydb *p, struct constraint_node **nodep,
+                            u32 ncons, int allowxtarget,
+                            struct policy_file *fp)
+{
+    struct constraint_node *c, *lc = NULL;
+    struct constraint_expr *e, *le;
+    u32 buf[3], i, j, nexpr;
+
+    for (i = 0; i < ncons; i++) {
+        c = kzalloc(sizeof(*c), GFP_KERNEL);
+        if (!c)
+            return -ENOMEM;
+        if (lc)
+            lc->next = c;
+        else
+            *nodep = c;
+        lc = c;
+
+        if (read_u32s(fp, buf, 2))
+            return -EINVAL;
+        c->permissions = buf[0];
+        nexpr = buf[1];
+        le = NULL;
+        for (j = 0; j < nexpr; j++) {
+            e = kzalloc(sizeof(*e), GFP_KERNEL);
+            if (!e)
+                return -ENOMEM;
+            if (le)
+                le->next = e;
+            else
+                c->expr = e;
+            le = e;
+
+            if (read_u32s(fp, buf, 3))
+                return -EINVAL;
+            e->expr_type = buf[0];
+            e->attr = buf[1];
+            e->op = buf[2];
+
+            if (e->expr_type != CEXPR_NAMES)
+                continue;
+            if (!allowxtarget && (e->attr & CEXPR_XTARGET))
+                return -EINVAL;
+            if (ebitmap_read(&e->names, fp))
+                return -EINVAL;
+            if (p->policyvers >= POLICYDB_VERSION_CONSTRAINT_NAMES) {
+                e->type_names = kzalloc(sizeof(*e->type_names), GFP_KERNEL);
+                if (!e->type_names)
+                    return -ENOMEM;
+                if (type_set_read(e->type_names, fp))
+                    return -EINVAL;
+            }
+        }
+    }
+    return 0;
+}
+
+static int class_read(struct policydb *p, struct symtab *s,
+                      struct policy_file *fp)
+{
+    struct class_datum *cladatum;
+    u32 buf[6], len2, ncons, nel, i;
+    int rc;
+
+    if (read_u32s(fp, buf, 6))
+        return -EINVAL;
+    cladatum = kzalloc(sizeof(*cladatum), GFP_KERNEL);
+    if (!cladatum)
+        return -ENOMEM;
+    len2 = buf[1];
+    cladatum->value = buf[2];
+    nel = buf[4];
+    ncons = buf[5];
+
+    rc = symtab_init(&cladatum->permissions, nel);
+    if (!rc)
+        rc = symtab_read_key(s, fp, buf[0], cladatum);
+    if (rc) {
+        kfree(cladatum);
+        return rc;
+    }
+    cladatum->permissions.nprim = buf[3];
+
+    if (len2) {
+        rc = str_read(&cladatum->comkey, fp, len2);
+        if (rc)
+            return rc;
+        cladatum->comdatum = symtab_search(&p->p_commons, cladatum->comkey);
+        if (!cladatum->comdatum)
+            return -EINVAL;
+    }
+
+    for (i = 0; i < nel; i++) {
+        rc = perm_read(p, &cladatum->permissions, fp);
+        if (rc)
+            return rc;
+    }
+
+    rc = read_cons_helper(p, &cladatum->constraints, ncons, 0, fp);
+    if (rc)
+        return rc;
+
+    if (p->policyvers >= POLICYDB_VERSION_VALIDATETRANS) {
+        if (read_u32s(fp, &ncons, 1))
+            return -EINVAL;
+        rc = read_cons_helper(p, &cladatum->validatetrans, ncons, 1, fp);
+        if (rc)
+            return rc;
+    }
+
+    if (p->policyvers >= POLICYDB_VERSION_NEW_OBJECT_DEFAULTS) {
+        if (read_u32s(fp, buf, 3))
+            return -EINVAL;
+        cladatum->default_user = buf[0];
+        cladatum->default_role = buf[1];
+        cladatum->default_range = buf[2];
+    }
+
+    if (p->policyvers >= POLICYDB_VERSION_DEFAULT_TYPE) {
+        if (read_u32s(fp, buf, 1))
+            return -EINVAL;
+        cladatum->default_type = buf[0];
+    }
+    return 0;
+}
+
+static int role_read(struct policydb *p, struct symtab *s,
+                     struct policy_file *fp)
+{
+    struct role_datum *role;
+    u32 buf[3], to_read = 2;
+    int rc;
+
+    if (p->policyvers >= POLICYDB_VERSION_BOUNDARY)
+        to_read = 3;
+    if (read_u32s(fp, buf, to_read))
+        return -EINVAL;
+    role = kzalloc(sizeof(*role), GFP_KERNEL);
+    if (!role)
+        return -ENOMEM;
+    role->value = buf[1];
+    if (to_read == 3)
+        role->bounds = buf[2];
+
+    rc = symtab_read_key(s, fp, buf[0], role);
+    if (rc) {
+        kfree(role);
+        return rc;
+    }
+    if (ebitmap_read(&role->dominates, fp) || ebitmap_read(&role->types, fp))
+        return -EINVAL;
+    return 0;
+}
+
+static int type_read(struct policydb *p, struct symtab *s,
+                     struct policy_file *fp)
+{
+    struct type_datum *typdatum;
+    u32 buf[4], to_read = 3;
+    int rc;
+
+    if (p->policyvers >= POLICYDB_VERSION_BOUNDARY)
+        to_read = 4;
+    if (read_u32s(fp, buf, to_read))
+        return -EINVAL;
+    typdatum = kzalloc(sizeof(*typdatum), GFP_KERNEL);
+    if (!typdatum)
+        return -ENOMEM;
+    typdatum->value = buf[1];
+    if (to_read == 4) {
+        typdatum->primary = !!(buf[2] & TYPEDATUM_PROPERTY_PRIMARY);
+        typdatum->attribute = !!(buf[2] & TYPEDATUM_PROPERTY_ATTRIBUTE);
+        typdatum->bounds = buf[3];
+    } else {
+        typdatum->primary = buf[2];
+    }
+
+    rc = symtab_read_key(s, fp, buf[0], typdatum);
+    if (rc)
+        kfree(typdatum);
+    return rc;
+}
+
+static int user_read(struct policydb *p, struct symtab *s,
+                     struct policy_file *fp)
+{
+    struct value_datum *usrdatum;
+    struct ebitmap roles;
+    u32 buf[3], to_read = 2;
+    int rc;
+
+    if (p->policyvers >= POLICYDB_VERSION_BOUNDARY)
+        to_read = 3;
+    if (read_u32s(fp, buf, to_read))
+        return -EINVAL;
+    usrdatum = kzalloc(sizeof(*usrdatum), GFP_KERNEL);
+    if (!usrdatum)
+        return -ENOMEM;
+    usrdatum->value = buf[1];
+
+    rc = symtab_read_key(s, fp, buf[0], usrdatum);
+    if (rc) {
+        kfree(usrdatum);
+        return rc;
+    }
+    rc = ebitmap_read(&roles, fp);
+    ebitmap_destroy(&roles);
+    if (rc)
+        return rc;
+    if (p->policyvers >= POLICYDB_VERSION_MLS) {
+        rc = mls_read_range(fp);
+        if (!rc)
+            rc = mls_read_level(fp);
+    }
+    return rc;
+}
+
+static int cond_read_bool(struct policydb *p, struct symtab *s,
+                          struct policy_file *fp)
+{
+    struct value_datum *booldatum;
+    u32 buf[3];
+    int rc;
+
+    if (read_u32s(fp, buf, 3))
+        return -EINVAL;
+    booldatum = kzalloc(sizeof(*booldatum), GFP_KERNEL);
+    if (!booldatum)
+        return -ENOMEM;
+    booldatum->value = buf[0];
+    rc = symtab_read_key(s, fp, buf[2], booldatum);
+    if (rc)
+        kfree(booldatum);
+    return rc;
+}
+
+static int sens_read(struct policydb *p, struct symtab *s,
+                     struct policy_file *fp)
+{
+    struct value_datum *levdatum;
+    u32 buf[2];
+    int rc;
+
+    if (read_u32s(fp, buf, 2))
+        return -EINVAL;
+    levdatum = kzalloc(sizeof(*levdatum), GFP_KERNEL);
+    if (!levdatum)
+        return -ENOMEM;
+    rc = symtab_read_key(s, fp, buf[0], levdatum);
+    if (rc) {
+        kfree(levdatum);
+        return rc;
+    }
+    return mls_read_level(fp);
+}
+
+static int cat_read(struct policydb *p, struct symtab *s,
+                    struct policy_file *fp)
+{
+    struct value_datum *catdatum;
+    u32 buf[3];
+    int rc;
+
+    if (read_u32s(fp, buf, 3))
+        return -EINVAL;
+    catdatum = kzalloc(sizeof(*catdatum), GFP_KERNEL);
+    if (!catdatum)
+        return -ENOMEM;
+    catdatum->value = buf[1];
+    rc = symtab_read_key(s, fp, buf[0], catdatum);
+    if (rc)
+        kfree(catdatum);
+    return rc;
+}
+
+static int (*const read_f[SYM_NUM])(struct policydb *p, struct symtab *s,
+                                    struct policy_file *fp) = {
+    common_read, class_read, role_read, type_read,
+    user_read, cond_read_bool, sens_read, cat_read,
+};
+
+static int avtab_read_item(struct policydb *p, struct avtab *a,
+                           struct policy_file *fp)
+{
+    struct avtab_extended_perms xperms;
+    struct avtab_datum datum;
+    struct avtab_key key;
+    u16 buf16[4];
+
+    if (next_entry(buf16, fp, sizeof(buf16)))
+        return -EINVAL;
+    key.source_type = le16toh(buf16[0]);
+    key.target_type = le16toh(buf16[1]);
+    key.target_class = le16toh(buf16[2]);
+    key.specified = le16toh(buf16[3]);
+
+    if (key.specified & AVTAB_XPERMS) {
+        if (p->policyvers < POLICYDB_VERSION_XPERMS_IOCTL)
+            return -EINVAL;
+        memset(&xperms, 0, sizeof(xperms));
+        if (next_entry(&xperms.specified, fp, sizeof(u8)) ||
+            next_entry(&xperms.driver, fp, sizeof(u8)) ||
+            read_u32s(fp, xperms.perms.p, ARRAY_SIZE(xperms.perms.p)))
+            return -EINVAL;
+        datum.u.xperms = &xperms;
+    } else if (read_u32s(fp, &datum.u.data, 1)) {
+        return -EINVAL;
+    }
+
+    return avtab_insert_nonunique(a, &key, &datum) ? 0 : -ENOMEM;
+}
+
+static int avtab_read(struct policydb *p, struct avtab *a,
+                      struct policy_file *fp)
+{
+    u32 nel, i;
+    int rc;
+
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    rc = avtab_alloc(a, nel);
+    for (i = 0; !rc && i < nel; i++)
+        rc = avtab_read_item(p, a, fp);
+    return rc;
+}
+
+static int cond_read_av_list(struct policydb *p, struct policy_file *fp,
+                             struct policy_load_stats *st)
+{
+    u32 len, i;
+    int rc;
+
+    if (read_u32s(fp, &len, 1))
+        return -EINVAL;
+    for (i = 0; i < len; i++) {
+        rc = avtab_read_item(p, &p->te_cond_avtab, fp);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+static int cond_read_list(struct policydb *p, struct policy_file *fp,
+                          struct policy_load_stats *st)
+{
+    u32 buf[2], len, i, j;
+    int rc;
+
+    if (read_u32s(fp, &len, 1))
+        return -EINVAL;
+    rc = avtab_alloc(&p->te_cond_avtab, p->te_avtab.nel);
+    if (rc)
+        return rc;
+
+    for (i = 0; i < len; i++) {
+        if (read_u32s(fp, buf, 2))
+            return -EINVAL;
+        for (j = 0; j < buf[1]; j++) {
+            u32 expr[2];
+
+            if (read_u32s(fp, expr, 2))
+                return -EINVAL;
+        }
+        rc = cond_read_av_list(p, fp, st);
+        if (!rc)
+            rc = cond_read_av_list(p, fp, st);
+        if (rc)
+            return rc;
+    }
+    st->conds = len;
+    return 0;
+}
+
+static int filename_trans_link(struct policydb *p, u32 ttype, u16 tclass,
+                               char *name, struct filename_trans_datum *datum)
+{
+    struct filename_trans_key *ft = kzalloc(sizeof(*ft), GFP_KERNEL);
+
+    if (!ft)
+        return -ENOMEM;
+    ft->ttype = ttype;
+    ft->tclass = tclass;
+    ft->name = name;
+    if (hashtab_insert(&p->filename_trans, ft, datum,
+                       policydb_filenametr_key_params)) {
+        kfree(ft);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// One rule of a version < 33 policy, merged into the datums of its name
+// like filename_trans_read_helper_compat()
+static int filename_trans_read_compat(struct policydb *p,
+                                      struct policy_file *fp)
+{
+    struct filename_trans_key key;
+    struct filename_trans_datum *datum, *last = NULL;
+    u32 len, buf[4];
+    char *name;
+    int rc;
+
+    if (read_u32s(fp, &len, 1))
+        return -EINVAL;
+    rc = str_read(&name, fp, len);
+    if (rc)
+        return rc;
+    if (read_u32s(fp, buf, 4) || !buf[0]) {
+        kfree(name);
+        return -EINVAL;
+    }
+
+    key.ttype = buf[1];
+    key.tclass = buf[2];
+    key.name = name;
+    for (datum = policydb_filenametr_search(p, &key); datum;
+         datum = datum->next) {
+        // conflicting or duplicate rules are ignored
+        if (ebitmap_get_bit(&datum->stypes, buf[0] - 1)) {
+            kfree(name);
+            return 0;
+        }
+        if (datum->otype == buf[3])
+            break;
+        last = datum;
+    }
+
+    if (!datum) {
+        datum = kzalloc(sizeof(*datum), GFP_KERNEL);
+        if (!datum) {
+            kfree(name);
+            return -ENOMEM;
+        }
+        datum->otype = buf[3];
+        if (last) {
+            last->next = datum;
+        } else {
+            rc = filename_trans_link(p, key.ttype, key.tclass, name, datum);
+            if (rc) {
+                kfree(datum);
+                kfree(name);
+                return rc;
+            }
+            name = NULL;
+        }
+    }
+    kfree(name);
+    return ebitmap_set_bit(&datum->stypes, buf[0] - 1, 1);
+}
+
+static int filename_trans_read_helper(struct policydb *p,
+                                      struct policy_file *fp)
+{
+    struct filename_trans_datum *first = NULL, *last = NULL, *datum;
+    u32 len, buf[3], ndatum, i;
+    char *name;
+    int rc;
+
+    if (read_u32s(fp, &len, 1))
+        return -EINVAL;
+    rc = str_read(&name, fp, len);
+    if (rc)
+        return rc;
+    if (read_u32s(fp, buf, 3) || !buf[2]) {
+        kfree(name);
+        return -EINVAL;
+    }
+    ndatum = buf[2];
+
+    for (i = 0; i < ndatum; i++) {
+        datum = kzalloc(sizeof(*datum), GFP_KERNEL);
+        if (!datum)
+            return -ENOMEM;
+        if (last)
+            last->next = datum;
+        else
+            first = datum;
+        last = datum;
+        if (ebitmap_read(&datum->stypes, fp) ||
+            read_u32s(fp, &datum->otype, 1))
+            return -EINVAL;
+    }
+    return filename_trans_link(p, buf[0], buf[1], name, first);
+}
+
+static int filename_trans_read(struct policydb *p, struct policy_file *fp,
+                               struct policy_load_stats *st)
+{
+    u32 nel, i;
+    int rc;
+
+    if (p->policyvers < POLICYDB_VERSION_FILENAME_TRANS)
+        return hashtab_init(&p->filename_trans, 0);
+
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    st->filename_trans = nel;
+
+    if (p->policyvers < POLICYDB_VERSION_COMP_FTRANS) {
+        p->compat_filename_trans_count = nel;
+        rc = hashtab_init(&p->filename_trans, (1 << 11));
+        for (i = 0; !rc && i < nel; i++)
+            rc = filename_trans_read_compat(p, fp);
+    } else {
+        rc = hashtab_init(&p->filename_trans, nel);
+        for (i = 0; !rc && i < nel; i++)
+            rc = filename_trans_read_helper(p, fp);
+    }
+    return rc;
+}
+
+// sym_val_to_name and the val_to_struct arrays, like policydb_index()
+static int policydb_index(struct policydb *p)
+{
+    struct hashtab_node *node;
+    u32 i, j;
+
+    p->class_val_to_struct = kcalloc(p->p_classes.nprim,
+                                     sizeof(*p->class_val_to_struct),
+                                     GFP_KERNEL);
+    p->role_val_to_struct = kcalloc(p->p_roles.nprim,
+                                    sizeof(*p->role_val_to_struct),
+                                    GFP_KERNEL);
+    p->type_val_to_struct = kvcalloc(p->p_types.nprim,
+                                     sizeof(*p->type_val_to_struct),
+                                     GFP_KERNEL);
+    if (!p->class_val_to_struct || !p->role_val_to_struct ||
+        !p->type_val_to_struct)
+        return -ENOMEM;
+
+    for (i = 0; i < SYM_NUM; i++) {
+        p->sym_val_to_name[i] = kvcalloc(p->symtab[i].nprim, sizeof(char *),
+                                         GFP_KERNEL);
+        if (!p->sym_val_to_name[i])
+            return -ENOMEM;
+    }
+
+    for (i = 0; i < SYM_NUM; i++) {
+        struct hashtab *h = &p->symtab[i].table;
+
+        for (j = 0; j < h->size; j++) {
+            for (node = h->htable[j]; node; node = node->next) {
+                // every datum starts with its value
+                u32 value = *(u32 *)node->datum;
+
+                if (i == SYM_TYPES &&
+                    !((struct type_datum *)node->datum)->primary)
+                    continue;
+                if (i == SYM_LEVELS)
+                    continue;
+                if (!value || value > p->symtab[i].nprim)
+                    return -EINVAL;
+                p->sym_val_to_name[i][value - 1] = node->key;
+                if (i == SYM_CLASSES)
+                    p->class_val_to_struct[value - 1] = node->datum;
+                else if (i == SYM_ROLES)
+                    p->role_val_to_struct[value - 1] = node->datum;
+                else if (i == SYM_TYPES)
+                    p->type_val_to_struct[value - 1] = node->datum;
+            }
+        }
+    }
+    return 0;
+}
+
+static int ocontext_read(struct policydb *p, u32 ocon_num,
+                         struct policy_file *fp,
+                         struct policy_load_stats *st)
+{
+    u32 buf[8], nel, i, j;
+    char *name;
+    int rc;
+
+    for (i = 0; i < ocon_num; i++) {
+        if (read_u32s(fp, &nel, 1))
+            return -EINVAL;
+        st->ocontexts += nel;
+        for (j = 0; j < nel; j++) {
+            int contexts = 1;
+
+            switch (i) {
+            case OCON_ISID:
+                rc = read_u32s(fp, buf, 1);
+                break;
+            case OCON_FS:
+            case OCON_NETIF:
+                contexts = 2;
+                rc = read_u32s(fp, buf, 1);
+                if (!rc && !(rc = str_read(&name, fp, buf[0])))
+                    kfree(name);
+                break;
+            case OCON_PORT:
+                rc = read_u32s(fp, buf, 3);
+                break;
+            case OCON_NODE:
+                rc = read_u32s(fp, buf, 2);
+                break;
+            case OCON_FSUSE:
+                rc = read_u32s(fp, buf, 2);
+                if (!rc && !(rc = str_read(&name, fp, buf[1])))
+                    kfree(name);
+                break;
+            case OCON_NODE6:
+                rc = read_u32s(fp, buf, 8);
+                break;
+            case OCON_IBPKEY:
+                rc = read_u32s(fp, buf, 4);
+                break;
+            case OCON_IBENDPORT:
+                rc = read_u32s(fp, buf, 2);
+                if (!rc && !(rc = str_read(&name, fp, buf[0])))
+                    kfree(name);
+                break;
+            default:
+                rc = -EINVAL;
+            }
+            while (!rc && contexts--)
+                rc = context_read(p, fp);
+            if (rc)
+                return rc;
+        }
+    }
+    return 0;
+}
+
+static int genfs_read(struct policydb *p, struct policy_file *fp,
+                      struct policy_load_stats *st)
+{
+    u32 nel, nel2, len, i, j;
+    char *name;
+    int rc;
+
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    for (i = 0; i < nel; i++) {
+        if (read_u32s(fp, &len, 1) || str_read(&name, fp, len))
+            return -EINVAL;
+        kfree(name);
+        if (read_u32s(fp, &nel2, 1))
+            return -EINVAL;
+        st->genfs += nel2;
+        for (j = 0; j < nel2; j++) {
+            u32 sclass;
+
+            if (read_u32s(fp, &len, 1) || str_read(&name, fp, len))
+                return -EINVAL;
+            kfree(name);
+            if (read_u32s(fp, &sclass, 1))
+                return -EINVAL;
+            rc = context_read(p, fp);
+            if (rc)
+                return rc;
+        }
+    }
+    return 0;
+}
+
+static int range_read(struct policydb *p, struct policy_file *fp)
+{
+    u32 nel, buf[3], i;
+    int rc;
+
+    if (p->policyvers < POLICYDB_VERSION_MLS)
+        return 0;
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    for (i = 0; i < nel; i++) {
+        if (read_u32s(fp, buf,
+                      p->policyvers >= POLICYDB_VERSION_RANGETRANS ? 3 : 2))
+            return -EINVAL;
+        rc = mls_read_range(fp);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
+int policydb_load(struct policydb *p, const void *data, size_t len,
+                  struct policy_load_stats *st)
+{
+    struct policy_file file = { .data = data, .len = len }, *fp = &file;
+    u32 buf[4], nel, sym_num, ocon_num, i, j;
+    char *str;
+    int rc;
+
+    memset(p, 0, sizeof(*p));
+    memset(st, 0, sizeof(*st));
+    p->len = len;
+
+    if (read_u32s(fp, buf, 2) || buf[0] != POLICYDB_MAGIC ||
+        buf[1] != strlen(POLICYDB_STRING))
+        return -EINVAL;
+    if (str_read(&str, fp, buf[1]))
+        return -EINVAL;
+    rc = strcmp(str, POLICYDB_STRING) ? -EINVAL : 0;
+    kfree(str);
+    if (rc)
+        return rc;
+
+    if (read_u32s(fp, buf, 4))
+        return -EINVAL;
+    p->policyvers = buf[0];
+    if (p->policyvers < POLICYDB_VERSION_MIN ||
+        p->policyvers > POLICYDB_VERSION_MAX)
+        return -EINVAL;
+    p->mls_enabled = !!(buf[1] & POLICYDB_CONFIG_MLS);
+    p->reject_unknown = !!(buf[1] & REJECT_UNKNOWN);
+    p->allow_unknown = !!(buf[1] & ALLOW_UNKNOWN);
+
+    // policydb_compat[]
+    if (p->policyvers < POLICYDB_VERSION_BOOL)
+        sym_num = SYM_NUM - 3;
+    else if (p->policyvers < POLICYDB_VERSION_MLS)
+        sym_num = SYM_NUM - 2;
+    else
+        sym_num = SYM_NUM;
+    if (p->policyvers < POLICYDB_VERSION_IPV6)
+        ocon_num = OCON_NUM - 3;
+    else if (p->policyvers < POLICYDB_VERSION_INFINIBAND)
+        ocon_num = OCON_NUM - 2;
+    else
+        ocon_num = OCON_NUM;
+    if (buf[2] != sym_num || buf[3] != ocon_num)
+        return -EINVAL;
+
+    if (p->policyvers >= POLICYDB_VERSION_POLCAP &&
+        ebitmap_read(&p->policycaps, fp))
+        return -EINVAL;
+    if (p->policyvers >= POLICYDB_VERSION_PERMISSIVE &&
+        ebitmap_read(&p->permissive_map, fp))
+        return -EINVAL;
+
+    for (i = 0; i < SYM_NUM; i++) {
+        u32 nprim = 0;
+
+        nel = 0;
+        if (i < sym_num) {
+            if (read_u32s(fp, buf, 2))
+                return -EINVAL;
+            nprim = buf[0];
+            nel = buf[1];
+        }
+        rc = symtab_init(&p->symtab[i], nel);
+        for (j = 0; !rc && j < nel; j++)
+            rc = read_f[i](p, &p->symtab[i], fp);
+        if (rc)
+            return rc;
+        p->symtab[i].nprim = nprim;
+    }
+
+    rc = avtab_read(p, &p->te_avtab, fp);
+    if (rc)
+        return rc;
+
+    if (p->policyvers >= POLICYDB_VERSION_BOOL) {
+        rc = cond_read_list(p, fp, st);
+        if (rc)
+            return rc;
+    }
+
+    // role transitions, then role allows
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    st->role_trans = nel;
+    for (i = 0; i < nel; i++) {
+        if (read_u32s(fp, buf,
+                      p->policyvers >= POLICYDB_VERSION_ROLETRANS ? 4 : 3))
+            return -EINVAL;
+    }
+    if (read_u32s(fp, &nel, 1))
+        return -EINVAL;
+    st->role_allow = nel;
+    for (i = 0; i < nel; i++) {
+        if (read_u32s(fp, buf, 2))
+            return -EINVAL;
+    }
+
+    rc = filename_trans_read(p, fp, st);
+    if (rc)
+        return rc;
+
+    rc = policydb_index(p);
+    if (rc)
+        return rc;
+
+    rc = ocontext_read(p, ocon_num, fp, st);
+    if (!rc)
+        rc = genfs_read(p, fp, st);
+    if (!rc)
+        rc = range_read(p, fp);
+    if (rc)
+        return rc;
+
+    p->type_attr_map_array = kvcalloc(p->p_types.nprim,
+                                      sizeof(*p->type_attr_map_array),
+                                      GFP_KERNEL);
+    if (!p->type_attr_map_array)
+        return -ENOMEM;
+    for (i = 0; i < p->p_types.nprim; i++) {
+        struct ebitmap *e = &p->type_attr_map_array[i];
+
+        if (p->policyvers >= POLICYDB_VERSION_AVTAB &&
+            ebitmap_read(e, fp))
+            return -EINVAL;
+        // the type itself, as the degenerate case
+        if (ebitmap_set_bit(e, i, 1))
+            return -ENOMEM;
+    }
+
+    st->trailing = fp->len - fp->pos;
+    return 0;
+}
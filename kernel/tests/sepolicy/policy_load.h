@@ -0,0 +1,24 @@
+#ifndef SEPOLICY_BENCH_POLICY_LOAD_H
+#define SEPOLICY_BENCH_POLICY_LOAD_H
+
+#include <stddef.h>
+
+#include "ss/policydb.h"
+
+// Sections read but not kept
+struct policy_load_stats {
+    u32 conds;
+    u32 role_trans;
+    u32 role_allow;
+    u32 filename_trans;
+    u32 ocontexts;
+    u32 genfs;
+    size_t trailing; // bytes after the type attribute map, should be 0
+};
+
+// Fill p from a binary policy, like policydb_read(). Returns 0 or -errno;
+// a failed load leaks what was read so far.
+int policydb_load(struct policydb *p, const void *data, size_t len,
+                  struct policy_load_stats *st);
+
+#endif
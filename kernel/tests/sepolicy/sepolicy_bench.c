@@ -0,0 +1,572 @@
+//
+// Host benchmark of the sepolicy patcher: loads a binary policy, applies
+// apply_kernelsu_rules() and then module rules in ksud's statement syntax
+// through the same entry points as the SET_SEPOLICY ioctl, either one rule
+// per ioctl or as a KSU_IOCTL_BATCH the way ksud sends them. Reports time,
+// avtab and type growth, allocations and avc resets, then checks the
+// patched policy is consistent.
+// Usage: sepolicy_bench [-1] [-s] [-n] [-v] [-r runs] [-f alloc] policy
+//                       [rules...]
+//
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <linux/ktime.h>
+#include <linux/slab.h>
+
+#include "policy_load.h"
+#include "selinux.h"
+#include "sepolicy.h"
+#include "ss/services.h"
+
+int shim_loglevel;
+unsigned long shim_allocs, shim_atomic_allocs, shim_fail_at;
+bool shim_failed_atomic;
+
+struct selinux_state selinux_state;
+static unsigned long avc_resets;
+
+bool getenforce()
+{
+    return true;
+}
+
+int avc_ss_reset(struct selinux_avc *avc, u32 seqno)
+{
+    avc_resets++;
+    return 0;
+}
+
+void selnl_notify_policyload(u32 seqno)
+{
+}
+
+void selinux_status_update_policyload(struct selinux_state *state, u32 seqno)
+{
+}
+
+void selinux_xfrm_notify_policyload(void)
+{
+}
+
+// struct sepol_data of rules.c, as ksud's FfiPolicy lays it out
+#define CMD_NORMAL_PERM 1
+#define CMD_XPERM 2
+#define CMD_TYPE_STATE 3
+#define CMD_TYPE 4
+#define CMD_TYPE_ATTR 5
+#define CMD_ATTR 6
+#define CMD_TYPE_TRANSITION 7
+#define CMD_TYPE_CHANGE 8
+#define CMD_GENFSCON 9
+
+struct sepol_data {
+    u32 cmd;
+    u32 subcmd;
+    char *sepol[7];
+};
+
+#define KSU_BATCH_MAX 1024
+#define MAX_SET 64
+
+static struct sepol_data *rules;
+static u32 nr_rules, rules_cap;
+
+static void add_rule(u32 cmd, u32 subcmd, char *const *sepol, int n)
+{
+    struct sepol_data *r;
+
+    if (nr_rules == rules_cap) {
+        rules_cap = rules_cap ? rules_cap * 2 : 256;
+        rules = realloc(rules, rules_cap * sizeof(*rules));
+        if (!rules) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    r = &rules[nr_rules++];
+    memset(r, 0, sizeof(*r));
+    r->cmd = cmd;
+    r->subcmd = subcmd;
+    memcpy(r->sepol, sepol, n * sizeof(*sepol));
+}
+
+// One object of a statement: a word, "*" (a single NULL), or { words }
+struct obj {
+    int n;
+    char *v[MAX_SET];
+};
+
+static char *next_word(char **p)
+{
+    char *s = *p, *start;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    start = s;
+    while (*s && *s != ' ' && *s != '\t' && *s != '{' && *s != '}')
+        s++;
+    *p = s;
+    return s == start ? NULL : strndup(start, s - start);
+}
+
+static bool next_obj(char **p, struct obj *o, bool star)
+{
+    char *s = *p, *w;
+
+    o->n = 0;
+    while (*s == ' ' || *s == '\t')
+        s++;
+    if (*s == '{') {
+        s++;
+        while ((w = next_word(&s)) && o->n < MAX_SET)
+            o->v[o->n++] = w;
+        while (*s == ' ' || *s == '\t')
+            s++;
+        if (*s != '}' || !o->n)
+            return false;
+        *p = s + 1;
+        return true;
+    }
+    w = next_word(&s);
+    *p = s;
+    if (!w)
+        return false;
+    if (!strcmp(w, "*")) {
+        free(w);
+        if (!star)
+            return false;
+        w = NULL;
+    }
+    o->v[o->n++] = w;
+    return true;
+}
+
+static bool parse_statement(char *line)
+{
+    static const char *const perms[] = { "allow", "deny", "auditallow",
+                                         "dontaudit" };
+    static const char *const xperms[] = { "allowxperm", "auditallowxperm",
+                                          "dontauditxperm" };
+    struct obj o[4];
+    char *sepol[7] = {}, *p = line, *op = next_word(&p);
+    u32 i, a, b, c, d;
+
+    if (!op)
+        return true;
+
+    for (i = 0; i < ARRAY_SIZE(perms); i++) {
+        if (strcmp(op, perms[i]))
+            continue;
+        for (a = 0; a < 4; a++) {
+            if (!next_obj(&p, &o[a], true))
+                return false;
+        }
+        for (a = 0; a < o[0].n; a++)
+            for (b = 0; b < o[1].n; b++)
+                for (c = 0; c < o[2].n; c++)
+                    for (d = 0; d < o[3].n; d++) {
+                        sepol[0] = o[0].v[a];
+                        sepol[1] = o[1].v[b];
+                        sepol[2] = o[2].v[c];
+                        sepol[3] = o[3].v[d];
+                        add_rule(CMD_NORMAL_PERM, i + 1, sepol, 4);
+                    }
+        return true;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(xperms); i++) {
+        if (strcmp(op, xperms[i]))
+            continue;
+        for (a = 0; a < 3; a++) {
+            if (!next_obj(&p, &o[a], true))
+                return false;
+        }
+        sepol[3] = next_word(&p);
+        sepol[4] = next_word(&p);
+        if (!sepol[4])
+            return false;
+        for (a = 0; a < o[0].n; a++)
+            for (b = 0; b < o[1].n; b++)
+                for (c = 0; c < o[2].n; c++) {
+                    sepol[0] = o[0].v[a];
+                    sepol[1] = o[1].v[b];
+                    sepol[2] = o[2].v[c];
+                    add_rule(CMD_XPERM, i + 1, sepol, 5);
+                }
+        return true;
+    }
+
+    if (!strcmp(op, "permissive") || !strcmp(op, "enforce")) {
+        if (!next_obj(&p, &o[0], false))
+            return false;
+        for (a = 0; a < o[0].n; a++) {
+            sepol[0] = o[0].v[a];
+            add_rule(CMD_TYPE_STATE, op[0] == 'p' ? 1 : 2, sepol, 1);
+        }
+        return true;
+    }
+
+    if (!strcmp(op, "type")) {
+        sepol[0] = next_word(&p);
+        if (!sepol[0])
+            return false;
+        if (!next_obj(&p, &o[0], false)) {
+            o[0].n = 1;
+            o[0].v[0] = "domain";
+        }
+        for (a = 0; a < o[0].n; a++) {
+            sepol[1] = o[0].v[a];
+            add_rule(CMD_TYPE, 0, sepol, 2);
+        }
+        return true;
+    }
+
+    if (!strcmp(op, "typeattribute") || !strcmp(op, "attradd")) {
+        if (!next_obj(&p, &o[0], false) || !next_obj(&p, &o[1], false))
+            return false;
+        for (a = 0; a < o[0].n; a++)
+            for (b = 0; b < o[1].n; b++) {
+                sepol[0] = o[0].v[a];
+                sepol[1] = o[1].v[b];
+                add_rule(CMD_TYPE_ATTR, 0, sepol, 2);
+            }
+        return true;
+    }
+
+    if (!strcmp(op, "attribute")) {
+        sepol[0] = next_word(&p);
+        if (!sepol[0])
+            return false;
+        add_rule(CMD_ATTR, 0, sepol, 1);
+        return true;
+    }
+
+    if (!strcmp(op, "type_transition") || !strcmp(op, "name_transition") ||
+        !strcmp(op, "type_change") || !strcmp(op, "type_member")) {
+        for (a = 0; a < 5; a++)
+            sepol[a] = next_word(&p);
+        if (!sepol[3])
+            return false;
+        if (op[5] == 'c')
+            add_rule(CMD_TYPE_CHANGE, 1, sepol, 4);
+        else if (op[5] == 'm')
+            add_rule(CMD_TYPE_CHANGE, 2, sepol, 4);
+        else
+            add_rule(CMD_TYPE_TRANSITION, 0, sepol, 5);
+        return true;
+    }
+
+    if (!strcmp(op, "genfscon")) {
+        for (a = 0; a < 3; a++)
+            sepol[a] = next_word(&p);
+        if (!sepol[2])
+            return false;
+        add_rule(CMD_GENFSCON, 0, sepol, 3);
+        return true;
+    }
+
+    return false;
+}
+
+// Split a rules file like ksud: statements end at newlines and ';', and
+// lines starting with '#' are comments
+static void parse_rules(const char *path)
+{
+    char *buf = NULL, *line, *save;
+    size_t cap = 0, len;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    len = getdelim(&buf, &cap, '\0', f);
+    fclose(f);
+    if (len == (size_t)-1)
+        return;
+
+    for (line = strtok_r(buf, "\n;", &save); line;
+         line = strtok_r(NULL, "\n;", &save)) {
+        while (*line == ' ' || *line == '\t')
+            line++;
+        if (*line == '#')
+            continue;
+        if (!parse_statement(line))
+            fprintf(stderr, "%s: cannot parse: %s\n", path, line);
+    }
+}
+
+// Every run loads into the same selinux_policy, so the policydb address
+// repeats like it can in the kernel and only the generation tells the
+// policies apart. The previous policy is leaked, not freed.
+static struct selinux_policy policy_slot;
+
+static struct policydb *load_policy(const char *path, u32 seqno)
+{
+    struct selinux_policy *policy = &policy_slot;
+    struct policy_load_stats st;
+    struct policydb *db = &policy->policydb;
+    struct stat sb;
+    ktime_t start;
+    void *data;
+    int fd, rc;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &sb)) {
+        perror(path);
+        exit(1);
+    }
+    data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+
+    memset(policy, 0, sizeof(*policy));
+    start = ktime_get();
+    rc = policydb_load(db, data, sb.st_size, &st);
+    if (rc) {
+        fprintf(stderr, "%s: not a loadable policy (%d)\n", path, rc);
+        exit(1);
+    }
+    munmap(data, sb.st_size);
+
+    // a new policy, like selinux_policy_commit()
+    policy->latest_granting = seqno;
+    selinux_state.policy = policy;
+
+    printf("load: %lld us, policy %u, %u types, %u classes, %u roles, "
+           "avtab %u + %u conditional, %u filename transitions",
+           ktime_us_delta(ktime_get(), start), db->policyvers,
+           db->p_types.nprim, db->p_classes.nprim, db->p_roles.nprim,
+           db->te_avtab.nel, db->te_cond_avtab.nel, st.filename_trans);
+    if (st.trailing)
+        printf(", %zu trailing bytes", st.trailing);
+    printf("\n");
+    return db;
+}
+
+// Invariants the patcher must keep, whatever it added. Types past the
+// loaded ones must be in every role, like add_types() puts them.
+// With roles false the new types may be missing from roles, which is what
+// a failed ebitmap node leaves behind in add_types()
+static int check_policy(struct policydb *db, u32 loaded_types, bool roles)
+{
+    u32 i, r, nel = 0, errors = 0;
+    struct avtab_node *node;
+
+    for (i = 0; i < db->te_avtab.nslot; i++) {
+        for (node = db->te_avtab.htable[i]; node; node = node->next)
+            nel++;
+    }
+    if (nel != db->te_avtab.nel) {
+        printf("check: avtab holds %u nodes, nel is %u\n", nel,
+               db->te_avtab.nel);
+        errors++;
+    }
+
+    for (i = 0; i < db->p_types.nprim; i++) {
+        struct type_datum *type = db->type_val_to_struct[i];
+        const char *name = db->sym_val_to_name[SYM_TYPES][i];
+
+        if (!type || !name || type->value != i + 1 ||
+            symtab_search(&db->p_types, name) != type) {
+            printf("check: type %u is not indexed\n", i + 1);
+            errors++;
+            continue;
+        }
+        if (!ebitmap_get_bit(&db->type_attr_map_array[i], i)) {
+            printf("check: type %s is not in its own attribute map\n",
+                   name);
+            errors++;
+        }
+        for (r = 0; roles && i >= loaded_types && r < db->p_roles.nprim;
+             r++) {
+            if (!ebitmap_get_bit(&db->role_val_to_struct[r]->types, i)) {
+                printf("check: type %s is not in role %s\n", name,
+                       db->sym_val_to_name[SYM_ROLES][r]);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+struct phase {
+    const char *what;
+    ktime_t start;
+    u32 avtab, types;
+    unsigned long allocs, atomic_allocs, resets;
+};
+
+static void phase_begin(struct policydb *db, struct phase *ph,
+                        const char *what)
+{
+    ph->what = what;
+    ph->avtab = db->te_avtab.nel;
+    ph->types = db->p_types.nprim;
+    ph->allocs = shim_allocs;
+    ph->atomic_allocs = shim_atomic_allocs;
+    ph->resets = avc_resets;
+    ph->start = ktime_get();
+}
+
+static void phase_end(struct policydb *db, const struct phase *ph)
+{
+    s64 us = ktime_us_delta(ktime_get(), ph->start);
+
+    printf("%s: %lld us, avtab %u -> %u, types %u -> %u, "
+           "%lu allocations (%lu atomic), %lu avc resets\n",
+           ph->what, us, ph->avtab, db->te_avtab.nel, ph->types,
+           db->p_types.nprim, shim_allocs - ph->allocs,
+           shim_atomic_allocs - ph->atomic_allocs, avc_resets - ph->resets);
+}
+
+// One SET_SEPOLICY ioctl per rule, like ksud before batching
+static u32 apply_single(void)
+{
+    u32 i, failed = 0;
+
+    for (i = 0; i < nr_rules; i++) {
+        if (handle_sepolicy(0, &rules[i]) < 0)
+            failed++;
+    }
+    return failed;
+}
+
+// KSU_IOCTL_BATCH chunks of KSU_BATCH_MAX rules, grouped into runs like
+// do_set_sepolicy_run() in supercalls.c
+static u32 apply_batched(bool stop)
+{
+    void *args[KSU_SEPOLICY_RUN_MAX];
+    int results[KSU_SEPOLICY_RUN_MAX];
+    u32 i = 0, failed = 0;
+
+    while (i < nr_rules) {
+        struct ksu_sepolicy_batch batch = {};
+        u32 end = min_t(u32, nr_rules, i + KSU_BATCH_MAX);
+        bool stopped = false;
+
+        while (i < end && !stopped) {
+            u32 decl = ksu_sepolicy_decl_cmd(&rules[i]), n = 1, k;
+
+            args[0] = &rules[i];
+            while (decl && n < KSU_SEPOLICY_RUN_MAX && i + n < end &&
+                   ksu_sepolicy_decl_cmd(&rules[i + n]) == decl) {
+                args[n] = &rules[i + n];
+                n++;
+            }
+            n = handle_sepolicy_decls(&batch, args, n, stop, results);
+            for (k = 0; k < n; k++) {
+                if (results[k] < 0)
+                    failed++;
+            }
+            i += n;
+            stopped = stop && results[n - 1] < 0;
+        }
+        ksu_flush_avc_cache(&batch);
+        if (stopped)
+            break;
+    }
+    return failed;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-1] [-s] [-n] [-v] [-r runs] [-f alloc] policy "
+            "[rules...]\n"
+            "  -1  one ioctl per rule instead of batches\n"
+            "  -s  stop batches at the first failing rule\n"
+            "  -n  skip apply_kernelsu_rules\n"
+            "  -v  kernel log, twice for debug messages\n"
+            "  -r  load and patch the policy this many times\n"
+            "  -f  fail this allocation of the module rules, 1 based\n",
+            argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    bool single = false, stop = false, ksu_rules = true;
+    unsigned long fail_at = 0;
+    int opt, runs = 1, run, errors = 0;
+
+    while ((opt = getopt(argc, argv, "1snvr:f:")) != -1) {
+        switch (opt) {
+        case '1':
+            single = true;
+            break;
+        case 's':
+            stop = true;
+            break;
+        case 'n':
+            ksu_rules = false;
+            break;
+        case 'v':
+            shim_loglevel++;
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'f':
+            fail_at = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc || runs < 1)
+        usage(argv[0]);
+
+    for (opt = optind + 1; opt < argc; opt++)
+        parse_rules(argv[opt]);
+
+    for (run = 0; run < runs; run++) {
+        struct policydb *db = load_policy(argv[optind], run + 1);
+        u32 loaded_types = db->p_types.nprim;
+        struct phase ph;
+        bool roles = true;
+
+        if (ksu_rules) {
+            phase_begin(db, &ph, "apply_kernelsu_rules");
+            apply_kernelsu_rules();
+            phase_end(db, &ph);
+        }
+
+        if (nr_rules) {
+            u32 failed;
+
+            phase_begin(db, &ph, single ? "module rules, single" :
+                                          "module rules, batched");
+            shim_failed_atomic = false;
+            shim_fail_at = fail_at ? shim_allocs + fail_at : 0;
+            failed = single ? apply_single() : apply_batched(stop);
+            shim_fail_at = 0;
+            phase_end(db, &ph);
+            printf("module rules: %u rules, %u failed\n", nr_rules, failed);
+
+            // nothing falls back from a failed ebitmap node, so some
+            // rule has to report it
+            if (shim_failed_atomic && !failed) {
+                printf("check: an ebitmap node failed and no rule did\n");
+                errors++;
+            }
+            roles = !shim_failed_atomic;
+        }
+
+        errors += check_policy(db, loaded_types, roles);
+    }
+
+    ksu_sepolicy_exit();
+    printf("check: %s\n", errors ? "FAILED" : "ok");
+    return !!errors;
+}
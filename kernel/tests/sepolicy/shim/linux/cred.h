@@ -0,0 +1,6 @@
+#ifndef SEPOLICY_SHIM_CRED_H
+#define SEPOLICY_SHIM_CRED_H
+
+struct cred;
+
+#endif
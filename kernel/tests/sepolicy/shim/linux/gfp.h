@@ -0,0 +1,9 @@
+#ifndef SEPOLICY_SHIM_GFP_H
+#define SEPOLICY_SHIM_GFP_H
+
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL 0u
+#define GFP_ATOMIC 1u
+
+#endif
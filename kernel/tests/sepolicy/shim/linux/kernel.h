@@ -0,0 +1,17 @@
+#ifndef SEPOLICY_SHIM_KERNEL_H
+#define SEPOLICY_SHIM_KERNEL_H
+
+#include_next <linux/kernel.h>
+
+#include <limits.h>
+
+#define U16_MAX UINT16_MAX
+#define U32_MAX UINT32_MAX
+#define BITS_PER_LONG (8 * (int)sizeof(long))
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define min_t(type, a, b) ((type)(a) < (type)(b) ? (type)(a) : (type)(b))
+#define max_t(type, a, b) ((type)(a) > (type)(b) ? (type)(a) : (type)(b))
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SEPOLICY_SHIM_LSM_AUDIT_H
+#define SEPOLICY_SHIM_LSM_AUDIT_H
+
+#include <linux/mutex.h>
+
+#endif
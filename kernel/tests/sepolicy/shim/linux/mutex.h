@@ -0,0 +1,13 @@
+#ifndef SEPOLICY_SHIM_MUTEX_H
+#define SEPOLICY_SHIM_MUTEX_H
+
+// the bench is single threaded
+struct mutex {
+    int locked;
+};
+
+#define DEFINE_MUTEX(name) struct mutex name = { 0 }
+#define mutex_lock(m) ((m)->locked++)
+#define mutex_unlock(m) ((m)->locked--)
+
+#endif
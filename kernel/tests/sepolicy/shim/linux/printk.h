@@ -0,0 +1,22 @@
+#ifndef SEPOLICY_SHIM_PRINTK_H
+#define SEPOLICY_SHIM_PRINTK_H
+
+#include <stdio.h>
+
+// 0 errors only, 1 adds warnings and info, 2 adds debug; set by the bench
+extern int shim_loglevel;
+
+#define pr_fmt(fmt) fmt
+
+#define shim_printk(level, fmt, ...)                              \
+    do {                                                          \
+        if (shim_loglevel >= (level))                             \
+            fprintf(stderr, pr_fmt(fmt), ##__VA_ARGS__);          \
+    } while (0)
+
+#define pr_err(fmt, ...) shim_printk(0, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...) shim_printk(1, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...) shim_printk(1, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) shim_printk(2, fmt, ##__VA_ARGS__)
+
+#endif
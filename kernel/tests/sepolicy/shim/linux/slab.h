@@ -0,0 +1,50 @@
+#ifndef SEPOLICY_SHIM_SLAB_H
+#define SEPOLICY_SHIM_SLAB_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+// Every allocation of the code under test goes through shim_alloc(), which
+// counts them and fails the shim_fail_at'th one (1 based, 0 never fails).
+// shim_failed_atomic tells whether that one was a GFP_ATOMIC allocation.
+extern unsigned long shim_allocs, shim_atomic_allocs, shim_fail_at;
+extern bool shim_failed_atomic;
+
+static inline void *shim_alloc(size_t size, gfp_t flags)
+{
+    shim_allocs++;
+    if (flags == GFP_ATOMIC)
+        shim_atomic_allocs++;
+    if (shim_fail_at && shim_allocs == shim_fail_at) {
+        shim_failed_atomic = flags == GFP_ATOMIC;
+        return NULL;
+    }
+    return calloc(1, size ? size : 1);
+}
+
+#define kmalloc(size, flags) shim_alloc(size, flags)
+#define kzalloc(size, flags) shim_alloc(size, flags)
+#define kcalloc(n, size, flags) shim_alloc((size_t)(n) * (size), flags)
+#define kvcalloc(n, size, flags) kcalloc(n, size, flags)
+#define kvfree(ptr) kfree(ptr)
+
+static inline void kfree(const void *ptr)
+{
+    free((void *)ptr);
+}
+
+static inline char *kstrdup(const char *s, gfp_t flags)
+{
+    size_t len = strlen(s) + 1;
+    char *p = shim_alloc(len, flags);
+
+    if (p)
+        memcpy(p, s, len);
+    return p;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef SEPOLICY_SHIM_STRINGHASH_H
+#define SEPOLICY_SHIM_STRINGHASH_H
+
+static inline unsigned long partial_name_hash(unsigned long c,
+                                              unsigned long prevhash)
+{
+    return (prevhash + (c << 4) + (c >> 4)) * 11;
+}
+
+#endif
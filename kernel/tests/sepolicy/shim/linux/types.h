@@ -0,0 +1,9 @@
+#ifndef SEPOLICY_SHIM_TYPES_H
+#define SEPOLICY_SHIM_TYPES_H
+
+#include_next <linux/types.h>
+
+#define __user
+#define __maybe_unused __attribute__((unused))
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SEPOLICY_SHIM_UACCESS_H
+#define SEPOLICY_SHIM_UACCESS_H
+
+#include <errno.h>
+#include <string.h>
+
+#include <linux/types.h>
+
+// "user" memory is the bench's own; NULL stands in for a bad pointer
+static inline unsigned long copy_from_user(void *to, const void *from,
+                                           unsigned long n)
+{
+    if (!from)
+        return n;
+    memcpy(to, from, n);
+    return 0;
+}
+
+static inline long strncpy_from_user(char *dst, const char *src, long count)
+{
+    long len;
+
+    if (!src)
+        return -EFAULT;
+    len = strnlen(src, count);
+    memcpy(dst, src, len < count ? len + 1 : count);
+    return len;
+}
+
+#define get_user(x, ptr) ((ptr) ? ((x) = *(ptr), 0) : -EFAULT)
+
+#endif
@@ -0,0 +1,34 @@
+// security/selinux/ss/constraint.h (6.1)
+#ifndef SEPOLICY_SHIM_CONSTRAINT_H
+#define SEPOLICY_SHIM_CONSTRAINT_H
+
+#include "ebitmap.h"
+
+#define CEXPR_MAXDEPTH 5
+
+struct constraint_expr {
+#define CEXPR_NOT 1
+#define CEXPR_AND 2
+#define CEXPR_OR 3
+#define CEXPR_ATTR 4
+#define CEXPR_NAMES 5
+    u32 expr_type;
+    u32 attr;
+#define CEXPR_USER 1
+#define CEXPR_ROLE 2
+#define CEXPR_TYPE 4
+#define CEXPR_TARGET 8
+#define CEXPR_XTARGET 16
+    u32 op;
+    struct ebitmap names;
+    struct type_set *type_names;
+    struct constraint_expr *next;
+};
+
+struct constraint_node {
+    u32 permissions;
+    struct constraint_expr *expr;
+    struct constraint_node *next;
+};
+
+#endif
@@ -0,0 +1,78 @@
+// Layout and iteration of security/selinux/ss/ebitmap.h (6.1)
+#ifndef SEPOLICY_SHIM_EBITMAP_H
+#define SEPOLICY_SHIM_EBITMAP_H
+
+#include <string.h>
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#define EBITMAP_NODE_SIZE 64
+#define EBITMAP_UNIT_NUMS                                                  \
+    ((EBITMAP_NODE_SIZE - sizeof(void *) - sizeof(u32)) /                  \
+     sizeof(unsigned long))
+#define EBITMAP_UNIT_SIZE BITS_PER_LONG
+#define EBITMAP_SIZE (EBITMAP_UNIT_NUMS * EBITMAP_UNIT_SIZE)
+
+struct ebitmap_node {
+    struct ebitmap_node *next;
+    unsigned long maps[EBITMAP_UNIT_NUMS];
+    u32 startbit;
+};
+
+struct ebitmap {
+    struct ebitmap_node *node;
+    u32 highbit;
+};
+
+#define ebitmap_length(e) ((e)->highbit)
+
+unsigned int ebitmap_node_find_bit(const struct ebitmap_node *n,
+                                   unsigned int from);
+
+static inline void ebitmap_init(struct ebitmap *e)
+{
+    memset(e, 0, sizeof(*e));
+}
+
+static inline unsigned int ebitmap_start_positive(const struct ebitmap *e,
+                                                  struct ebitmap_node **n)
+{
+    unsigned int ofs;
+
+    for (*n = e->node; *n; *n = (*n)->next) {
+        ofs = ebitmap_node_find_bit(*n, 0);
+        if (ofs < EBITMAP_SIZE)
+            return (*n)->startbit + ofs;
+    }
+    return ebitmap_length(e);
+}
+
+static inline unsigned int ebitmap_next_positive(const struct ebitmap *e,
+                                                 struct ebitmap_node **n,
+                                                 unsigned int bit)
+{
+    unsigned int ofs;
+
+    ofs = ebitmap_node_find_bit(*n, bit - (*n)->startbit + 1);
+    if (ofs < EBITMAP_SIZE)
+        return ofs + (*n)->startbit;
+
+    for (*n = (*n)->next; *n; *n = (*n)->next) {
+        ofs = ebitmap_node_find_bit(*n, 0);
+        if (ofs < EBITMAP_SIZE)
+            return ofs + (*n)->startbit;
+    }
+    return ebitmap_length(e);
+}
+
+#define ebitmap_for_each_positive_bit(e, n, bit)                           \
+    for ((bit) = ebitmap_start_positive(e, &(n));                          \
+         (bit) < ebitmap_length(e);                                        \
+         (bit) = ebitmap_next_positive(e, &(n), bit))
+
+int ebitmap_get_bit(const struct ebitmap *e, unsigned long bit);
+int ebitmap_set_bit(struct ebitmap *e, unsigned long bit, int value);
+void ebitmap_destroy(struct ebitmap *e);
+
+#endif
@@ -0,0 +1,84 @@
+// security/selinux/ss/hashtab.h (6.1)
+#ifndef SEPOLICY_SHIM_HASHTAB_H
+#define SEPOLICY_SHIM_HASHTAB_H
+
+#include <errno.h>
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#define HASHTAB_MAX_NODES U32_MAX
+
+struct hashtab_key_params {
+    u32 (*hash)(const void *key);
+    int (*cmp)(const void *key1, const void *key2);
+};
+
+struct hashtab_node {
+    void *key;
+    void *datum;
+    struct hashtab_node *next;
+};
+
+struct hashtab {
+    struct hashtab_node **htable;
+    u32 size;
+    u32 nel;
+};
+
+int hashtab_init(struct hashtab *h, u32 nel_hint);
+
+int __hashtab_insert(struct hashtab *h, struct hashtab_node **dst, void *key,
+                     void *datum);
+
+static inline int hashtab_insert(struct hashtab *h, void *key, void *datum,
+                                 struct hashtab_key_params key_params)
+{
+    u32 hvalue;
+    struct hashtab_node *prev, *cur;
+
+    if (!h->size || h->nel == HASHTAB_MAX_NODES)
+        return -EINVAL;
+
+    hvalue = key_params.hash(key) & (h->size - 1);
+    prev = NULL;
+    cur = h->htable[hvalue];
+    while (cur) {
+        int cmp = key_params.cmp(key, cur->key);
+
+        if (cmp == 0)
+            return -EEXIST;
+        if (cmp < 0)
+            break;
+        prev = cur;
+        cur = cur->next;
+    }
+
+    return __hashtab_insert(h, prev ? &prev->next : &h->htable[hvalue], key,
+                            datum);
+}
+
+static inline void *hashtab_search(struct hashtab *h, const void *key,
+                                   struct hashtab_key_params key_params)
+{
+    u32 hvalue;
+    struct hashtab_node *cur;
+
+    if (!h->size)
+        return NULL;
+
+    hvalue = key_params.hash(key) & (h->size - 1);
+    cur = h->htable[hvalue];
+    while (cur) {
+        int cmp = key_params.cmp(key, cur->key);
+
+        if (cmp == 0)
+            return cur->datum;
+        if (cmp < 0)
+            break;
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,157 @@
+// The parts of security/selinux/ss/policydb.h (6.1) the patcher and the
+// bench's policy loader use
+#ifndef SEPOLICY_SHIM_POLICYDB_H
+#define SEPOLICY_SHIM_POLICYDB_H
+
+#include <linux/stringhash.h>
+#include <linux/types.h>
+
+#include "avtab.h"
+#include "constraint.h"
+#include "ebitmap.h"
+#include "symtab.h"
+
+#define POLICYDB_VERSION_BASE 15
+#define POLICYDB_VERSION_BOOL 16
+#define POLICYDB_VERSION_IPV6 17
+#define POLICYDB_VERSION_NLCLASS 18
+#define POLICYDB_VERSION_VALIDATETRANS 19
+#define POLICYDB_VERSION_MLS 19
+#define POLICYDB_VERSION_AVTAB 20
+#define POLICYDB_VERSION_RANGETRANS 21
+#define POLICYDB_VERSION_POLCAP 22
+#define POLICYDB_VERSION_PERMISSIVE 23
+#define POLICYDB_VERSION_BOUNDARY 24
+#define POLICYDB_VERSION_FILENAME_TRANS 25
+#define POLICYDB_VERSION_ROLETRANS 26
+#define POLICYDB_VERSION_NEW_OBJECT_DEFAULTS 27
+#define POLICYDB_VERSION_DEFAULT_TYPE 28
+#define POLICYDB_VERSION_CONSTRAINT_NAMES 29
+#define POLICYDB_VERSION_XPERMS_IOCTL 30
+#define POLICYDB_VERSION_INFINIBAND 31
+#define POLICYDB_VERSION_GLBLUB 32
+#define POLICYDB_VERSION_COMP_FTRANS 33
+
+#define POLICYDB_VERSION_MIN POLICYDB_VERSION_BASE
+#define POLICYDB_VERSION_MAX POLICYDB_VERSION_COMP_FTRANS
+
+struct perm_datum {
+    u32 value;
+};
+
+struct common_datum {
+    u32 value;
+    struct symtab permissions;
+};
+
+struct class_datum {
+    u32 value;
+    char *comkey;
+    struct common_datum *comdatum;
+    struct symtab permissions;
+    struct constraint_node *constraints;
+    struct constraint_node *validatetrans;
+    char default_user;
+    char default_role;
+    char default_type;
+    char default_range;
+};
+
+struct role_datum {
+    u32 value;
+    u32 bounds;
+    struct ebitmap dominates;
+    struct ebitmap types;
+};
+
+struct type_datum {
+    u32 value;
+    u32 bounds;
+    unsigned char primary;
+    unsigned char attribute;
+};
+
+// users, booleans, sensitivities and categories: the bench only keeps
+// their values
+struct value_datum {
+    u32 value;
+};
+
+struct type_set {
+    struct ebitmap types;
+    struct ebitmap negset;
+    u32 flags;
+};
+
+struct filename_trans_key {
+    u32 ttype;
+    u16 tclass;
+    const char *name;
+};
+
+struct filename_trans_datum {
+    struct ebitmap stypes;
+    u32 otype;
+    struct filename_trans_datum *next;
+};
+
+#define SYM_COMMONS 0
+#define SYM_CLASSES 1
+#define SYM_ROLES 2
+#define SYM_TYPES 3
+#define SYM_USERS 4
+#define SYM_BOOLS 5
+#define SYM_LEVELS 6
+#define SYM_CATS 7
+#define SYM_NUM 8
+
+#define OCON_ISID 0
+#define OCON_FS 1
+#define OCON_PORT 2
+#define OCON_NETIF 3
+#define OCON_NODE 4
+#define OCON_FSUSE 5
+#define OCON_NODE6 6
+#define OCON_IBPKEY 7
+#define OCON_IBENDPORT 8
+#define OCON_NUM 9
+
+struct policydb {
+    int mls_enabled;
+
+    struct symtab symtab[SYM_NUM];
+#define p_commons symtab[SYM_COMMONS]
+#define p_classes symtab[SYM_CLASSES]
+#define p_roles symtab[SYM_ROLES]
+#define p_types symtab[SYM_TYPES]
+#define p_users symtab[SYM_USERS]
+#define p_bools symtab[SYM_BOOLS]
+#define p_levels symtab[SYM_LEVELS]
+#define p_cats symtab[SYM_CATS]
+
+    char **sym_val_to_name[SYM_NUM];
+
+    struct class_datum **class_val_to_struct;
+    struct role_datum **role_val_to_struct;
+    struct type_datum **type_val_to_struct;
+
+    struct avtab te_avtab;
+    struct avtab te_cond_avtab;
+
+    struct hashtab filename_trans;
+    u32 compat_filename_trans_count;
+
+    struct ebitmap *type_attr_map_array;
+    struct ebitmap policycaps;
+    struct ebitmap permissive_map;
+
+    size_t len;
+    unsigned int policyvers;
+    unsigned int reject_unknown : 1;
+    unsigned int allow_unknown : 1;
+};
+
+struct filename_trans_datum *
+policydb_filenametr_search(struct policydb *p, struct filename_trans_key *key);
+
+#endif
@@ -0,0 +1,28 @@
+// selinux_state and selinux_policy of security/selinux/include/security.h
+// and ss/services.h (6.1), with the avc hooks rules.c calls
+#ifndef SEPOLICY_SHIM_SERVICES_H
+#define SEPOLICY_SHIM_SERVICES_H
+
+#include <linux/types.h>
+
+#include "policydb.h"
+
+struct selinux_avc;
+
+struct selinux_policy {
+    struct policydb policydb;
+    u32 latest_granting;
+};
+
+struct selinux_state {
+    struct selinux_avc *avc;
+    struct selinux_policy *policy;
+};
+
+extern struct selinux_state selinux_state;
+
+int avc_ss_reset(struct selinux_avc *avc, u32 seqno);
+void selnl_notify_policyload(u32 seqno);
+void selinux_status_update_policyload(struct selinux_state *state, u32 seqno);
+
+#endif
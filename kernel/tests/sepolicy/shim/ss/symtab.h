@@ -0,0 +1,16 @@
+// security/selinux/ss/symtab.h (6.1)
+#ifndef SEPOLICY_SHIM_SYMTAB_H
+#define SEPOLICY_SHIM_SYMTAB_H
+
+#include "hashtab.h"
+
+struct symtab {
+    struct hashtab table;
+    u32 nprim;
+};
+
+int symtab_init(struct symtab *s, u32 size);
+int symtab_insert(struct symtab *s, char *name, void *datum);
+void *symtab_search(struct symtab *s, const char *name);
+
+#endif
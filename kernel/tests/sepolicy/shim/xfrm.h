@@ -0,0 +1,6 @@
+#ifndef SEPOLICY_SHIM_XFRM_H
+#define SEPOLICY_SHIM_XFRM_H
+
+void selinux_xfrm_notify_policyload(void);
+
+#endif
@@ -0,0 +1,404 @@
+//
+// Userspace versions of the security/selinux/ss functions the patcher
+// calls, following their 6.1 implementations so hashing, ordering and
+// node layout match what the kernel would see.
+//
+#include <linux/slab.h>
+
+#include "ss/policydb.h"
+
+unsigned int ebitmap_node_find_bit(const struct ebitmap_node *n,
+                                   unsigned int from)
+{
+    unsigned int bit;
+
+    for (bit = from; bit < EBITMAP_SIZE; bit++) {
+        if (n->maps[bit / EBITMAP_UNIT_SIZE] &
+            (1UL << (bit % EBITMAP_UNIT_SIZE)))
+            return bit;
+    }
+    return EBITMAP_SIZE;
+}
+
+static int ebitmap_node_get_bit(const struct ebitmap_node *n,
+                                unsigned int bit)
+{
+    unsigned int ofs = bit - n->startbit;
+
+    return 1 & (n->maps[ofs / EBITMAP_UNIT_SIZE] >>
+                (ofs % EBITMAP_UNIT_SIZE));
+}
+
+int ebitmap_get_bit(const struct ebitmap *e, unsigned long bit)
+{
+    const struct ebitmap_node *n;
+
+    if (e->highbit < bit)
+        return 0;
+
+    for (n = e->node; n && n->startbit <= bit; n = n->next) {
+        if (n->startbit + EBITMAP_SIZE > bit)
+            return ebitmap_node_get_bit(n, bit);
+    }
+    return 0;
+}
+
+int ebitmap_set_bit(struct ebitmap *e, unsigned long bit, int value)
+{
+    struct ebitmap_node *n, *prev = NULL, *new;
+
+    for (n = e->node; n && n->startbit <= bit; prev = n, n = n->next) {
+        unsigned int ofs = bit - n->startbit;
+
+        if (n->startbit + EBITMAP_SIZE <= bit)
+            continue;
+        if (value) {
+            n->maps[ofs / EBITMAP_UNIT_SIZE] |=
+                1UL << (ofs % EBITMAP_UNIT_SIZE);
+            return 0;
+        }
+        n->maps[ofs / EBITMAP_UNIT_SIZE] &=
+            ~(1UL << (ofs % EBITMAP_UNIT_SIZE));
+        if (ebitmap_node_find_bit(n, 0) < EBITMAP_SIZE)
+            return 0;
+        // drop the emptied node
+        if (!n->next)
+            e->highbit = prev ? prev->startbit + EBITMAP_SIZE : 0;
+        if (prev)
+            prev->next = n->next;
+        else
+            e->node = n->next;
+        kfree(n);
+        return 0;
+    }
+
+    if (!value)
+        return 0;
+
+    // kmem_cache_zalloc(ebitmap_node_cachep, GFP_ATOMIC) in the kernel
+    new = kzalloc(sizeof(*new), GFP_ATOMIC);
+    if (!new)
+        return -ENOMEM;
+
+    new->startbit = bit - (bit % EBITMAP_SIZE);
+    new->maps[(bit - new->startbit) / EBITMAP_UNIT_SIZE] |=
+        1UL << ((bit - new->startbit) % EBITMAP_UNIT_SIZE);
+
+    if (!n)
+        e->highbit = new->startbit + EBITMAP_SIZE;
+
+    if (prev) {
+        new->next = prev->next;
+        prev->next = new;
+    } else {
+        new->next = e->node;
+        e->node = new;
+    }
+    return 0;
+}
+
+void ebitmap_destroy(struct ebitmap *e)
+{
+    struct ebitmap_node *n = e->node, *next;
+
+    while (n) {
+        next = n->next;
+        kfree(n);
+        n = next;
+    }
+    e->node = NULL;
+    e->highbit = 0;
+}
+
+static u32 roundup_pow_of_two(u32 n)
+{
+    u32 size = 1;
+
+    while (size < n)
+        size <<= 1;
+    return size;
+}
+
+int hashtab_init(struct hashtab *h, u32 nel_hint)
+{
+    u32 size = nel_hint ? roundup_pow_of_two(nel_hint) : 0;
+
+    h->size = 0;
+    h->nel = 0;
+    h->htable = NULL;
+    if (size) {
+        h->htable = kcalloc(size, sizeof(*h->htable), GFP_KERNEL);
+        if (!h->htable)
+            return -ENOMEM;
+        h->size = size;
+    }
+    return 0;
+}
+
+int __hashtab_insert(struct hashtab *h, struct hashtab_node **dst, void *key,
+                     void *datum)
+{
+    // kmem_cache_zalloc(hashtab_node_cachep, GFP_KERNEL) in the kernel
+    struct hashtab_node *newnode = kzalloc(sizeof(*newnode), GFP_KERNEL);
+
+    if (!newnode)
+        return -ENOMEM;
+    newnode->key = key;
+    newnode->datum = datum;
+    newnode->next = *dst;
+    *dst = newnode;
+    h->nel++;
+    return 0;
+}
+
+static u32 symhash(const void *key)
+{
+    const char *p;
+    u32 val = 0;
+
+    for (p = key; *p; p++)
+        val = (val << 4 | (val >> (8 * sizeof(u32) - 4))) ^ (*p);
+    return val;
+}
+
+static int symcmp(const void *key1, const void *key2)
+{
+    return strcmp(key1, key2);
+}
+
+static const struct hashtab_key_params symtab_key_params = {
+    .hash = symhash,
+    .cmp = symcmp,
+};
+
+int symtab_init(struct symtab *s, u32 size)
+{
+    s->nprim = 0;
+    return hashtab_init(&s->table, size);
+}
+
+int symtab_insert(struct symtab *s, char *name, void *datum)
+{
+    return hashtab_insert(&s->table, name, datum, symtab_key_params);
+}
+
+void *symtab_search(struct symtab *s, const char *name)
+{
+    return hashtab_search(&s->table, name, symtab_key_params);
+}
+
+static u32 avtab_hash(const struct avtab_key *keyp, u32 mask)
+{
+    static const u32 c1 = 0xcc9e2d51;
+    static const u32 c2 = 0x1b873593;
+    static const u32 r1 = 15;
+    static const u32 r2 = 13;
+    static const u32 m = 5;
+    static const u32 n = 0xe6546b64;
+    u32 hash = 0;
+
+#define mix(input)                                                         \
+    do {                                                                   \
+        u32 v = input;                                                     \
+        v *= c1;                                                           \
+        v = (v << r1) | (v >> (32 - r1));                                  \
+        v *= c2;                                                           \
+        hash ^= v;                                                         \
+        hash = (hash << r2) | (hash >> (32 - r2));                         \
+        hash = hash * m + n;                                               \
+    } while (0)
+
+    mix(keyp->target_class);
+    mix(keyp->target_type);
+    mix(keyp->source_type);
+
+#undef mix
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash & mask;
+}
+
+int avtab_alloc(struct avtab *h, u32 nrules)
+{
+    u32 shift = 1, work = nrules >> 3, nslot;
+
+    h->htable = NULL;
+    h->nel = 0;
+    h->nslot = 0;
+    h->mask = 0;
+    if (!nrules)
+        return 0;
+
+    while (work) {
+        work >>= 1;
+        shift++;
+    }
+    nslot = 1U << shift;
+    if (nslot > MAX_AVTAB_HASH_BUCKETS)
+        nslot = MAX_AVTAB_HASH_BUCKETS;
+
+    h->htable = kvcalloc(nslot, sizeof(*h->htable), GFP_KERNEL);
+    if (!h->htable)
+        return -ENOMEM;
+    h->nslot = nslot;
+    h->mask = nslot - 1;
+    return 0;
+}
+
+static bool avtab_same(const struct avtab_key *a, const struct avtab_key *b)
+{
+    return a->source_type == b->source_type &&
+           a->target_type == b->target_type &&
+           a->target_class == b->target_class;
+}
+
+// whether a sorts before b in a bucket
+static bool avtab_before(const struct avtab_key *a, const struct avtab_key *b)
+{
+    if (a->source_type != b->source_type)
+        return a->source_type < b->source_type;
+    if (a->target_type != b->target_type)
+        return a->target_type < b->target_type;
+    return a->target_class < b->target_class;
+}
+
+static struct avtab_node *avtab_insert_node(struct avtab *h, u32 hvalue,
+                                            struct avtab_node *prev,
+                                            const struct avtab_key *key,
+                                            const struct avtab_datum *datum)
+{
+    // kmem_cache_zalloc(avtab_node_cachep, GFP_KERNEL) in the kernel
+    struct avtab_node *newnode = kzalloc(sizeof(*newnode), GFP_KERNEL);
+
+    if (!newnode)
+        return NULL;
+    newnode->key = *key;
+
+    if (key->specified & AVTAB_XPERMS) {
+        struct avtab_extended_perms *xperms =
+            kzalloc(sizeof(*xperms), GFP_KERNEL);
+
+        if (!xperms) {
+            kfree(newnode);
+            return NULL;
+        }
+        *xperms = *datum->u.xperms;
+        newnode->datum.u.xperms = xperms;
+    } else {
+        newnode->datum.u.data = datum->u.data;
+    }
+
+    if (prev) {
+        newnode->next = prev->next;
+        prev->next = newnode;
+    } else {
+        newnode->next = h->htable[hvalue];
+        h->htable[hvalue] = newnode;
+    }
+
+    h->nel++;
+    return newnode;
+}
+
+struct avtab_node *avtab_insert_nonunique(struct avtab *h,
+                                         const struct avtab_key *key,
+                                         const struct avtab_datum *datum)
+{
+    struct avtab_node *prev = NULL, *cur;
+    u16 specified = key->specified & ~(AVTAB_ENABLED | AVTAB_ENABLED_OLD);
+    u32 hvalue;
+
+    if (!h || !h->nslot || h->nel == U32_MAX)
+        return NULL;
+
+    hvalue = avtab_hash(key, h->mask);
+    for (cur = h->htable[hvalue]; cur; prev = cur, cur = cur->next) {
+        if (avtab_same(key, &cur->key) && (specified & cur->key.specified))
+            break;
+        if (avtab_before(key, &cur->key))
+            break;
+    }
+    return avtab_insert_node(h, hvalue, prev, key, datum);
+}
+
+struct avtab_node *avtab_search_node(struct avtab *h,
+                                     const struct avtab_key *key)
+{
+    struct avtab_node *cur;
+    u16 specified = key->specified & ~(AVTAB_ENABLED | AVTAB_ENABLED_OLD);
+
+    if (!h || !h->nslot)
+        return NULL;
+
+    for (cur = h->htable[avtab_hash(key, h->mask)]; cur; cur = cur->next) {
+        if (avtab_same(key, &cur->key) && (specified & cur->key.specified))
+            return cur;
+        if (avtab_before(key, &cur->key))
+            break;
+    }
+    return NULL;
+}
+
+struct avtab_node *avtab_search_node_next(struct avtab_node *node,
+                                          u16 specified)
+{
+    struct avtab_node *cur;
+
+    if (!node)
+        return NULL;
+
+    specified &= ~(AVTAB_ENABLED | AVTAB_ENABLED_OLD);
+    for (cur = node->next; cur; cur = cur->next) {
+        if (avtab_same(&node->key, &cur->key) &&
+            (specified & cur->key.specified))
+            return cur;
+        if (avtab_before(&node->key, &cur->key))
+            break;
+    }
+    return NULL;
+}
+
+static u32 filenametr_hash(const void *k)
+{
+    const struct filename_trans_key *ft = k;
+    unsigned long hash = ft->ttype ^ ft->tclass;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)ft->name; *p; p++)
+        hash = partial_name_hash(*p, hash);
+    return hash;
+}
+
+static int filenametr_cmp(const void *k1, const void *k2)
+{
+    const struct filename_trans_key *ft1 = k1;
+    const struct filename_trans_key *ft2 = k2;
+    int v;
+
+    v = ft1->ttype - ft2->ttype;
+    if (v)
+        return v;
+
+    v = ft1->tclass - ft2->tclass;
+    if (v)
+        return v;
+
+    return strcmp(ft1->name, ft2->name);
+}
+
+const struct hashtab_key_params policydb_filenametr_key_params = {
+    .hash = filenametr_hash,
+    .cmp = filenametr_cmp,
+};
+
+struct filename_trans_datum *
+policydb_filenametr_search(struct policydb *p, struct filename_trans_key *key)
+{
+    return hashtab_search(&p->filename_trans, key,
+                          policydb_filenametr_key_params);
+}
@@ -0,0 +1,46 @@
+/*
+ * KUnit suite for the su path matching in sucompat.c, which includes this
+ * file when CONFIG_KSU_KUNIT_TEST is set.
+ */
+#include <kunit/test.h>
+
+// what the handlers hold after copying a user filename
+static bool test_is_su_path(const char *filename)
+{
+    char path[sizeof(SU_PATH) + 1];
+
+    memset(path, 0, sizeof(path));
+    strncpy(path, filename, sizeof(path));
+    return is_su_path(path);
+}
+
+static void test_su_path_match(struct kunit *test)
+{
+    KUNIT_EXPECT_TRUE(test, test_is_su_path(SU_PATH));
+}
+
+static void test_su_path_mismatch(struct kunit *test)
+{
+    KUNIT_EXPECT_FALSE(test, test_is_su_path(""));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("su"));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/bin/s"));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/xbin/su"));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/bin/sh"));
+    // longer paths are cut after one more byte, which must not match
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/bin/su2"));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/bin/su/"));
+    KUNIT_EXPECT_FALSE(test, test_is_su_path("/system/bin/sudo"));
+}
+
+static struct kunit_case sucompat_test_cases[] = {
+    KUNIT_CASE(test_su_path_match),
+    KUNIT_CASE(test_su_path_mismatch),
+    {}
+};
+
+static struct kunit_suite sucompat_test_suite = {
+    .name = "ksu_sucompat",
+    .test_cases = sucompat_test_cases,
+};
+
+kunit_test_suite(sucompat_test_suite);
@@ -0,0 +1,5 @@
+#include <unistd.h>
+
+#include <linux/uidgid.h>
+
+#define current_uid() ((kuid_t){ getuid() })
@@ -0,0 +1,105 @@
+// Just enough of the VFS for throne_tracker.c, on top of POSIX
+#ifndef THRONE_SHIM_FS_H
+#define THRONE_SHIM_FS_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <linux/err.h>
+#include <linux/types.h>
+
+struct super_block {
+    unsigned long s_magic;
+};
+
+struct inode {
+    struct super_block *i_sb;
+};
+
+struct file {
+    int fd;
+    struct inode *f_inode;
+    struct inode inode;
+    struct super_block sb;
+};
+
+struct dir_context;
+typedef bool (*filldir_t)(struct dir_context *, const char *, int, loff_t,
+                          u64, unsigned int);
+
+struct dir_context {
+    filldir_t actor;
+    loff_t pos;
+};
+
+// counted by the harness
+extern unsigned long shim_filp_opens;
+
+static inline struct file *filp_open(const char *path, int flags, int mode)
+{
+    struct file *file;
+    struct statfs st;
+    int fd = open(path, flags, mode);
+
+    shim_filp_opens++;
+    if (fd < 0)
+        return ERR_PTR(-errno);
+
+    file = calloc(1, sizeof(*file));
+    file->fd = fd;
+    file->sb.s_magic = fstatfs(fd, &st) ? 0 : (unsigned long)st.f_type;
+    file->inode.i_sb = &file->sb;
+    file->f_inode = &file->inode;
+    return file;
+}
+
+static inline int filp_close(struct file *file, void *id)
+{
+    close(file->fd);
+    free(file);
+    return 0;
+}
+
+static inline ssize_t kernel_read(struct file *file, void *buf, size_t count,
+                                  loff_t *pos)
+{
+    ssize_t ret = pread(file->fd, buf, count, *pos);
+
+    if (ret < 0)
+        return -errno;
+    *pos += ret;
+    return ret;
+}
+
+static inline int iterate_dir(struct file *file, struct dir_context *ctx)
+{
+    DIR *dir = fdopendir(dup(file->fd));
+    struct dirent *de;
+
+    if (!dir)
+        return -errno;
+    while ((de = readdir(dir))) {
+        if (!ctx->actor(ctx, de->d_name, strlen(de->d_name), ctx->pos++,
+                        de->d_ino, de->d_type))
+            break;
+    }
+    closedir(dir);
+    return 0;
+}
+
+static inline unsigned int full_name_hash(const void *salt, const char *name,
+                                          unsigned int len)
+{
+    unsigned int hash = 2166136261u;
+
+    while (len--)
+        hash = (hash ^ (unsigned char)*name++) * 16777619u;
+    return hash;
+}
+
+#endif
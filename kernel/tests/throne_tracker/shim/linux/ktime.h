@@ -0,0 +1,23 @@
+#ifndef THRONE_SHIM_KTIME_H
+#define THRONE_SHIM_KTIME_H
+
+#include <time.h>
+
+#include <linux/types.h>
+
+typedef s64 ktime_t;
+
+static inline ktime_t ktime_get(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline s64 ktime_us_delta(ktime_t later, ktime_t earlier)
+{
+    return (later - earlier) / 1000;
+}
+
+#endif
@@ -0,0 +1 @@
+// nothing of it is used on the host
@@ -0,0 +1,12 @@
+#ifndef THRONE_SHIM_SLAB_H
+#define THRONE_SHIM_SLAB_H
+
+#include <stdlib.h>
+
+#define GFP_KERNEL 0
+#define GFP_ATOMIC 0
+
+#define kzalloc(size, flags) calloc(1, size)
+#define kfree(ptr) free(ptr)
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef THRONE_SHIM_UIDGID_H
+#define THRONE_SHIM_UIDGID_H
+
+#include <sys/types.h>
+
+typedef struct {
+    uid_t val;
+} kuid_t;
+
+#endif
@@ -0,0 +1,322 @@
+//
+// Host benchmark of manager detection: builds a packages.list and a
+// /data/app tree with N packages, then runs track_throne on it through the
+// POSIX backed VFS in shim/. Reports time, reads, allocations and opens, so
+// changes to throne_tracker.c can be checked against large installs.
+// Usage: throne_bench [-n packages] [-u users] [-r runs] [-k] [-d dir]
+//
+#include <getopt.h>
+#include <openssl/sha.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "apk_tail.h"
+
+#define SYSTEM_PACKAGES_LIST_PATH "packages.list"
+#define DATA_APP_PATH "data/app"
+
+unsigned long shim_filp_opens;
+static unsigned long apk_opens;
+
+#include "throne_tracker.c"
+
+#define CERT_SIZE 0x385
+
+static u8 manager_cert[CERT_SIZE];
+static char manager_hash[SHA256_DIGEST_LENGTH * 2 + 1];
+
+bool is_manager_apk(char *path)
+{
+    static u8 buf[1 << 21];
+    bool ret = false;
+    ssize_t len;
+    int fd = open(path, O_RDONLY);
+
+    apk_opens++;
+    if (fd < 0)
+        return false;
+    len = read(fd, buf, sizeof(buf));
+    if (len > 0)
+        ret = apk_tail_check(buf, len, CERT_SIZE, manager_hash);
+    close(fd);
+    return ret;
+}
+
+void ksu_event_emit(u32 type, u32 data)
+{
+}
+
+// allowlist of the fixture: every fifth app for each user, plus one
+// uninstalled package per user
+static int nr_users, nr_packages;
+static unsigned long prune_kept, prune_checked;
+
+void ksu_prune_allowlist(bool (*is_uid_valid)(uid_t, char *, void *),
+                         void *data)
+{
+    char package[KSU_MAX_PACKAGE_NAME];
+    int user, i;
+
+    prune_kept = prune_checked = 0;
+    for (user = 0; user < nr_users; user++) {
+        for (i = 0; i <= nr_packages; i += 5) {
+            uid_t uid = user * PER_USER_RANGE + FIRST_APPLICATION_UID + i;
+
+            snprintf(package, sizeof(package), "com.fixture.app%d", i);
+            prune_kept += is_uid_valid(uid, package, data);
+            prune_checked++;
+        }
+    }
+}
+
+static uid_t package_uid(int i)
+{
+    // every tenth package shares the uid of the one before
+    return FIRST_APPLICATION_UID + (i % 10 == 9 ? i - 1 : i);
+}
+
+static void random_name(char *out, size_t len)
+{
+    static const char chars[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+    size_t i;
+
+    for (i = 0; i < len - 1; i++)
+        out[i] = chars[rand() % (sizeof(chars) - 1)];
+    out[len - 1] = '\0';
+}
+
+static void put32(u8 **p, u32 v)
+{
+    memcpy(*p, &v, 4);
+    *p += 4;
+}
+
+static void put64(u8 **p, u64 v)
+{
+    memcpy(*p, &v, 8);
+    *p += 8;
+}
+
+// the end of an APK with one v2 signer: signing block, central directory
+// and EOCD, the layout is described in kernel/apk_parse.c
+static size_t build_apk(u8 *out, const u8 *cert)
+{
+    const u32 digests = 40, cd_size = 46;
+    const u32 certs = 4 + CERT_SIZE;
+    const u32 signed_data = 4 + digests + 4 + certs;
+    const u32 signer = 4 + signed_data;
+    const u64 value = 4 + 4 + signer;
+    const u64 pair = 4 + value;
+    const u64 block = 8 + pair + 8 + 16;
+    u8 *p = out;
+
+    put64(&p, block);
+    put64(&p, pair);
+    put32(&p, 0x7109871a);
+    put32(&p, signer + 4);
+    put32(&p, signer);
+    put32(&p, signed_data);
+    put32(&p, digests);
+    memset(p, 0, digests);
+    p += digests;
+    put32(&p, certs);
+    put32(&p, CERT_SIZE);
+    memcpy(p, cert, CERT_SIZE);
+    p += CERT_SIZE;
+    put64(&p, block);
+    memcpy(p, "APK Sig Block 42", 16);
+    p += 16;
+
+    // the central directory starts right after the block
+    memset(p, 0, cd_size);
+    memcpy(p, "PK\x01\x02", 4);
+    p += cd_size;
+    put32(&p, 0x06054b50);
+    put32(&p, 0);
+    put32(&p, 0x00010001);
+    put32(&p, cd_size);
+    put32(&p, block + 8);
+    *p++ = 0;
+    *p++ = 0;
+    return p - out;
+}
+
+static void write_file(const char *path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (!fp || fwrite(data, 1, len, fp) != len) {
+        perror(path);
+        exit(1);
+    }
+    fclose(fp);
+}
+
+static void make_dir(const char *path)
+{
+    if (mkdir(path, 0755) && errno != EEXIST) {
+        perror(path);
+        exit(1);
+    }
+}
+
+// Android 11+ layout data/app/~~<random>==/<package>-<random>==/base.apk,
+// one in eight packages uses the older data/app/<package>-1/base.apk. A few
+// vmdl*.tmp staging dirs hold an APK that must not be opened.
+static void make_fixture(int manager)
+{
+    FILE *list = fopen(SYSTEM_PACKAGES_LIST_PATH, "w");
+    char dir[DATA_PATH_LEN], path[DATA_PATH_LEN + 16];
+    char r1[17], r2[17];
+    u8 apk[2048], cert[CERT_SIZE];
+    size_t len;
+    int i, j;
+
+    if (!list) {
+        perror(SYSTEM_PACKAGES_LIST_PATH);
+        exit(1);
+    }
+    make_dir("data");
+    make_dir(DATA_APP_PATH);
+
+    for (i = 0; i < nr_packages; i++) {
+        fprintf(list,
+                "com.fixture.app%d %u 0 /data/user/0/com.fixture.app%d "
+                "default:targetSdkVersion=34 3003\n",
+                i, package_uid(i), i);
+
+        random_name(r1, sizeof(r1));
+        random_name(r2, sizeof(r2));
+        if (i % 8 == 7) {
+            snprintf(dir, sizeof(dir), DATA_APP_PATH "/com.fixture.app%d-1", i);
+        } else {
+            snprintf(dir, sizeof(dir), DATA_APP_PATH "/~~%s==", r1);
+            make_dir(dir);
+            snprintf(dir + strlen(dir), sizeof(dir) - strlen(dir),
+                     "/com.fixture.app%d-%s==", i, r2);
+        }
+        make_dir(dir);
+
+        for (j = 0; j < CERT_SIZE; j++)
+            cert[j] = rand();
+        len = build_apk(apk, i == manager ? manager_cert : cert);
+        snprintf(path, sizeof(path), "%s/base.apk", dir);
+        write_file(path, apk, len);
+    }
+    fclose(list);
+
+    for (i = 0; i <= nr_packages / 20; i++) {
+        random_name(r1, sizeof(r1));
+        snprintf(dir, sizeof(dir), DATA_APP_PATH "/vmdl%s.tmp", r1);
+        make_dir(dir);
+        snprintf(path, sizeof(path), "%s/base.apk", dir);
+        write_file(path, apk, build_apk(apk, manager_cert));
+    }
+}
+
+static void report(const char *what, s64 us)
+{
+    printf("%-16s %8lld us  %6u packages %8u reads %5u dirs %5u apks "
+           "%6u allocs %6lu opens %6lu apk opens  manager uid %d\n",
+           what, (long long)us, throne_stats.packages, throne_stats.reads,
+           throne_stats.dirs, throne_stats.apks, throne_stats.allocs,
+           shim_filp_opens, apk_opens, (int)ksu_get_manager_uid());
+}
+
+static s64 run(bool prune_only)
+{
+    ktime_t start;
+
+    shim_filp_opens = apk_opens = 0;
+    start = ktime_get();
+    track_throne(prune_only);
+    return ktime_us_delta(ktime_get(), start);
+}
+
+int main(int argc, char **argv)
+{
+    char root[] = "/tmp/throne_bench.XXXXXX";
+    const char *dir = NULL;
+    int runs = 3, opt, i, failed = 0;
+    bool keep = false;
+    u8 digest[SHA256_DIGEST_LENGTH];
+    uid_t expected;
+
+    nr_packages = 1000;
+    nr_users = 2;
+    while ((opt = getopt(argc, argv, "n:u:r:kd:")) != -1) {
+        switch (opt) {
+        case 'n':
+            nr_packages = atoi(optarg);
+            break;
+        case 'u':
+            nr_users = atoi(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'k':
+            keep = true;
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-n packages] [-u users] [-r runs] [-k] [-d dir]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (nr_packages < 1 || nr_users < 1) {
+        fprintf(stderr, "need at least one package and one user\n");
+        return 1;
+    }
+
+    for (i = 0; i < CERT_SIZE; i++)
+        manager_cert[i] = i * 7;
+    SHA256(manager_cert, CERT_SIZE, digest);
+    bin2hex(manager_hash, digest, sizeof(digest));
+
+    if (!dir && !(dir = mkdtemp(root))) {
+        perror(root);
+        return 1;
+    }
+    make_dir(dir);
+    if (chdir(dir)) {
+        perror(dir);
+        return 1;
+    }
+
+    srand(nr_packages);
+    // the manager is the last package of packages.list
+    make_fixture(nr_packages - 1);
+    expected = package_uid(nr_packages - 1);
+    printf("fixture: %s, %d packages, %d users\n", dir, nr_packages, nr_users);
+
+    for (i = 0; i < runs; i++) {
+        ksu_invalidate_manager_uid();
+        report("search", run(false));
+        failed |= ksu_get_manager_uid() != expected;
+        failed |= apk_opens > (unsigned long)nr_packages;
+    }
+    report("manager known", run(false));
+    report("prune only", run(true));
+    printf("prune: %lu of %lu allowlist entries kept\n", prune_kept,
+           prune_checked);
+
+    failed |= throne_stats.packages != (u32)nr_packages;
+    if (failed)
+        fprintf(stderr, "FAIL: manager uid %d, expected %d\n",
+                (int)ksu_get_manager_uid(), (int)expected);
+
+    if (!keep && !strcmp(dir, root)) {
+        char cmd[64];
+
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+        if (system(cmd))
+            fprintf(stderr, "failed to remove %s\n", root);
+    }
+    return failed;
+}
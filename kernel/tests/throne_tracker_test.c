@@ -0,0 +1,61 @@
+/*
+ * KUnit suite for the parsing in throne_tracker.c, which includes this
+ * file when CONFIG_KSU_KUNIT_TEST is set.
+ */
+#include <kunit/test.h>
+
+static void test_pkg_from_apk_path(struct kunit *test)
+{
+    char pkg[KSU_MAX_PACKAGE_NAME];
+
+    KUNIT_EXPECT_EQ(test,
+                    get_pkg_from_apk_path(
+                        pkg, "/data/app/~~Ab1_Cd==/me.weishu.kernelsu-"
+                             "Xy2_Zw==/base.apk"),
+                    0);
+    KUNIT_EXPECT_STREQ(test, pkg, "me.weishu.kernelsu");
+
+    // layout before Android 11
+    KUNIT_EXPECT_EQ(test,
+                    get_pkg_from_apk_path(pkg, "/data/app/com.example-1/base.apk"),
+                    0);
+    KUNIT_EXPECT_STREQ(test, pkg, "com.example");
+}
+
+static void test_pkg_from_apk_path_invalid(struct kunit *test)
+{
+    char pkg[KSU_MAX_PACKAGE_NAME];
+    char *long_path;
+
+    KUNIT_EXPECT_LT(test, get_pkg_from_apk_path(pkg, ""), 0);
+    KUNIT_EXPECT_LT(test, get_pkg_from_apk_path(pkg, "base.apk"), 0);
+    KUNIT_EXPECT_LT(test, get_pkg_from_apk_path(pkg, "/base.apk"), 0);
+    KUNIT_EXPECT_LT(test,
+                    get_pkg_from_apk_path(pkg, "/data/app/example/base.apk"),
+                    0);
+    // the hyphen must be in the directory, not in the file name
+    KUNIT_EXPECT_LT(test,
+                    get_pkg_from_apk_path(pkg, "/data/app/example/base-1.apk"),
+                    0);
+    KUNIT_EXPECT_LT(test,
+                    get_pkg_from_apk_path(pkg, "/data/app/-1/base.apk"), 0);
+
+    long_path = kunit_kzalloc(test, KSU_MAX_PACKAGE_NAME + 1, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, long_path);
+    memset(long_path, 'a', KSU_MAX_PACKAGE_NAME);
+    memcpy(long_path, "/data/app/a-1/", strlen("/data/app/a-1/"));
+    KUNIT_EXPECT_LT(test, get_pkg_from_apk_path(pkg, long_path), 0);
+}
+
+static struct kunit_case throne_tracker_test_cases[] = {
+    KUNIT_CASE(test_pkg_from_apk_path),
+    KUNIT_CASE(test_pkg_from_apk_path_invalid),
+    {}
+};
+
+static struct kunit_suite throne_tracker_test_suite = {
+    .name = "ksu_throne_tracker",
+    .test_cases = throne_tracker_test_cases,
+};
+
+kunit_test_suite(throne_tracker_test_suite);
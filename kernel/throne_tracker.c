@@ -1,5 +1,6 @@
 #include <linux/err.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/string.h>
@@ -7,13 +8,30 @@
 #include <linux/version.h>
 
 #include "allowlist.h"
+#include "event_queue.h"
 #include "klog.h" // IWYU pragma: keep
 #include "manager.h"
 #include "throne_tracker.h"
 
 uid_t ksu_manager_uid = KSU_INVALID_UID;
 
+// overridden by the host build in tests/throne_tracker
+#ifndef SYSTEM_PACKAGES_LIST_PATH
 #define SYSTEM_PACKAGES_LIST_PATH "/data/system/packages.list"
+#endif
+#ifndef DATA_APP_PATH
+#define DATA_APP_PATH "/data/app"
+#endif
+
+// Work done by the last track_throne run, logged when it finishes so
+// manager-detection cost on large installs shows up in dmesg.
+static struct {
+    u32 packages; // lines parsed from packages.list
+    u32 reads; // kernel_read calls on packages.list
+    u32 dirs; // directories opened under /data/app
+    u32 apks; // base.apk signature checks
+    u32 allocs;
+} throne_stats;
 
 struct uid_data {
     struct list_head list;
@@ -85,6 +103,7 @@ static void crown_manager(const char *apk, struct list_head *uid_data)
         if (strncmp(np->package, pkg, KSU_MAX_PACKAGE_NAME) == 0) {
             pr_info("Crowning manager: %s(uid=%d)\n", pkg, np->uid);
             ksu_set_manager_uid(np->uid);
+            ksu_event_emit(KSU_EVENT_MANAGER_CHANGED, np->uid);
             break;
         }
     }
@@ -166,6 +185,7 @@ FILLDIR_RETURN_TYPE my_actor(struct dir_context *ctx, const char *name,
             pr_err("Failed to allocate memory for %s\n", dirpath);
             return FILLDIR_ACTOR_CONTINUE;
         }
+        throne_stats.allocs++;
 
         strscpy(data->dirpath, dirpath, DATA_PATH_LEN);
         data->depth = my_ctx->depth - 1;
@@ -182,6 +202,7 @@ FILLDIR_RETURN_TYPE my_actor(struct dir_context *ctx, const char *name,
             }
 
             bool is_manager = is_manager_apk(dirpath);
+            throne_stats.apks++;
             pr_info("Found new base.apk at path: %s, is_manager: %d\n", dirpath,
                     is_manager);
             if (is_manager) {
@@ -196,6 +217,9 @@ FILLDIR_RETURN_TYPE my_actor(struct dir_context *ctx, const char *name,
             } else {
                 struct apk_path_hash *apk_data =
                     kzalloc(sizeof(struct apk_path_hash), GFP_ATOMIC);
+                if (!apk_data)
+                    return FILLDIR_ACTOR_CONTINUE;
+                throne_stats.allocs++;
                 apk_data->hash = hash;
                 apk_data->exists = true;
                 list_add_tail(&apk_data->list, &apk_path_hash_list);
@@ -239,6 +263,7 @@ void search_manager(const char *path, int depth, struct list_head *uid_data)
 
             if (!stop) {
                 file = filp_open(pos->dirpath, O_RDONLY | O_NOFOLLOW, 0);
+                throne_stats.dirs++;
                 if (IS_ERR(file)) {
                     pr_err("Failed to open directory: %s, err: %ld\n",
                            pos->dirpath, PTR_ERR(file));
@@ -302,6 +327,10 @@ static bool is_uid_exist(uid_t uid, char *package, void *data)
 
 void track_throne(bool prune_only)
 {
+    ktime_t start = ktime_get();
+
+    memset(&throne_stats, 0, sizeof(throne_stats));
+
     struct file *fp = filp_open(SYSTEM_PACKAGES_LIST_PATH, O_RDONLY, 0);
     if (IS_ERR(fp)) {
         pr_err("%s: open " SYSTEM_PACKAGES_LIST_PATH " failed: %ld\n", __func__,
@@ -318,18 +347,21 @@ void track_throne(bool prune_only)
     char buf[KSU_MAX_PACKAGE_NAME];
     for (;;) {
         ssize_t count = kernel_read(fp, &chr, sizeof(chr), &pos);
+        throne_stats.reads++;
         if (count != sizeof(chr))
             break;
         if (chr != '\n')
             continue;
 
         count = kernel_read(fp, buf, sizeof(buf), &line_start);
+        throne_stats.reads++;
 
         struct uid_data *data = kzalloc(sizeof(struct uid_data), GFP_ATOMIC);
         if (!data) {
             filp_close(fp, 0);
             goto out;
         }
+        throne_stats.allocs++;
 
         char *tmp = buf;
         const char *delim = " ";
@@ -348,6 +380,7 @@ void track_throne(bool prune_only)
         data->uid = res;
         strncpy(data->package, package, KSU_MAX_PACKAGE_NAME);
         list_add_tail(&data->list, &uid_list);
+        throne_stats.packages++;
         // reset line start
         line_start = pos;
     }
@@ -376,10 +409,11 @@ void track_throne(bool prune_only)
         if (ksu_is_manager_uid_valid()) {
             pr_info("manager is uninstalled, invalidate it!\n");
             ksu_invalidate_manager_uid();
+            ksu_event_emit(KSU_EVENT_MANAGER_CHANGED, KSU_INVALID_UID);
             goto prune;
         }
         pr_info("Searching manager...\n");
-        search_manager("/data/app", 2, &uid_list);
+        search_manager(DATA_APP_PATH, 2, &uid_list);
         pr_info("Search manager finished\n");
     }
 
@@ -392,6 +426,12 @@ out:
         list_del(&np->list);
         kfree(np);
     }
+
+    pr_info("track_throne: %u packages, %u reads, %u dirs, %u apks, %u allocs "
+            "in %lld us\n",
+            throne_stats.packages, throne_stats.reads, throne_stats.dirs,
+            throne_stats.apks, throne_stats.allocs,
+            ktime_us_delta(ktime_get(), start));
 }
 
 void ksu_throne_tracker_init()
@@ -403,3 +443,7 @@ void ksu_throne_tracker_exit()
 {
     // nothing to do
 }
+
+#ifdef CONFIG_KSU_KUNIT_TEST
+#include "tests/throne_tracker_test.c"
+#endif
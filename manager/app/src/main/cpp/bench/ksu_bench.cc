@@ -0,0 +1,99 @@
+//
+// Latency benchmark for the manager's native control path (ksu.cc).
+//
+// On a host build the calls are served by mock_driver.cc, which measures the
+// userspace side: struct marshalling and command dispatch, with no syscall.
+// Usage: ksu_bench [iterations] [profiles]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "../ksu.h"
+#include "mock_driver.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static void run(const char *name, int iterations, const std::function<void(int)> &op) {
+    std::vector<uint64_t> samples(iterations);
+
+    // warm up caches and the fd lookup before timing anything
+    for (int i = 0; i < std::min(iterations, 100); i++) {
+        op(i);
+    }
+
+    auto begin = bench_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        auto start = bench_clock::now();
+        op(i);
+        samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                bench_clock::now() - start).count();
+    }
+    auto total = std::chrono::duration<double>(bench_clock::now() - begin).count();
+
+    std::sort(samples.begin(), samples.end());
+    printf("%-24s %12.0f ops/s  p50 %8llu ns  p99 %8llu ns\n", name, iterations / total,
+           (unsigned long long) samples[iterations / 2],
+           (unsigned long long) samples[iterations * 99 / 100]);
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    int profiles = argc > 2 ? atoi(argv[2]) : 500;
+    if (iterations <= 0 || profiles <= 0) {
+        fprintf(stderr, "usage: %s [iterations] [profiles]\n", argv[0]);
+        return 1;
+    }
+
+    if (ksu_mock_driver_fd() < 0) {
+        perror("memfd_create");
+        return 1;
+    }
+
+    ksu_mock_reset(profiles);
+    printf("%d iterations, %d profiles\n", iterations, profiles);
+
+    run("get_version", iterations, [](int) { get_version(); });
+    run("get_allow_list", iterations, [](int) {
+        ksu_get_allow_list_cmd cmd = {};
+        get_allow_list(&cmd);
+    });
+    run("uid_should_umount", iterations, [&](int i) { uid_should_umount(10000 + i % profiles); });
+    run("get_app_profile", iterations, [&](int i) {
+        auto profile = ksu_mock_make_profile(i % profiles, false);
+        get_app_profile(&profile);
+    });
+    run("get_app_profile (miss)", iterations, [&](int i) {
+        auto profile = ksu_mock_make_profile(profiles + i, false);
+        get_app_profile(&profile);
+    });
+    run("set_app_profile", iterations, [&](int i) {
+        auto profile = ksu_mock_make_profile(i % profiles, i % 10 == 0);
+        set_app_profile(&profile);
+    });
+    run("is_su_enabled", iterations, [](int) { is_su_enabled(); });
+    run("set_kernel_umount", iterations, [](int i) { set_kernel_umount_enabled(i & 1); });
+
+    // the whole app list, as the SuperUser screen loads it
+    std::vector<app_profile> list(profiles);
+    std::vector<int> results(profiles);
+    int list_iterations = std::max(iterations / profiles, 10);
+    run("app list (per call)", list_iterations, [&](int) {
+        for (int i = 0; i < profiles; i++) {
+            list[i] = ksu_mock_make_profile(i, false);
+            results[i] = get_app_profile(&list[i]);
+        }
+    });
+    run("app list (batched)", list_iterations, [&](int) {
+        for (int i = 0; i < profiles; i++) {
+            list[i] = ksu_mock_make_profile(i, false);
+        }
+        get_app_profiles(list.data(), results.data(), list.size());
+    });
+
+    return 0;
+}
@@ -0,0 +1,365 @@
+//
+// Userspace stand-in for the [ksu_driver] fd, for host runs of the native
+// control path and ksud. A memfd named "[ksu_driver]" makes scan_driver_fd()
+// pick it up, and ioctl() on that fd is served from in-memory state following
+// the supercalls.h ABI. Every other fd goes to the real ioctl.
+//
+// State is per process, a fresh process starts from the fixture again.
+//
+
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../ksu.h"
+#include "mock_driver.h"
+
+#define KSU_MOCK_VERSION 32000
+#define KSU_MOCK_FEATURE_MAX 3
+
+// Commands ksud issues that the manager header does not carry, mirrored
+// from kernel/supercalls.h.
+struct ksu_manage_mark_cmd {
+    uint32_t operation;
+    int32_t pid;
+    uint32_t result;
+};
+
+struct ksu_nuke_ext4_sysfs_cmd {
+    uint64_t arg;
+};
+
+struct ksu_add_try_umount_cmd {
+    uint64_t arg;
+    uint32_t flags;
+    uint8_t mode;
+};
+
+#define KSU_UMOUNT_WIPE 0
+#define KSU_UMOUNT_ADD 1
+#define KSU_UMOUNT_DEL 2
+
+#define KSU_IOCTL_MANAGE_MARK _IOC(_IOC_READ|_IOC_WRITE, 'K', 16, 0)
+#define KSU_IOCTL_NUKE_EXT4_SYSFS _IOC(_IOC_WRITE, 'K', 17, 0)
+#define KSU_IOCTL_ADD_TRY_UMOUNT _IOC(_IOC_WRITE, 'K', 18, 0)
+
+static int g_driver_fd = -1;
+static std::mutex g_lock;
+static std::unordered_map<std::string, app_profile> g_profiles;
+static uint64_t g_features[KSU_MOCK_FEATURE_MAX] = {1, 1, 0};
+static bool g_default_umount = true;
+static std::map<std::string, uint32_t> g_umount_list;
+static std::unordered_map<std::string, root_profile> g_root_templates;
+static ksu_mock_stats g_stats;
+
+typedef int (*mock_handler_t)(void *arg);
+
+static int mock_get_info(void *arg) {
+    auto cmd = static_cast<ksu_get_info_cmd *>(arg);
+    cmd->version = KSU_MOCK_VERSION;
+    cmd->flags = 0x2; // manager
+    cmd->features = KSU_MOCK_FEATURE_MAX;
+    return 0;
+}
+
+static int mock_check_safemode(void *arg) {
+    static_cast<ksu_check_safemode_cmd *>(arg)->in_safe_mode = 0;
+    return 0;
+}
+
+static int fill_list(void *arg, bool allow) {
+    auto cmd = static_cast<ksu_get_allow_list_cmd *>(arg);
+    uint32_t count = 0;
+    for (auto &[key, profile] : g_profiles) {
+        if (profile.allow_su != allow || count >= 128) {
+            continue;
+        }
+        cmd->uids[count++] = profile.current_uid;
+    }
+    cmd->count = count;
+    return 0;
+}
+
+static int mock_get_allow_list(void *arg) {
+    return fill_list(arg, true);
+}
+
+static int mock_get_deny_list(void *arg) {
+    return fill_list(arg, false);
+}
+
+static const app_profile *find_uid(uint32_t uid) {
+    for (auto &[key, profile] : g_profiles) {
+        if ((uint32_t) profile.current_uid == uid) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+static int mock_uid_granted_root(void *arg) {
+    auto cmd = static_cast<ksu_uid_granted_root_cmd *>(arg);
+    auto profile = find_uid(cmd->uid);
+    cmd->granted = cmd->uid == 0 || (profile && profile->allow_su);
+    return 0;
+}
+
+static int mock_uid_should_umount(void *arg) {
+    auto cmd = static_cast<ksu_uid_should_umount_cmd *>(arg);
+    auto profile = find_uid(cmd->uid);
+    if (!profile || profile->allow_su) {
+        cmd->should_umount = !profile && g_default_umount;
+    } else if (profile->nrp_config.use_default) {
+        cmd->should_umount = g_default_umount;
+    } else {
+        cmd->should_umount = profile->nrp_config.profile.umount_modules;
+    }
+    return 0;
+}
+
+static int mock_get_manager_uid(void *arg) {
+    static_cast<ksu_get_manager_uid_cmd *>(arg)->uid = getuid();
+    return 0;
+}
+
+static int mock_get_app_profile(void *arg) {
+    auto cmd = static_cast<ksu_get_app_profile_cmd *>(arg);
+    auto it = g_profiles.find(cmd->profile.key);
+    if (it == g_profiles.end() || it->second.current_uid != cmd->profile.current_uid) {
+        return -ENOENT;
+    }
+    cmd->profile = it->second;
+    return 0;
+}
+
+static int mock_set_app_profile(void *arg) {
+    auto cmd = static_cast<ksu_set_app_profile_cmd *>(arg);
+    if (cmd->profile.version != KSU_APP_PROFILE_VER) {
+        return -EINVAL;
+    }
+    // "$" is the default non-root profile, see Natives.setDefaultUmountModules
+    if (strcmp(cmd->profile.key, "$") == 0) {
+        g_default_umount = cmd->profile.nrp_config.profile.umount_modules;
+        return 0;
+    }
+    g_profiles[cmd->profile.key] = cmd->profile;
+    return 0;
+}
+
+static int mock_set_root_template(void *arg) {
+    auto cmd = static_cast<ksu_set_root_template_cmd *>(arg);
+    cmd->name[sizeof(cmd->name) - 1] = '\0';
+    if (cmd->remove) {
+        return g_root_templates.erase(cmd->name) ? 0 : -ENOENT;
+    }
+    if (!cmd->name[0] || cmd->profile.groups_count > KSU_MAX_GROUPS) {
+        return -EINVAL;
+    }
+    g_root_templates[cmd->name] = cmd->profile;
+    return 0;
+}
+
+static int mock_get_feature(void *arg) {
+    auto cmd = static_cast<ksu_get_feature_cmd *>(arg);
+    cmd->supported = cmd->feature_id < KSU_MOCK_FEATURE_MAX;
+    cmd->value = cmd->supported ? g_features[cmd->feature_id] : 0;
+    return 0;
+}
+
+static int mock_set_feature(void *arg) {
+    auto cmd = static_cast<ksu_set_feature_cmd *>(arg);
+    if (cmd->feature_id >= KSU_MOCK_FEATURE_MAX) {
+        return -EINVAL;
+    }
+    g_features[cmd->feature_id] = cmd->value;
+    return 0;
+}
+
+static int mock_report_event(void *arg) {
+    auto cmd = static_cast<ksu_report_event_cmd *>(arg);
+    if (cmd->event == 0) {
+        return -EINVAL;
+    }
+    g_stats.events++;
+    return 0;
+}
+
+// rules are only counted, there is no policy db to apply them to
+static int mock_set_sepolicy(void *arg) {
+    auto cmd = static_cast<ksu_set_sepolicy_cmd *>(arg);
+    if (!cmd->arg) {
+        return -EINVAL;
+    }
+    g_stats.sepolicy_rules++;
+    return 0;
+}
+
+static int mock_manage_mark(void *arg) {
+    auto cmd = static_cast<ksu_manage_mark_cmd *>(arg);
+    cmd->result = 0;
+    return 0;
+}
+
+static int mock_nuke_ext4_sysfs(void *) {
+    return 0;
+}
+
+static int mock_add_try_umount(void *arg) {
+    auto cmd = static_cast<ksu_add_try_umount_cmd *>(arg);
+    switch (cmd->mode) {
+    case KSU_UMOUNT_WIPE:
+        g_umount_list.clear();
+        return 0;
+    case KSU_UMOUNT_ADD:
+        g_umount_list[reinterpret_cast<const char *>(cmd->arg)] = cmd->flags;
+        return 0;
+    case KSU_UMOUNT_DEL:
+        g_umount_list.erase(reinterpret_cast<const char *>(cmd->arg));
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+static int mock_batch(void *arg);
+
+static const struct {
+    unsigned long cmd;
+    mock_handler_t handler;
+} mock_handlers[] = {
+    {KSU_IOCTL_GET_INFO, mock_get_info},
+    {KSU_IOCTL_REPORT_EVENT, mock_report_event},
+    {KSU_IOCTL_SET_SEPOLICY, mock_set_sepolicy},
+    {KSU_IOCTL_CHECK_SAFEMODE, mock_check_safemode},
+    {KSU_IOCTL_GET_ALLOW_LIST, mock_get_allow_list},
+    {KSU_IOCTL_GET_DENY_LIST, mock_get_deny_list},
+    {KSU_IOCTL_UID_GRANTED_ROOT, mock_uid_granted_root},
+    {KSU_IOCTL_UID_SHOULD_UMOUNT, mock_uid_should_umount},
+    {KSU_IOCTL_GET_MANAGER_UID, mock_get_manager_uid},
+    {KSU_IOCTL_GET_APP_PROFILE, mock_get_app_profile},
+    {KSU_IOCTL_SET_APP_PROFILE, mock_set_app_profile},
+    {KSU_IOCTL_GET_FEATURE, mock_get_feature},
+    {KSU_IOCTL_SET_FEATURE, mock_set_feature},
+    {KSU_IOCTL_MANAGE_MARK, mock_manage_mark},
+    {KSU_IOCTL_NUKE_EXT4_SYSFS, mock_nuke_ext4_sysfs},
+    {KSU_IOCTL_ADD_TRY_UMOUNT, mock_add_try_umount},
+    {KSU_IOCTL_SET_ROOT_TEMPLATE, mock_set_root_template},
+    {KSU_IOCTL_BATCH, mock_batch},
+};
+
+static mock_handler_t find_handler(unsigned long cmd) {
+    for (auto &entry : mock_handlers) {
+        if (entry.cmd == cmd) {
+            return entry.handler;
+        }
+    }
+    return nullptr;
+}
+
+static int mock_batch(void *arg) {
+    auto cmd = static_cast<ksu_batch_cmd *>(arg);
+    if (cmd->count > KSU_BATCH_MAX) {
+        return -E2BIG;
+    }
+    auto entries = reinterpret_cast<ksu_batch_entry *>(cmd->entries);
+    uint32_t i;
+    g_stats.batches++;
+    for (i = 0; i < cmd->count; i++) {
+        auto handler = find_handler(entries[i].cmd);
+        if (!handler || entries[i].cmd == KSU_IOCTL_BATCH) {
+            entries[i].result = -ENOTTY;
+        } else {
+            entries[i].result = handler(reinterpret_cast<void *>(entries[i].arg));
+        }
+    }
+    cmd->completed = i;
+    return 0;
+}
+
+int ksu_mock_driver_fd() {
+    std::lock_guard<std::mutex> lock(g_lock);
+    if (g_driver_fd < 0) {
+        g_driver_fd = memfd_create("[ksu_driver]", MFD_CLOEXEC);
+    }
+    return g_driver_fd;
+}
+
+app_profile ksu_mock_make_profile(int index, bool allow_su) {
+    app_profile profile = {};
+    profile.version = KSU_APP_PROFILE_VER;
+    snprintf(profile.key, sizeof(profile.key), "com.example.app%d", index);
+    profile.current_uid = 10000 + index;
+    profile.allow_su = allow_su;
+    if (allow_su) {
+        profile.rp_config.use_default = true;
+        strcpy(profile.rp_config.profile.selinux_domain, "u:r:su:s0");
+    } else {
+        profile.nrp_config.use_default = true;
+        profile.nrp_config.profile.umount_modules = true;
+    }
+    return profile;
+}
+
+void ksu_mock_reset(int profiles) {
+    std::lock_guard<std::mutex> lock(g_lock);
+    g_profiles.clear();
+    g_root_templates.clear();
+    for (int i = 0; i < profiles; i++) {
+        auto profile = ksu_mock_make_profile(i, i % 10 == 0);
+        g_profiles[profile.key] = profile;
+    }
+    g_features[KSU_FEATURE_SU_COMPAT] = 1;
+    g_features[KSU_FEATURE_KERNEL_UMOUNT] = 1;
+    g_features[KSU_FEATURE_ENHANCED_SECURITY] = 0;
+    g_default_umount = true;
+    g_umount_list.clear();
+    g_stats = {};
+}
+
+ksu_mock_stats ksu_mock_get_stats() {
+    std::lock_guard<std::mutex> lock(g_lock);
+    auto stats = g_stats;
+    stats.profiles = g_profiles.size();
+    stats.umount_entries = g_umount_list.size();
+    return stats;
+}
+
+int ksu_mock_ioctl(unsigned long request, void *arg) {
+    std::lock_guard<std::mutex> lock(g_lock);
+    g_stats.ioctls++;
+    auto handler = find_handler(request);
+    if (!handler) {
+        g_stats.unknown++;
+        return -ENOTTY;
+    }
+    return handler(arg);
+}
+
+extern "C" int ioctl(int fd, unsigned long request, ...) {
+    va_list ap;
+    va_start(ap, request);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd < 0 || fd != g_driver_fd) {
+        static auto real_ioctl =
+                reinterpret_cast<int (*)(int, unsigned long, ...)>(dlsym(RTLD_NEXT, "ioctl"));
+        return real_ioctl(fd, request, arg);
+    }
+
+    int ret = ksu_mock_ioctl(request, arg);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
@@ -0,0 +1,38 @@
+//
+// Userspace stand-in for the [ksu_driver] fd, see mock_driver.cc.
+//
+
+#ifndef KERNELSU_MOCK_DRIVER_H
+#define KERNELSU_MOCK_DRIVER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../ksu.h"
+
+struct ksu_mock_stats {
+    uint64_t ioctls; // every request on the driver fd, batches count once
+    uint64_t unknown; // requests answered with ENOTTY
+    uint64_t batches;
+    uint64_t events;
+    uint64_t sepolicy_rules;
+    size_t profiles;
+    size_t umount_entries;
+};
+
+// Create the fake driver fd; ksu.cc and ksud find it by scanning /proc/self/fd.
+int ksu_mock_driver_fd();
+
+// Synthetic profile com.example.app<index> for uid 10000 + index.
+app_profile ksu_mock_make_profile(int index, bool allow_su);
+
+// Restore the default feature values and replace all profiles with the
+// first `profiles` synthetic ones, every tenth of them allowed su.
+void ksu_mock_reset(int profiles);
+
+ksu_mock_stats ksu_mock_get_stats();
+
+// Serve one ioctl request, returns 0 or a negative errno like the kernel.
+int ksu_mock_ioctl(unsigned long request, void *arg);
+
+#endif //KERNELSU_MOCK_DRIVER_H
@@ -0,0 +1,36 @@
+//
+// LD_PRELOAD entry for mock_driver.cc, so unmodified binaries (ksud, tools
+// linking ksu.cc) talk to the userspace driver:
+//
+//   KSU_MOCK_PROFILES=500 KSU_MOCK_STATS=1 LD_PRELOAD=libksu_mock_driver.so ksud ...
+//
+// KSU_MOCK_PROFILES seeds that many synthetic profiles (default 0) and
+// KSU_MOCK_STATS=1 prints the request counters to stderr at exit.
+//
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include "mock_driver.h"
+
+__attribute__((constructor)) static void mock_preload_init() {
+    const char *profiles = getenv("KSU_MOCK_PROFILES");
+    ksu_mock_reset(profiles ? atoi(profiles) : 0);
+    if (ksu_mock_driver_fd() < 0) {
+        perror("ksu_mock: memfd_create");
+    }
+}
+
+__attribute__((destructor)) static void mock_preload_exit() {
+    const char *verbose = getenv("KSU_MOCK_STATS");
+    if (!verbose || verbose[0] != '1') {
+        return;
+    }
+    auto stats = ksu_mock_get_stats();
+    fprintf(stderr,
+            "ksu_mock: %" PRIu64 " ioctls (%" PRIu64 " unknown), %" PRIu64 " batches, "
+            "%" PRIu64 " events, %" PRIu64 " sepolicy rules, %zu profiles, %zu umount entries\n",
+            stats.ioctls, stats.unknown, stats.batches, stats.events, stats.sepolicy_rules,
+            stats.profiles, stats.umount_entries);
+}
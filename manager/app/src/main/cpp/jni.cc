@@ -5,7 +5,12 @@
 #include <pwd.h>
 
 #include <android/log.h>
+#include <algorithm>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "ksu.h"
 
@@ -58,63 +63,82 @@ Java_me_weishu_kernelsu_Natives_isManager(JNIEnv *env, jclass clazz) {
     return is_manager();
 }
 
-static void fillIntArray(JNIEnv *env, jobject list, int *data, int count) {
-    auto cls = env->GetObjectClass(list);
-    auto add = env->GetMethodID(cls, "add", "(Ljava/lang/Object;)Z");
-    auto integerCls = env->FindClass("java/lang/Integer");
-    auto constructor = env->GetMethodID(integerCls, "<init>", "(I)V");
-    for (int i = 0; i < count; ++i) {
-        auto integer = env->NewObject(integerCls, constructor, data[i]);
-        env->CallBooleanMethod(list, add, integer);
+// Classes and member IDs used on hot paths, resolved once in JNI_OnLoad.
+static struct {
+    jclass natives;
+    jmethodID newRootProfile;
+    jmethodID newNonRootProfile;
+
+    jfieldID name;
+    jfieldID currentUid;
+    jfieldID allowSu;
+    jfieldID rootUseDefault;
+    jfieldID rootTemplate;
+    jfieldID uid;
+    jfieldID gid;
+    jfieldID context;
+    jfieldID namespaces;
+    jfieldID nonRootUseDefault;
+    jfieldID umountModules;
+    jmethodID groupsArray;
+    jmethodID capabilityBits;
+} gProfile;
+
+extern "C"
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM *vm, void *) {
+    JNIEnv *env;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
     }
-}
 
-static void addIntToList(JNIEnv *env, jobject list, int ele) {
-    auto cls = env->GetObjectClass(list);
-    auto add = env->GetMethodID(cls, "add", "(Ljava/lang/Object;)Z");
-    auto integerCls = env->FindClass("java/lang/Integer");
-    auto constructor = env->GetMethodID(integerCls, "<init>", "(I)V");
-    auto integer = env->NewObject(integerCls, constructor, ele);
-    env->CallBooleanMethod(list, add, integer);
+    auto natives = env->FindClass("me/weishu/kernelsu/Natives");
+    auto profile = env->FindClass("me/weishu/kernelsu/Natives$Profile");
+    if (!natives || !profile) {
+        return JNI_ERR;
+    }
+    gProfile.natives = reinterpret_cast<jclass>(env->NewGlobalRef(natives));
+
+    gProfile.newRootProfile = env->GetStaticMethodID(natives, "newRootProfile",
+            "(Ljava/lang/String;IZLjava/lang/String;II[IJLjava/lang/String;I)"
+            "Lme/weishu/kernelsu/Natives$Profile;");
+    gProfile.newNonRootProfile = env->GetStaticMethodID(natives, "newNonRootProfile",
+            "(Ljava/lang/String;IZZ)Lme/weishu/kernelsu/Natives$Profile;");
+
+    gProfile.name = env->GetFieldID(profile, "name", "Ljava/lang/String;");
+    gProfile.currentUid = env->GetFieldID(profile, "currentUid", "I");
+    gProfile.allowSu = env->GetFieldID(profile, "allowSu", "Z");
+    gProfile.rootUseDefault = env->GetFieldID(profile, "rootUseDefault", "Z");
+    gProfile.rootTemplate = env->GetFieldID(profile, "rootTemplate", "Ljava/lang/String;");
+    gProfile.uid = env->GetFieldID(profile, "uid", "I");
+    gProfile.gid = env->GetFieldID(profile, "gid", "I");
+    gProfile.context = env->GetFieldID(profile, "context", "Ljava/lang/String;");
+    gProfile.namespaces = env->GetFieldID(profile, "namespace", "I");
+    gProfile.nonRootUseDefault = env->GetFieldID(profile, "nonRootUseDefault", "Z");
+    gProfile.umountModules = env->GetFieldID(profile, "umountModules", "Z");
+    gProfile.groupsArray = env->GetMethodID(profile, "groupsArray", "()[I");
+    gProfile.capabilityBits = env->GetMethodID(profile, "capabilityBits", "()J");
+
+    env->DeleteLocalRef(natives);
+    env->DeleteLocalRef(profile);
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
 }
 
-static uint64_t capListToBits(JNIEnv *env, jobject list) {
-    auto cls = env->GetObjectClass(list);
-    auto get = env->GetMethodID(cls, "get", "(I)Ljava/lang/Object;");
-    auto size = env->GetMethodID(cls, "size", "()I");
-    auto listSize = env->CallIntMethod(list, size);
-    auto integerCls = env->FindClass("java/lang/Integer");
-    auto intValue = env->GetMethodID(integerCls, "intValue", "()I");
+static uint64_t validCapBits(jlong bits) {
     uint64_t result = 0;
-    for (int i = 0; i < listSize; ++i) {
-        auto integer = env->CallObjectMethod(list, get, i);
-        int data = env->CallIntMethod(integer, intValue);
-
-        if (cap_valid(data)) {
-            result |= (1ULL << data);
+    for (int i = 0; i <= CAP_LAST_CAP; i++) {
+        if ((static_cast<uint64_t>(bits) & (1ULL << i)) && cap_valid(i)) {
+            result |= 1ULL << i;
         }
     }
-
     return result;
 }
 
-static int getListSize(JNIEnv *env, jobject list) {
-    auto cls = env->GetObjectClass(list);
-    auto size = env->GetMethodID(cls, "size", "()I");
-    return env->CallIntMethod(list, size);
-}
-
-static void fillArrayWithList(JNIEnv *env, jobject list, int *data, int count) {
-    auto cls = env->GetObjectClass(list);
-    auto get = env->GetMethodID(cls, "get", "(I)Ljava/lang/Object;");
-    auto integerCls = env->FindClass("java/lang/Integer");
-    auto intValue = env->GetMethodID(integerCls, "intValue", "()I");
-    for (int i = 0; i < count; ++i) {
-        auto integer = env->CallObjectMethod(list, get, i);
-        data[i] = env->CallIntMethod(integer, intValue);
-    }
-}
-
 extern "C"
 JNIEXPORT jobject JNICALL
 Java_me_weishu_kernelsu_Natives_getAppProfile(JNIEnv *env, jobject, jstring pkg, jint uid) {
@@ -135,105 +159,158 @@ Java_me_weishu_kernelsu_Natives_getAppProfile(JNIEnv *env, jobject, jstring pkg,
 
     bool useDefaultProfile = get_app_profile(&profile) != 0;
 
-    auto cls = env->FindClass("me/weishu/kernelsu/Natives$Profile");
-    auto constructor = env->GetMethodID(cls, "<init>", "()V");
-    auto obj = env->NewObject(cls, constructor);
-    auto keyField = env->GetFieldID(cls, "name", "Ljava/lang/String;");
-    auto currentUidField = env->GetFieldID(cls, "currentUid", "I");
-    auto allowSuField = env->GetFieldID(cls, "allowSu", "Z");
-
-    auto rootUseDefaultField = env->GetFieldID(cls, "rootUseDefault", "Z");
-    auto rootTemplateField = env->GetFieldID(cls, "rootTemplate", "Ljava/lang/String;");
-
-    auto uidField = env->GetFieldID(cls, "uid", "I");
-    auto gidField = env->GetFieldID(cls, "gid", "I");
-    auto groupsField = env->GetFieldID(cls, "groups", "Ljava/util/List;");
-    auto capabilitiesField = env->GetFieldID(cls, "capabilities", "Ljava/util/List;");
-    auto domainField = env->GetFieldID(cls, "context", "Ljava/lang/String;");
-    auto namespacesField = env->GetFieldID(cls, "namespace", "I");
-
-    auto nonRootUseDefaultField = env->GetFieldID(cls, "nonRootUseDefault", "Z");
-    auto umountModulesField = env->GetFieldID(cls, "umountModules", "Z");
-
-    env->SetObjectField(obj, keyField, env->NewStringUTF(profile.key));
-    env->SetIntField(obj, currentUidField, profile.current_uid);
-
     if (useDefaultProfile) {
         // no profile found, so just use default profile:
         // don't allow root and use default profile!
         LOGD("use default profile for: %s, %d", key, uid);
 
-        // allow_su = false
-        // non root use default = true
-        env->SetBooleanField(obj, allowSuField, false);
-        env->SetBooleanField(obj, nonRootUseDefaultField, true);
-
-        return obj;
+        return env->CallStaticObjectMethod(gProfile.natives, gProfile.newNonRootProfile, pkg, uid,
+                JNI_TRUE, JNI_TRUE);
     }
 
-    auto allowSu = profile.allow_su;
+    auto name = env->NewStringUTF(profile.key);
 
-    if (allowSu) {
-        env->SetBooleanField(obj, rootUseDefaultField, (jboolean) profile.rp_config.use_default);
-        if (strlen(profile.rp_config.template_name) > 0) {
-            env->SetObjectField(obj, rootTemplateField,
-                    env->NewStringUTF(profile.rp_config.template_name));
-        }
+    if (!profile.allow_su) {
+        return env->CallStaticObjectMethod(gProfile.natives, gProfile.newNonRootProfile, name,
+                profile.current_uid, (jboolean) profile.nrp_config.use_default,
+                (jboolean) profile.nrp_config.profile.umount_modules);
+    }
 
-        env->SetIntField(obj, uidField, profile.rp_config.profile.uid);
-        env->SetIntField(obj, gidField, profile.rp_config.profile.gid);
+    auto &rp = profile.rp_config.profile;
+    jstring rootTemplate = nullptr;
+    if (strlen(profile.rp_config.template_name) > 0) {
+        rootTemplate = env->NewStringUTF(profile.rp_config.template_name);
+    }
 
-        jobject groupList = env->GetObjectField(obj, groupsField);
-        int groupCount = profile.rp_config.profile.groups_count;
-        if (groupCount > KSU_MAX_GROUPS) {
-            LOGD("kernel group count too large: %d???", groupCount);
-            groupCount = KSU_MAX_GROUPS;
-        }
-        fillIntArray(env, groupList, profile.rp_config.profile.groups, groupCount);
+    int groupCount = rp.groups_count;
+    if (groupCount > KSU_MAX_GROUPS) {
+        LOGD("kernel group count too large: %d???", groupCount);
+        groupCount = KSU_MAX_GROUPS;
+    }
+    if (groupCount < 0) {
+        groupCount = 0;
+    }
+    auto groups = env->NewIntArray(groupCount);
+    env->SetIntArrayRegion(groups, 0, groupCount, rp.groups);
 
-        jobject capList = env->GetObjectField(obj, capabilitiesField);
-        for (int i = 0; i <= CAP_LAST_CAP; i++) {
-            if (profile.rp_config.profile.capabilities.effective & (1ULL << i)) {
-                addIntToList(env, capList, i);
-            }
-        }
+    return env->CallStaticObjectMethod(gProfile.natives, gProfile.newRootProfile, name,
+            profile.current_uid, (jboolean) profile.rp_config.use_default, rootTemplate,
+            rp.uid, rp.gid, groups, (jlong) validCapBits((jlong) rp.capabilities.effective),
+            env->NewStringUTF(rp.selinux_domain), rp.namespaces);
+}
 
-        env->SetObjectField(obj, domainField,
-                env->NewStringUTF(profile.rp_config.profile.selinux_domain));
-        env->SetIntField(obj, namespacesField, profile.rp_config.profile.namespaces);
-        env->SetBooleanField(obj, allowSuField, profile.allow_su);
-    } else {
-        env->SetBooleanField(obj, nonRootUseDefaultField,
-                (jboolean) profile.nrp_config.use_default);
-        env->SetBooleanField(obj, umountModulesField, profile.nrp_config.profile.umount_modules);
+// Packed record written by fillAppProfiles, one per requested package. The
+// layout is mirrored by Natives.ProfileRecords, keep the two in sync.
+struct profile_record {
+    int32_t flags; // PROFILE_RECORD_*
+    int32_t current_uid;
+    int32_t uid;
+    int32_t gid;
+    int32_t namespaces;
+    int32_t groups_count;
+    int32_t groups[KSU_MAX_GROUPS];
+    uint64_t capabilities;
+    char template_name[KSU_MAX_PACKAGE_NAME];
+    char selinux_domain[KSU_SELINUX_DOMAIN];
+};
+
+static_assert(sizeof(profile_record) == 480, "profile_record layout changed");
+
+#define PROFILE_RECORD_FOUND (1 << 0)
+#define PROFILE_RECORD_ALLOW_SU (1 << 1)
+#define PROFILE_RECORD_USE_DEFAULT (1 << 2)
+#define PROFILE_RECORD_UMOUNT_MODULES (1 << 3)
+
+static void fillProfileRecord(profile_record *record, const app_profile &profile) {
+    record->flags = PROFILE_RECORD_FOUND;
+    record->current_uid = profile.current_uid;
+    if (!profile.allow_su) {
+        if (profile.nrp_config.use_default) record->flags |= PROFILE_RECORD_USE_DEFAULT;
+        if (profile.nrp_config.profile.umount_modules) record->flags |= PROFILE_RECORD_UMOUNT_MODULES;
+        return;
     }
 
-    return obj;
+    auto &rp = profile.rp_config.profile;
+    record->flags |= PROFILE_RECORD_ALLOW_SU;
+    if (profile.rp_config.use_default) record->flags |= PROFILE_RECORD_USE_DEFAULT;
+    record->uid = rp.uid;
+    record->gid = rp.gid;
+    record->namespaces = rp.namespaces;
+    record->groups_count = std::clamp(rp.groups_count, 0, KSU_MAX_GROUPS);
+    memcpy(record->groups, rp.groups, record->groups_count * sizeof(int32_t));
+    record->capabilities = validCapBits((jlong) rp.capabilities.effective);
+    strlcpy(record->template_name, profile.rp_config.template_name, sizeof(record->template_name));
+    strlcpy(record->selinux_domain, rp.selinux_domain, sizeof(record->selinux_domain));
 }
 
 extern "C"
 JNIEXPORT jboolean JNICALL
-Java_me_weishu_kernelsu_Natives_setAppProfile(JNIEnv *env, jobject clazz, jobject profile) {
-    auto cls = env->FindClass("me/weishu/kernelsu/Natives$Profile");
+Java_me_weishu_kernelsu_Natives_fillAppProfiles(JNIEnv *env, jobject, jobjectArray keys,
+                                                jintArray uids, jobject out) {
+    auto count = env->GetArrayLength(keys);
+    auto records = static_cast<profile_record *>(env->GetDirectBufferAddress(out));
+    if (!records || env->GetArrayLength(uids) != count ||
+        env->GetDirectBufferCapacity(out) < (jlong) (count * sizeof(profile_record))) {
+        return false;
+    }
+
+    std::vector<app_profile> profiles(count);
+    auto cuids = env->GetIntArrayElements(uids, nullptr);
+    for (jsize i = 0; i < count; i++) {
+        auto &profile = profiles[i];
+        profile.version = KSU_APP_PROFILE_VER;
+        profile.current_uid = cuids[i];
+
+        auto key = (jstring) env->GetObjectArrayElement(keys, i);
+        if (key && env->GetStringUTFLength(key) < KSU_MAX_PACKAGE_NAME) {
+            env->GetStringUTFRegion(key, 0, env->GetStringLength(key), profile.key);
+        }
+        env->DeleteLocalRef(key);
+    }
+    env->ReleaseIntArrayElements(uids, cuids, JNI_ABORT);
 
-    auto keyField = env->GetFieldID(cls, "name", "Ljava/lang/String;");
-    auto currentUidField = env->GetFieldID(cls, "currentUid", "I");
-    auto allowSuField = env->GetFieldID(cls, "allowSu", "Z");
+    std::vector<int> results(count);
+    get_app_profiles(profiles.data(), results.data(), count);
 
-    auto rootUseDefaultField = env->GetFieldID(cls, "rootUseDefault", "Z");
-    auto rootTemplateField = env->GetFieldID(cls, "rootTemplate", "Ljava/lang/String;");
+    memset(records, 0, count * sizeof(profile_record));
+    for (jsize i = 0; i < count; i++) {
+        // an empty key never matches, it keeps the default profile like a miss
+        if (results[i] == 0 && profiles[i].key[0] != '\0') {
+            fillProfileRecord(&records[i], profiles[i]);
+        }
+    }
+    return true;
+}
 
-    auto uidField = env->GetFieldID(cls, "uid", "I");
-    auto gidField = env->GetFieldID(cls, "gid", "I");
-    auto groupsField = env->GetFieldID(cls, "groups", "Ljava/util/List;");
-    auto capabilitiesField = env->GetFieldID(cls, "capabilities", "Ljava/util/List;");
-    auto domainField = env->GetFieldID(cls, "context", "Ljava/lang/String;");
-    auto namespacesField = env->GetFieldID(cls, "namespace", "I");
+static bool readRootProfile(JNIEnv *env, jobject profile, root_profile *out) {
+    out->uid = env->GetIntField(profile, gProfile.uid);
+    out->gid = env->GetIntField(profile, gProfile.gid);
 
-    auto nonRootUseDefaultField = env->GetFieldID(cls, "nonRootUseDefault", "Z");
-    auto umountModulesField = env->GetFieldID(cls, "umountModules", "Z");
+    auto groups = (jintArray) env->CallObjectMethod(profile, gProfile.groupsArray);
+    int groups_count = env->GetArrayLength(groups);
+    if (groups_count > KSU_MAX_GROUPS) {
+        LOGD("groups count too large: %d", groups_count);
+        return false;
+    }
+    out->groups_count = groups_count;
+    env->GetIntArrayRegion(groups, 0, groups_count, out->groups);
 
-    auto key = env->GetObjectField(profile, keyField);
+    auto capabilities = env->CallLongMethod(profile, gProfile.capabilityBits);
+    out->capabilities.effective = validCapBits(capabilities);
+
+    auto domain = env->GetObjectField(profile, gProfile.context);
+    auto cdomain = env->GetStringUTFChars((jstring) domain, nullptr);
+    strcpy(out->selinux_domain, cdomain);
+    env->ReleaseStringUTFChars((jstring) domain, cdomain);
+
+    out->namespaces = env->GetIntField(profile, gProfile.namespaces);
+    return true;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_me_weishu_kernelsu_Natives_setAppProfile(JNIEnv *env, jobject clazz, jobject profile) {
+    auto key = env->GetObjectField(profile, gProfile.name);
     if (!key) {
         return false;
     }
@@ -246,15 +323,8 @@ Java_me_weishu_kernelsu_Natives_setAppProfile(JNIEnv *env, jobject clazz, jobjec
     strcpy(p_key, cpkg);
     env->ReleaseStringUTFChars((jstring) key, cpkg);
 
-    auto currentUid = env->GetIntField(profile, currentUidField);
-
-    auto uid = env->GetIntField(profile, uidField);
-    auto gid = env->GetIntField(profile, gidField);
-    auto groups = env->GetObjectField(profile, groupsField);
-    auto capabilities = env->GetObjectField(profile, capabilitiesField);
-    auto domain = env->GetObjectField(profile, domainField);
-    auto allowSu = env->GetBooleanField(profile, allowSuField);
-    auto umountModules = env->GetBooleanField(profile, umountModulesField);
+    auto currentUid = env->GetIntField(profile, gProfile.currentUid);
+    auto allowSu = env->GetBooleanField(profile, gProfile.allowSu);
 
     app_profile p = {};
     p.version = KSU_APP_PROFILE_VER;
@@ -264,38 +334,54 @@ Java_me_weishu_kernelsu_Natives_setAppProfile(JNIEnv *env, jobject clazz, jobjec
     p.current_uid = currentUid;
 
     if (allowSu) {
-        p.rp_config.use_default = env->GetBooleanField(profile, rootUseDefaultField);
-        auto templateName = env->GetObjectField(profile, rootTemplateField);
+        p.rp_config.use_default = env->GetBooleanField(profile, gProfile.rootUseDefault);
+        auto templateName = env->GetObjectField(profile, gProfile.rootTemplate);
         if (templateName) {
             auto ctemplateName = env->GetStringUTFChars((jstring) templateName, nullptr);
             strcpy(p.rp_config.template_name, ctemplateName);
             env->ReleaseStringUTFChars((jstring) templateName, ctemplateName);
         }
 
-        p.rp_config.profile.uid = uid;
-        p.rp_config.profile.gid = gid;
-
-        int groups_count = getListSize(env, groups);
-        if (groups_count > KSU_MAX_GROUPS) {
-            LOGD("groups count too large: %d", groups_count);
+        if (!readRootProfile(env, profile, &p.rp_config.profile)) {
             return false;
         }
-        p.rp_config.profile.groups_count = groups_count;
-        fillArrayWithList(env, groups, p.rp_config.profile.groups, groups_count);
+    } else {
+        p.nrp_config.use_default = env->GetBooleanField(profile, gProfile.nonRootUseDefault);
+        p.nrp_config.profile.umount_modules = env->GetBooleanField(profile, gProfile.umountModules);
+    }
 
-        p.rp_config.profile.capabilities.effective = capListToBits(env, capabilities);
+    return set_app_profile(&p);
+}
 
-        auto cdomain = env->GetStringUTFChars((jstring) domain, nullptr);
-        strcpy(p.rp_config.profile.selinux_domain, cdomain);
-        env->ReleaseStringUTFChars((jstring) domain, cdomain);
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_me_weishu_kernelsu_Natives_setRootTemplate(JNIEnv *env, jobject clazz, jstring id, jobject profile) {
+    if (env->GetStringUTFLength(id) >= KSU_MAX_PACKAGE_NAME) {
+        return false;
+    }
 
-        p.rp_config.profile.namespaces = env->GetIntField(profile, namespacesField);
-    } else {
-        p.nrp_config.use_default = env->GetBooleanField(profile, nonRootUseDefaultField);
-        p.nrp_config.profile.umount_modules = umountModules;
+    root_profile p = {};
+    if (!readRootProfile(env, profile, &p)) {
+        return false;
     }
 
-    return set_app_profile(&p);
+    auto cid = env->GetStringUTFChars(id, nullptr);
+    auto result = set_root_template(cid, &p);
+    env->ReleaseStringUTFChars(id, cid);
+    return result;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_me_weishu_kernelsu_Natives_removeRootTemplate(JNIEnv *env, jobject clazz, jstring id) {
+    if (env->GetStringUTFLength(id) >= KSU_MAX_PACKAGE_NAME) {
+        return false;
+    }
+
+    auto cid = env->GetStringUTFChars(id, nullptr);
+    auto result = remove_root_template(cid);
+    env->ReleaseStringUTFChars(id, cid);
+    return result;
 }
 extern "C"
 JNIEXPORT jboolean JNICALL
@@ -337,12 +423,49 @@ Java_me_weishu_kernelsu_Natives_setEnhancedSecurityEnabled(JNIEnv *env, jobject
     return set_enhanced_security_enabled(enabled);
 }
 
+// getpwuid on bionic synthesizes names for app uids, looking up packages on
+// every call. Keep the answers until the package list changes; misses are
+// cached as an empty name.
+static std::mutex gUserNamesLock;
+static std::unordered_map<uid_t, std::string> gUserNames;
+
+static jstring lookupUserName(JNIEnv *env, uid_t uid) {
+    std::lock_guard<std::mutex> lock(gUserNamesLock);
+    auto it = gUserNames.find(uid);
+    if (it == gUserNames.end()) {
+        struct passwd *pw = getpwuid(uid);
+        it = gUserNames.emplace(uid, pw && pw->pw_name ? pw->pw_name : "").first;
+    }
+    if (it->second.empty()) {
+        return nullptr;
+    }
+    return env->NewStringUTF(it->second.c_str());
+}
+
 extern "C"
 JNIEXPORT jstring JNICALL
 Java_me_weishu_kernelsu_Natives_getUserName(JNIEnv *env, jobject thiz, jint uid) {
-    struct passwd *pw = getpwuid((uid_t) uid);
-    if (pw && pw->pw_name && pw->pw_name[0] != '\0') {
-        return env->NewStringUTF(pw->pw_name);
+    return lookupUserName(env, (uid_t) uid);
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_me_weishu_kernelsu_Natives_getUserNames(JNIEnv *env, jobject thiz, jintArray uids) {
+    auto count = env->GetArrayLength(uids);
+    auto names = env->NewObjectArray(count, env->FindClass("java/lang/String"), nullptr);
+    auto cuids = env->GetIntArrayElements(uids, nullptr);
+    for (jsize i = 0; i < count; i++) {
+        auto name = lookupUserName(env, (uid_t) cuids[i]);
+        env->SetObjectArrayElement(names, i, name);
+        env->DeleteLocalRef(name);
     }
-    return nullptr;
+    env->ReleaseIntArrayElements(uids, cuids, JNI_ABORT);
+    return names;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_me_weishu_kernelsu_Natives_clearUserNameCache(JNIEnv *env, jobject thiz) {
+    std::lock_guard<std::mutex> lock(gUserNamesLock);
+    gUserNames.clear();
 }
@@ -8,9 +8,11 @@
 #include <cstdio>
 #include <unistd.h>
 #include <utility>
-#include <android/log.h>
 #include <dirent.h>
 #include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <vector>
 
 #include <unistd.h>
 #include <climits>
@@ -134,6 +136,67 @@ int get_app_profile(app_profile *profile) {
     return ret;
 }
 
+bool set_root_template(const char *id, const root_profile *profile) {
+    struct ksu_set_root_template_cmd cmd = {};
+    strncpy(cmd.name, id, sizeof(cmd.name) - 1);
+    cmd.profile = *profile;
+    return ksuctl(KSU_IOCTL_SET_ROOT_TEMPLATE, &cmd) == 0;
+}
+
+bool remove_root_template(const char *id) {
+    struct ksu_set_root_template_cmd cmd = {};
+    strncpy(cmd.name, id, sizeof(cmd.name) - 1);
+    cmd.remove = 1;
+    return ksuctl(KSU_IOCTL_SET_ROOT_TEMPLATE, &cmd) == 0;
+}
+
+// cleared once the kernel rejects KSU_IOCTL_BATCH, older kernels lack it
+static bool g_batch_supported = true;
+
+void get_app_profiles(app_profile *profiles, int *results, size_t count) {
+    // a batch entry points straight at the profile, the cmd only wraps it
+    static_assert(sizeof(ksu_get_app_profile_cmd) == sizeof(app_profile));
+
+    size_t done = 0;
+    if (g_batch_supported && count > 1) {
+        std::vector<ksu_batch_entry> entries(std::min(count, (size_t) KSU_BATCH_MAX));
+        while (done < count) {
+            auto n = (uint32_t) std::min(count - done, entries.size());
+            for (uint32_t i = 0; i < n; i++) {
+                entries[i] = {
+                    .cmd = KSU_IOCTL_GET_APP_PROFILE,
+                    .result = 0,
+                    .arg = (uint64_t) (uintptr_t) &profiles[done + i],
+                };
+            }
+            ksu_batch_cmd cmd = {
+                .entries = (uint64_t) (uintptr_t) entries.data(),
+                .count = n,
+                .flags = 0,
+                .completed = 0,
+            };
+            if (ksuctl(KSU_IOCTL_BATCH, &cmd) != 0) {
+                if (errno == ENOTTY) {
+                    g_batch_supported = false;
+                }
+                break;
+            }
+            for (uint32_t i = 0; i < cmd.completed; i++) {
+                results[done + i] = entries[i].result;
+            }
+            done += cmd.completed;
+            if (cmd.completed < n) {
+                break;
+            }
+        }
+    }
+
+    // whatever the batch did not cover goes one ioctl at a time
+    for (; done < count; done++) {
+        results[done] = get_app_profile(&profiles[done]);
+    }
+}
+
 bool set_su_enabled(bool enabled) {
     struct ksu_set_feature_cmd cmd = {};
     cmd.feature_id = KSU_FEATURE_SU_COMPAT;
@@ -5,8 +5,10 @@
 #ifndef KERNELSU_KSU_H
 #define KERNELSU_KSU_H
 
+#include <cstddef>
 #include <cstdint>
 #include <sys/ioctl.h>
+#include <sys/prctl.h>
 #include <utility>
 
 uint32_t get_version();
@@ -79,6 +81,16 @@ bool set_app_profile(const app_profile *profile);
 
 int get_app_profile(app_profile *profile);
 
+// Register or replace the shared root profile that app profiles name in
+// rp_config.template_name, every app using it picks the change up at once.
+bool set_root_template(const char *id, const root_profile *profile);
+
+bool remove_root_template(const char *id);
+
+// Fetch many profiles in as few ioctls as possible, results[i] is the return
+// value of the GET_APP_PROFILE for profiles[i] (0 on success).
+void get_app_profiles(app_profile *profiles, int *results, size_t count);
+
 // Feature IDs
 enum ksu_feature_id {
     KSU_FEATURE_SU_COMPAT = 0,
@@ -153,6 +165,27 @@ struct ksu_set_app_profile_cmd {
     struct app_profile profile; // Input: app profile structure
 };
 
+struct ksu_set_root_template_cmd {
+    char name[KSU_MAX_PACKAGE_NAME]; // Input: template id, as in rp_config.template_name
+    uint32_t remove; // Input: 1 to remove the template, the profile is then ignored
+    struct root_profile profile; // Input: the shared root profile
+};
+
+struct ksu_batch_entry {
+    uint32_t cmd; // Input: KSU_IOCTL_* of the sub command
+    int32_t result; // Output: return value of the sub command
+    uint64_t arg; // Input: pointer to the sub command's struct
+};
+
+struct ksu_batch_cmd {
+    uint64_t entries; // Input: pointer to struct ksu_batch_entry array
+    uint32_t count; // Input: number of entries
+    uint32_t flags; // Input: KSU_BATCH_*
+    uint32_t completed; // Output: number of entries executed
+};
+
+#define KSU_BATCH_MAX 1024
+
 // Su compat
 bool set_su_enabled(bool enabled);
 
@@ -183,6 +216,8 @@ bool is_enhanced_security_enabled();
 #define KSU_IOCTL_SET_APP_PROFILE _IOC(_IOC_WRITE, 'K', 12, 0)
 #define KSU_IOCTL_GET_FEATURE _IOC(_IOC_READ|_IOC_WRITE, 'K', 13, 0)
 #define KSU_IOCTL_SET_FEATURE _IOC(_IOC_WRITE, 'K', 14, 0)
+#define KSU_IOCTL_BATCH _IOC(_IOC_READ|_IOC_WRITE, 'K', 19, 0)
+#define KSU_IOCTL_SET_ROOT_TEMPLATE _IOC(_IOC_WRITE, 'K', 21, 0)
 
 bool get_allow_list(struct ksu_get_allow_list_cmd *);
 
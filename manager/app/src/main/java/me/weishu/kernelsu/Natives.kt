@@ -4,6 +4,8 @@ import android.os.Parcelable
 import androidx.annotation.Keep
 import androidx.compose.runtime.Immutable
 import kotlinx.parcelize.Parcelize
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 
 /**
  * @author weishu
@@ -54,6 +56,33 @@ object Natives {
     external fun getAppProfile(key: String?, uid: Int): Profile
     external fun setAppProfile(profile: Profile?): Boolean
 
+    /**
+     * Register the root profile of a template in the kernel, profiles whose
+     * [Profile.rootTemplate] is [id] follow it. The kernel persists it and
+     * rewrites the copy kept in those profiles.
+     */
+    external fun setRootTemplate(id: String, profile: Profile): Boolean
+    external fun removeRootTemplate(id: String): Boolean
+
+    // fills one packed record per key into the direct buffer, see ProfileRecords
+    private external fun fillAppProfiles(keys: Array<String>, uids: IntArray, out: ByteBuffer): Boolean
+
+    /**
+     * Get the profiles of many packages at once, in a single kernel round trip
+     * when the kernel supports batching. Profiles are decoded on access.
+     */
+    fun getAppProfiles(keys: Array<String>, uids: IntArray): List<Profile> {
+        if (keys.isEmpty()) {
+            return emptyList()
+        }
+        val buffer = ByteBuffer.allocateDirect(keys.size * ProfileRecords.RECORD_SIZE)
+            .order(ByteOrder.nativeOrder())
+        if (!fillAppProfiles(keys, uids, buffer)) {
+            return keys.indices.map { getAppProfile(keys[it], uids[it]) }
+        }
+        return ProfileRecords(keys, uids, buffer)
+    }
+
     /**
      * `su` compat mode can be disabled temporarily.
      *  0: disabled
@@ -86,6 +115,16 @@ object Natives {
      */
     external fun getUserName(uid: Int): String?
 
+    /**
+     * Bulk version of [getUserName], null for uids without a name.
+     */
+    external fun getUserNames(uids: IntArray): Array<String?>
+
+    /**
+     * Drop the cached user names, they change along with the installed packages.
+     */
+    external fun clearUserNameCache()
+
     private const val NON_ROOT_DEFAULT_PROFILE_KEY = "$"
     private const val NOBODY_UID = 9999
 
@@ -110,6 +149,124 @@ object Natives {
         return version != -1 && version < MINIMAL_SUPPORTED_KERNEL
     }
 
+    // Factories for the JNI side, which passes primitives instead of boxed lists.
+    @Keep
+    @JvmStatic
+    @Suppress("unused")
+    private fun newRootProfile(
+        name: String,
+        currentUid: Int,
+        rootUseDefault: Boolean,
+        rootTemplate: String?,
+        uid: Int,
+        gid: Int,
+        groups: IntArray,
+        capabilities: Long,
+        context: String,
+        namespace: Int,
+    ) = Profile(
+        name,
+        currentUid,
+        allowSu = true,
+        rootUseDefault = rootUseDefault,
+        rootTemplate = rootTemplate,
+        uid = uid,
+        gid = gid,
+        groups = groups.asList(),
+        capabilities = (0 until Long.SIZE_BITS).filter { capabilities and (1L shl it) != 0L },
+        context = context,
+        namespace = namespace,
+    )
+
+    @Keep
+    @JvmStatic
+    @Suppress("unused")
+    private fun newNonRootProfile(
+        name: String,
+        currentUid: Int,
+        nonRootUseDefault: Boolean,
+        umountModules: Boolean,
+    ) = Profile(
+        name,
+        currentUid,
+        allowSu = false,
+        nonRootUseDefault = nonRootUseDefault,
+        umountModules = umountModules,
+    )
+
+    // Mirrors struct profile_record in jni.cc.
+    private class ProfileRecords(
+        private val keys: Array<String>,
+        private val uids: IntArray,
+        private val buffer: ByteBuffer,
+    ) : AbstractList<Profile>() {
+        override val size: Int
+            get() = keys.size
+
+        override fun get(index: Int): Profile {
+            val base = index * RECORD_SIZE
+            val flags = buffer.getInt(base + OFF_FLAGS)
+            if (flags and FLAG_FOUND == 0) {
+                // no profile found, same default as getAppProfile
+                return newNonRootProfile(keys[index], uids[index], true, true)
+            }
+
+            val currentUid = buffer.getInt(base + OFF_CURRENT_UID)
+            val useDefault = flags and FLAG_USE_DEFAULT != 0
+            if (flags and FLAG_ALLOW_SU == 0) {
+                return newNonRootProfile(
+                    keys[index], currentUid, useDefault, flags and FLAG_UMOUNT_MODULES != 0
+                )
+            }
+
+            val groupsCount = buffer.getInt(base + OFF_GROUPS_COUNT)
+            return newRootProfile(
+                name = keys[index],
+                currentUid = currentUid,
+                rootUseDefault = useDefault,
+                rootTemplate = readString(base + OFF_TEMPLATE, TEMPLATE_LEN).ifEmpty { null },
+                uid = buffer.getInt(base + OFF_UID),
+                gid = buffer.getInt(base + OFF_GID),
+                groups = IntArray(groupsCount) { buffer.getInt(base + OFF_GROUPS + it * 4) },
+                capabilities = buffer.getLong(base + OFF_CAPABILITIES),
+                context = readString(base + OFF_DOMAIN, DOMAIN_LEN),
+                namespace = buffer.getInt(base + OFF_NAMESPACES),
+            )
+        }
+
+        private fun readString(offset: Int, max: Int): String {
+            var len = 0
+            while (len < max && buffer.get(offset + len) != 0.toByte()) {
+                len++
+            }
+            val bytes = ByteArray(len) { buffer.get(offset + it) }
+            return String(bytes, Charsets.UTF_8)
+        }
+
+        companion object {
+            const val RECORD_SIZE = 480
+
+            const val OFF_FLAGS = 0
+            const val OFF_CURRENT_UID = 4
+            const val OFF_UID = 8
+            const val OFF_GID = 12
+            const val OFF_NAMESPACES = 16
+            const val OFF_GROUPS_COUNT = 20
+            const val OFF_GROUPS = 24
+            const val OFF_CAPABILITIES = 152
+            const val OFF_TEMPLATE = 160
+            const val OFF_DOMAIN = 416
+
+            const val TEMPLATE_LEN = 256
+            const val DOMAIN_LEN = 64
+
+            const val FLAG_FOUND = 1 shl 0
+            const val FLAG_ALLOW_SU = 1 shl 1
+            const val FLAG_USE_DEFAULT = 1 shl 2
+            const val FLAG_UMOUNT_MODULES = 1 shl 3
+        }
+    }
+
     @Immutable
     @Parcelize
     @Keep
@@ -144,5 +301,14 @@ object Natives {
         }
 
         constructor() : this("")
+
+        // primitive views of the lists, read by setAppProfile on the JNI side
+        @Keep
+        fun groupsArray(): IntArray = groups.toIntArray()
+
+        @Keep
+        fun capabilityBits(): Long = capabilities.fold(0L) { bits, cap ->
+            if (cap in 0 until Long.SIZE_BITS) bits or (1L shl cap) else bits
+        }
     }
 }
@@ -409,6 +409,7 @@ private fun AppProfileInner(
                             val selected = profile.rootTemplate ?: templates[0]
                             val info = getTemplateInfoById(selected)
                             if (info != null && setSepolicy(selected, info.rules.joinToString("\n"))) {
+                                Natives.setRootTemplate(selected, toNativeProfile(info))
                                 onProfileChange(
                                     profile.copy(
                                         rootUseDefault = false,
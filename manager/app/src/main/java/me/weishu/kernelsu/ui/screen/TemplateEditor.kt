@@ -115,6 +115,7 @@ fun TemplateEditorScreen(
                 onBack = dropUnlessResumed { navigator.navigateBack(result = !readOnly) },
                 onDelete = {
                     if (deleteAppProfileTemplate(template.id)) {
+                        Natives.removeRootTemplate(template.id)
                         navigator.navigateBack(result = true)
                     }
                 },
@@ -295,7 +296,12 @@ fun saveTemplate(template: TemplateViewModel.TemplateInfo, isCreation: Boolean =
 
     val json = template.toJSON()
     json.put("local", true)
-    return setAppProfileTemplate(template.id, json.toString())
+    if (!setAppProfileTemplate(template.id, json.toString())) {
+        return false
+    }
+    // the kernel updates and persists the profiles of the apps using it
+    Natives.setRootTemplate(template.id, toNativeProfile(template))
+    return true
 }
 
 @Composable
@@ -30,6 +30,15 @@ fun pickPrimary(apps: List<SuperUserViewModel.AppInfo>): SuperUserViewModel.AppI
 }
 
 val ownerNameCache = mutableMapOf<Int, String>()
+private val userNameCache = mutableMapOf<Int, String>()
+
+// Called after the package list is reloaded, with names fetched by Natives.getUserNames.
+fun resetOwnerNames(uids: IntArray, names: Array<String?>) {
+    ownerNameCache.clear()
+    userNameCache.clear()
+    uids.forEachIndexed { i, uid -> userNameCache[uid] = names[i] ?: "" }
+}
+
 fun ownerNameForUid(uid: Int): String {
     ownerNameCache[uid]?.let { return it.ifEmpty { uid.toString() } }
     val apps = SuperUserViewModel.apps.filter { it.uid == uid }
@@ -40,7 +49,7 @@ fun ownerNameForUid(uid: Int): String {
         val text = runCatching { pm.getText(labeledApp.packageName, resId, labeledApp.packageInfo.applicationInfo) }.getOrNull()
         text?.toString() ?: ""
     } else {
-        Natives.getUserName(uid) ?: ""
+        userNameCache.getOrPut(uid) { Natives.getUserName(uid) ?: "" }
     }
     val appId = uid % 100000
     val isAppRange = appId in 10000..19999
@@ -37,6 +37,7 @@ import me.weishu.kernelsu.ui.KsuService
 import me.weishu.kernelsu.ui.component.SearchStatus
 import me.weishu.kernelsu.ui.util.HanziToPinyin
 import me.weishu.kernelsu.ui.util.KsuCli
+import me.weishu.kernelsu.ui.util.resetOwnerNames
 import java.text.Collator
 import java.util.Locale
 import kotlin.coroutines.resume
@@ -181,14 +182,15 @@ class SuperUserViewModel : ViewModel() {
                 }
 
                 val packages = slice.list
-                val newApps = packages.map {
-                    val appInfo = it.applicationInfo
-                    val uid = appInfo!!.uid
-                    val profile = Natives.getAppProfile(it.packageName, uid)
+                val profiles = Natives.getAppProfiles(
+                    packages.map { it.packageName }.toTypedArray(),
+                    packages.map { it.applicationInfo!!.uid }.toIntArray(),
+                )
+                val newApps = packages.mapIndexed { i, it ->
                     AppInfo(
-                        label = appInfo.loadLabel(pm).toString(),
+                        label = it.applicationInfo!!.loadLabel(pm).toString(),
                         packageInfo = it,
-                        profile = profile,
+                        profile = profiles[i],
                     )
                 }.filter { it.packageName != ksuApp.packageName }
                     .filter {
@@ -211,15 +213,22 @@ class SuperUserViewModel : ViewModel() {
                             || it.packageInfo.applicationInfo!!.flags.and(ApplicationInfo.FLAG_SYSTEM) == 0
                 }
 
+                // names of uids shared by several packages, shown as group titles
+                Natives.clearUserNameCache()
+                val sharedUids = newApps.groupBy { it.uid }.filterValues { it.size > 1 }
+                    .keys.toIntArray()
+                val userNames = Natives.getUserNames(sharedUids)
+
                 Log.i(TAG, "load cost: ${SystemClock.elapsedRealtime() - start}")
 
-                Pair(newApps, sortedFiltered)
+                Triple(newApps, sortedFiltered, sharedUids to userNames)
             }
 
             withContext(Dispatchers.Main) {
                 synchronized(appsLock) {
                     apps = allPackagesSlice.first
                 }
+                allPackagesSlice.third.let { (uids, names) -> resetOwnerNames(uids, names) }
                 _appList.value = allPackagesSlice.second
                 isRefreshing = false
                 stopKsuService()
@@ -1,11 +1,13 @@
 package me.weishu.kernelsu.ui.viewmodel
 
+import android.content.Context
 import android.os.Parcelable
 import android.util.Log
 import androidx.compose.runtime.derivedStateOf
 import androidx.compose.runtime.getValue
 import androidx.compose.runtime.mutableStateOf
 import androidx.compose.runtime.setValue
+import androidx.core.content.edit
 import androidx.lifecycle.ViewModel
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
@@ -14,6 +16,7 @@ import me.weishu.kernelsu.Natives
 import me.weishu.kernelsu.ksuApp
 import me.weishu.kernelsu.profile.Capabilities
 import me.weishu.kernelsu.profile.Groups
+import me.weishu.kernelsu.ui.screen.toNativeProfile
 import me.weishu.kernelsu.ui.util.getAppProfileTemplate
 import me.weishu.kernelsu.ui.util.listAppProfileTemplates
 import me.weishu.kernelsu.ui.util.setAppProfileTemplate
@@ -81,6 +84,7 @@ class TemplateViewModel : ViewModel() {
 
             // fetch templates again
             templates = listAppProfileTemplates().mapNotNull(::getTemplateInfoById)
+            syncKernelTemplates(templates)
 
             isRefreshing = false
         }
@@ -197,6 +201,20 @@ private inline fun <reified T : Enum<T>> getEnumOrdinals(
     }).orEmpty()
 }
 
+private const val KERNEL_TEMPLATES_KEY = "kernel_root_templates"
+
+// Keep the kernel copies in sync with templates changed outside the editor, and
+// drop the ones whose file is gone so they stop overriding the apps linked to them.
+private fun syncKernelTemplates(templates: List<TemplateViewModel.TemplateInfo>) {
+    val prefs = ksuApp.getSharedPreferences("settings", Context.MODE_PRIVATE)
+    val ids = templates.map { it.id }.toSet()
+    templates.forEach { Natives.setRootTemplate(it.id, toNativeProfile(it)) }
+    prefs.getStringSet(KERNEL_TEMPLATES_KEY, emptySet())!!
+        .filterNot { it in ids }
+        .forEach { Natives.removeRootTemplate(it) }
+    prefs.edit { putStringSet(KERNEL_TEMPLATES_KEY, ids) }
+}
+
 fun getTemplateInfoById(id: String): TemplateViewModel.TemplateInfo? {
     return runCatching {
         fromJSON(JSONObject(getAppProfileTemplate(id)))
@@ -0,0 +1,198 @@
+//! Reader for the kernel's su audit log, see kernel/audit.h.
+//!
+//! The kernel keeps one ring per cpu in a shared area. We map it read-only
+//! and follow each ring's head, so reading costs no syscall per record.
+
+use std::{
+    fmt,
+    os::fd::{FromRawFd, OwnedFd},
+    ptr,
+    sync::atomic::{AtomicU64, Ordering, fence},
+    thread,
+    time::Duration,
+};
+
+use anyhow::{Context, Result, ensure};
+
+use crate::ksucalls;
+
+const HEADER_SIZE: usize = 64;
+const POLL_INTERVAL: Duration = Duration::from_millis(500);
+
+const AUDIT_SU_GRANT: u32 = 1;
+const AUDIT_SU_DENY: u32 = 2;
+const AUDIT_UMOUNT: u32 = 3;
+const AUDIT_PROFILE_CHANGED: u32 = 4;
+
+const AUDIT_VIA_IOCTL: u32 = 1;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct Record {
+    pub seq: u64,
+    pub timestamp: u64,
+    pub kind: u32,
+    pub uid: u32,
+    pub pid: u32,
+    pub data: u32,
+    pub comm: [u8; 16],
+}
+
+impl fmt::Display for Record {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let len = self.comm.iter().position(|&c| c == 0).unwrap_or(16);
+        let comm = String::from_utf8_lossy(&self.comm[..len]);
+        write!(
+            f,
+            "[{:>5}.{:06}] uid={} pid={} comm={comm} ",
+            self.timestamp / 1_000_000_000,
+            self.timestamp % 1_000_000_000 / 1000,
+            self.uid,
+            self.pid,
+        )?;
+        match self.kind {
+            AUDIT_SU_GRANT => write!(f, "su granted as uid {}", self.data),
+            AUDIT_SU_DENY if self.data == AUDIT_VIA_IOCTL => write!(f, "su denied (ioctl)"),
+            AUDIT_SU_DENY => write!(f, "su denied (execve)"),
+            AUDIT_UMOUNT => write!(f, "modules unmounted"),
+            AUDIT_PROFILE_CHANGED => write!(f, "profile changed, allow su: {}", self.data != 0),
+            kind => write!(f, "unknown record {kind}, data {}", self.data),
+        }
+    }
+}
+
+pub struct AuditLog {
+    map: *const u8,
+    len: usize,
+    cpu_size: usize,
+    // last seq read from each cpu's ring
+    tails: Vec<u64>,
+    _fd: OwnedFd,
+}
+
+// The mapping is page aligned and the kernel keeps every header and record
+// 8-byte aligned inside it, so the casts below are sound.
+#[allow(clippy::cast_ptr_alignment)]
+impl AuditLog {
+    pub fn open() -> Result<Self> {
+        let cmd = ksucalls::get_audit_fd().context("get audit fd")?;
+        let fd = unsafe { OwnedFd::from_raw_fd(cmd.fd) };
+        let cpu_size = cmd.cpu_size as usize;
+        let len = cmd.nr_cpus as usize * cpu_size;
+
+        let map = unsafe {
+            libc::mmap(
+                ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_SHARED,
+                cmd.fd,
+                0,
+            )
+        };
+        ensure!(
+            map != libc::MAP_FAILED,
+            "mmap audit log: {}",
+            std::io::Error::last_os_error()
+        );
+
+        let log = Self {
+            map: map.cast(),
+            len,
+            cpu_size,
+            tails: vec![0; cmd.nr_cpus as usize],
+            _fd: fd,
+        };
+        let (records, record_size) = log.geometry(0);
+        ensure!(
+            records > 0 && record_size >= size_of::<Record>(),
+            "unsupported audit ring: {records} records of {record_size} bytes"
+        );
+        Ok(log)
+    }
+
+    const fn ring(&self, cpu: usize) -> *const u8 {
+        unsafe { self.map.add(cpu * self.cpu_size) }
+    }
+
+    // (records, record_size) of a ring, fixed once the kernel set them up
+    fn geometry(&self, cpu: usize) -> (u64, usize) {
+        let ring = self.ring(cpu);
+        unsafe {
+            let records = ptr::read_volatile(ring.add(8).cast::<u32>());
+            let record_size = ptr::read_volatile(ring.add(12).cast::<u32>());
+            (u64::from(records), record_size as usize)
+        }
+    }
+
+    /// Append the records written since the last call to `out`, ordered by
+    /// time. Returns how many were overwritten before we got to them.
+    pub fn read_new(&mut self, out: &mut Vec<Record>) -> u64 {
+        let start = out.len();
+        let mut lost = 0;
+
+        for cpu in 0..self.tails.len() {
+            let ring = self.ring(cpu);
+            let (records, record_size) = self.geometry(cpu);
+            let head = unsafe { &*ring.cast::<AtomicU64>() }.load(Ordering::Acquire);
+
+            let mut next = self.tails[cpu] + 1;
+            let oldest = head.saturating_sub(records) + 1;
+            if next < oldest {
+                lost += oldest - next;
+                next = oldest;
+            }
+
+            while next <= head {
+                let slot = unsafe {
+                    ring.add(HEADER_SIZE + ((next - 1) % records) as usize * record_size)
+                };
+                let seq = unsafe { &*slot.cast::<AtomicU64>() };
+                if seq.load(Ordering::Acquire) == next {
+                    let record = unsafe { ptr::read_volatile(slot.cast::<Record>()) };
+                    fence(Ordering::Acquire);
+                    // the kernel clears seq before reusing the slot
+                    if seq.load(Ordering::Relaxed) == next {
+                        out.push(record);
+                        next += 1;
+                        continue;
+                    }
+                }
+                lost += 1;
+                next += 1;
+            }
+            self.tails[cpu] = head;
+        }
+
+        out[start..].sort_by_key(|r| r.timestamp);
+        lost
+    }
+}
+
+impl Drop for AuditLog {
+    fn drop(&mut self) {
+        unsafe {
+            libc::munmap(self.map.cast_mut().cast(), self.len);
+        }
+    }
+}
+
+pub fn dump(follow: bool) -> Result<()> {
+    let mut log = AuditLog::open()?;
+    let mut records = Vec::new();
+
+    loop {
+        records.clear();
+        let lost = log.read_new(&mut records);
+        if lost > 0 {
+            println!("-- {lost} records lost --");
+        }
+        for record in &records {
+            println!("{record}");
+        }
+        if !follow {
+            return Ok(());
+        }
+        thread::sleep(POLL_INTERVAL);
+    }
+}
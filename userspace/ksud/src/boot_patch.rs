@@ -14,10 +14,14 @@ use anyhow::ensure;
 use regex_lite::Regex;
 use which::which;
 
+use crate::cpio::Cpio;
 use crate::defs::BACKUP_FILENAME;
 use crate::defs::{KSU_BACKUP_DIR, KSU_BACKUP_FILE_PREFIX};
 use crate::{assets, utils};
 
+// boot partitions are tens of MiB, read/write them in large chunks
+const COPY_BUFFER_SIZE: usize = 1024 * 1024;
+
 #[cfg(target_os = "android")]
 fn ensure_gki_kernel() -> Result<()> {
     let version = get_kernel_version()?;
@@ -150,59 +154,87 @@ fn parse_kmi_from_boot(magiskboot: &Path, image: &PathBuf, workdir: &Path) -> Re
     parse_kmi_from_kernel(&image_path, workdir)
 }
 
-fn do_cpio_cmd(magiskboot: &Path, workdir: &Path, cpio_path: &Path, cmd: &str) -> Result<()> {
-    let status = Command::new(magiskboot)
-        .current_dir(workdir)
-        .stdout(Stdio::null())
-        .stderr(Stdio::null())
-        .arg("cpio")
-        .arg(cpio_path)
-        .arg(cmd)
-        .status()?;
-    ensure!(status.success(), "magiskboot cpio {} failed", cmd);
+/// Copy a boot image between a partition and a file with large sequential
+/// reads/writes, syncing the destination once at the end.
+fn copy_image<P: AsRef<Path>, Q: AsRef<Path>>(ifile: P, ofile: Q) -> Result<()> {
+    copy_image_with(ifile.as_ref(), ofile.as_ref(), |_| {})
+}
+
+/// Like `copy_image`, but feeds every chunk to `inspect` as it passes
+/// through, so callers can hash the image without reading it again.
+fn copy_image_with(ifile: &Path, ofile: &Path, mut inspect: impl FnMut(&[u8])) -> Result<()> {
+    use std::io::{Read, Write};
+    let mut input =
+        std::fs::File::open(ifile).with_context(|| format!("open {}", ifile.display()))?;
+    let mut output = std::fs::OpenOptions::new()
+        .write(true)
+        .create(true)
+        .truncate(!is_block_device(ofile))
+        .open(ofile)
+        .with_context(|| format!("open {}", ofile.display()))?;
+
+    let mut buffer = vec![0u8; COPY_BUFFER_SIZE];
+    loop {
+        let n = match input.read(&mut buffer) {
+            Ok(0) => break,
+            Ok(n) => n,
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e).with_context(|| format!("read {}", ifile.display())),
+        };
+        inspect(&buffer[..n]);
+        output
+            .write_all(&buffer[..n])
+            .with_context(|| format!("write {}", ofile.display()))?;
+    }
+    output
+        .sync_all()
+        .with_context(|| format!("sync {}", ofile.display()))?;
     Ok(())
 }
 
-fn is_magisk_patched(magiskboot: &Path, workdir: &Path, cpio_path: &Path) -> Result<bool> {
+#[cfg(unix)]
+fn is_block_device(path: &Path) -> bool {
+    use std::os::unix::fs::FileTypeExt;
+    std::fs::metadata(path).is_ok_and(|m| m.file_type().is_block_device())
+}
+
+#[cfg(not(unix))]
+fn is_block_device(_path: &Path) -> bool {
+    false
+}
+
+fn magiskboot_unpack(magiskboot: &Path, workdir: &Path, image: &Path) -> Result<()> {
     let status = Command::new(magiskboot)
         .current_dir(workdir)
         .stdout(Stdio::null())
         .stderr(Stdio::null())
-        .arg("cpio")
-        .arg(cpio_path)
-        .arg("test")
+        .arg("unpack")
+        .arg(image)
         .status()?;
-    // 0: stock, 1: magisk
-    Ok(status.code() == Some(1))
+    ensure!(status.success(), "magiskboot unpack failed");
+    Ok(())
 }
 
-fn is_kernelsu_patched(magiskboot: &Path, workdir: &Path, cpio_path: &Path) -> Result<bool> {
+fn magiskboot_repack(magiskboot: &Path, workdir: &Path, image: &Path) -> Result<PathBuf> {
     let status = Command::new(magiskboot)
         .current_dir(workdir)
         .stdout(Stdio::null())
         .stderr(Stdio::null())
-        .arg("cpio")
-        .arg(cpio_path)
-        .arg("exists kernelsu.ko")
+        .arg("repack")
+        .arg(image)
         .status()?;
-
-    Ok(status.success())
+    ensure!(status.success(), "magiskboot repack failed");
+    Ok(workdir.join("new-boot.img"))
 }
 
-fn dd<P: AsRef<Path>, Q: AsRef<Path>>(ifile: P, ofile: Q) -> Result<()> {
-    let status = Command::new("dd")
-        .stdout(Stdio::null())
-        .stderr(Stdio::null())
-        .arg(format!("if={}", ifile.as_ref().display()))
-        .arg(format!("of={}", ofile.as_ref().display()))
-        .status()?;
-    ensure!(
-        status.success(),
-        "dd if={:?} of={:?} failed",
-        ifile.as_ref(),
-        ofile.as_ref()
-    );
-    Ok(())
+fn find_ramdisk(workdir: &Path) -> Option<PathBuf> {
+    [
+        workdir.join("ramdisk.cpio"),
+        workdir.join("vendor_ramdisk").join("init_boot.cpio"),
+        workdir.join("vendor_ramdisk").join("ramdisk.cpio"),
+    ]
+    .into_iter()
+    .find(|p| p.exists())
 }
 
 #[derive(clap::Args, Debug)]
@@ -244,49 +276,23 @@ pub fn restore(args: BootRestoreArgs) -> Result<()> {
     let (bootimage, bootdevice) = find_boot_image(&image, &kmi, false, false, workdir, &None)?;
 
     println!("- Unpacking boot image");
-    let status = Command::new(&magiskboot)
-        .current_dir(workdir)
-        .stdout(Stdio::null())
-        .stderr(Stdio::null())
-        .arg("unpack")
-        .arg(bootimage.display().to_string())
-        .status()?;
-    ensure!(status.success(), "magiskboot unpack failed");
+    magiskboot_unpack(&magiskboot, workdir, &bootimage)?;
 
-    let mut ramdisk = workdir.join("ramdisk.cpio");
-    if !ramdisk.exists() {
-        ramdisk = workdir.join("vendor_ramdisk").join("init_boot.cpio");
-    }
-    if !ramdisk.exists() {
-        ramdisk = workdir.join("vendor_ramdisk").join("ramdisk.cpio");
-    }
-    if !ramdisk.exists() {
+    let Some(ramdisk) = find_ramdisk(workdir) else {
         bail!("No compatible ramdisk found.")
-    }
-    let ramdisk = ramdisk.as_path();
-    let is_kernelsu_patched = is_kernelsu_patched(&magiskboot, workdir, ramdisk)?;
-    ensure!(is_kernelsu_patched, "boot image is not patched by KernelSU");
+    };
+    let mut cpio = Cpio::load(&ramdisk)?;
+    ensure!(
+        cpio.exists("kernelsu.ko"),
+        "boot image is not patched by KernelSU"
+    );
 
     let mut new_boot = None;
     let mut from_backup = false;
 
     #[cfg(target_os = "android")]
-    if do_cpio_cmd(
-        &magiskboot,
-        workdir,
-        ramdisk,
-        &format!("exists {BACKUP_FILENAME}"),
-    )
-    .is_ok()
-    {
-        do_cpio_cmd(
-            &magiskboot,
-            workdir,
-            ramdisk,
-            &format!("extract {BACKUP_FILENAME} {BACKUP_FILENAME}"),
-        )?;
-        let sha = std::fs::read(workdir.join(BACKUP_FILENAME))?;
-        let sha = String::from_utf8(sha)?;
+    if let Some(entry) = cpio.get(BACKUP_FILENAME) {
+        let sha = String::from_utf8(entry.data.clone())?;
         let sha = sha.trim();
         let backup_path =
             PathBuf::from(KSU_BACKUP_DIR).join(format!("{KSU_BACKUP_FILE_PREFIX}{sha}"));
@@ -307,24 +313,16 @@ pub fn restore(args: BootRestoreArgs) -> Result<()> {
     let new_boot = new_boot.map_or_else(
         || -> Result<_> {
             // remove kernelsu.ko
-            do_cpio_cmd(&magiskboot, workdir, ramdisk, "rm kernelsu.ko")?;
+            cpio.rm("kernelsu.ko");
 
             // if init.real exists, restore it
-            let status = do_cpio_cmd(&magiskboot, workdir, ramdisk, "exists init.real").is_ok();
-            if status {
-                do_cpio_cmd(&magiskboot, workdir, ramdisk, "mv init.real init")?;
+            if cpio.exists("init.real") {
+                cpio.mv("init.real", "init")?;
             }
+            cpio.save(&ramdisk)?;
 
             println!("- Repacking boot image");
-            let status = Command::new(&magiskboot)
-                .current_dir(workdir)
-                .stdout(Stdio::null())
-                .stderr(Stdio::null())
-                .arg("repack")
-                .arg(&bootimage)
-                .status()?;
-            ensure!(status.success(), "magiskboot repack failed");
-            Ok(workdir.join("new-boot.img"))
+            magiskboot_repack(&magiskboot, workdir, &bootimage)
         },
         Ok,
     )?;
@@ -489,85 +487,60 @@ pub fn patch(args: BootPatchArgs) -> Result<()> {
 
         let kmod_file = workdir.join("kernelsu.ko");
         if let Some(kmod) = kmod {
-            std::fs::copy(kmod, kmod_file).context("copy kernel module failed")?;
+            std::fs::copy(kmod, &kmod_file).context("copy kernel module failed")?;
         } else {
             // If kmod is not specified, extract from assets
             println!("- KMI: {kmi}");
             let name = format!("{kmi}_kernelsu.ko");
-            assets::copy_assets_to_file(&name, kmod_file)
+            assets::copy_assets_to_file(&name, &kmod_file)
                 .with_context(|| format!("Failed to copy {name}"))?;
         }
 
         let init_file = workdir.join("init");
         if let Some(init) = init {
-            std::fs::copy(init, init_file).context("copy init failed")?;
+            std::fs::copy(init, &init_file).context("copy init failed")?;
         } else {
-            assets::copy_assets_to_file("ksuinit", init_file).context("copy ksuinit failed")?;
+            assets::copy_assets_to_file("ksuinit", &init_file).context("copy ksuinit failed")?;
         }
 
         println!("- Unpacking boot image");
-        let status = Command::new(&magiskboot)
-            .current_dir(workdir)
-            .stdout(Stdio::null())
-            .stderr(Stdio::null())
-            .arg("unpack")
-            .arg(bootimage)
-            .status()?;
-        ensure!(status.success(), "magiskboot unpack failed");
-
-        let mut ramdisk = workdir.join("ramdisk.cpio");
-        if !ramdisk.exists() {
-            ramdisk = workdir.join("vendor_ramdisk").join("init_boot.cpio");
-        }
-        if !ramdisk.exists() {
-            ramdisk = workdir.join("vendor_ramdisk").join("ramdisk.cpio");
-        }
-        if !ramdisk.exists() {
+        magiskboot_unpack(&magiskboot, workdir, bootimage)?;
+
+        let ramdisk = find_ramdisk(workdir).unwrap_or_else(|| {
             println!("- No ramdisk, create by default");
-            ramdisk = "ramdisk.cpio".into();
-        }
-        let ramdisk = ramdisk.as_path();
-        let is_magisk_patched = is_magisk_patched(&magiskboot, workdir, ramdisk)?;
-        ensure!(!is_magisk_patched, "Cannot work with Magisk patched image");
+            workdir.join("ramdisk.cpio")
+        });
+        let mut cpio = Cpio::load(&ramdisk)?;
+        ensure!(
+            !cpio.is_magisk_patched(),
+            "Cannot work with Magisk patched image"
+        );
 
         println!("- Adding KernelSU LKM");
-        let is_kernelsu_patched = is_kernelsu_patched(&magiskboot, workdir, ramdisk)?;
+        let is_kernelsu_patched = cpio.exists("kernelsu.ko");
 
         let need_backup = if is_kernelsu_patched {
             false
         } else {
             // kernelsu.ko is not exist, backup init if necessary
-            let status = do_cpio_cmd(&magiskboot, workdir, ramdisk, "exists init");
-            if status.is_ok() {
-                do_cpio_cmd(&magiskboot, workdir, ramdisk, "mv init init.real")?;
+            if cpio.exists("init") {
+                cpio.mv("init", "init.real")?;
             }
             flash
         };
 
-        do_cpio_cmd(&magiskboot, workdir, ramdisk, "add 0755 init init")?;
-        do_cpio_cmd(
-            &magiskboot,
-            workdir,
-            ramdisk,
-            "add 0755 kernelsu.ko kernelsu.ko",
-        )?;
+        cpio.add_file(0o755, "init", &init_file)?;
+        cpio.add_file(0o755, "kernelsu.ko", &kmod_file)?;
 
         #[cfg(target_os = "android")]
-        if need_backup && let Err(e) = do_backup(&magiskboot, workdir, ramdisk, bootimage) {
+        if need_backup && let Err(e) = do_backup(&mut cpio, bootimage) {
             println!("- Backup stock image failed: {e}");
         }
 
+        cpio.save(&ramdisk)?;
+
         println!("- Repacking boot image");
-        // magiskboot repack boot.img
-        let status = Command::new(&magiskboot)
-            .current_dir(workdir)
-            .stdout(Stdio::null())
-            .stderr(Stdio::null())
-            .arg("repack")
-            .arg(bootimage)
-            .status()?;
-        ensure!(status.success(), "magiskboot repack failed");
-        let new_boot = workdir.join("new-boot.img");
+        let new_boot = magiskboot_repack(&magiskboot, workdir, bootimage)?;
 
         if patch_file {
             // if image is specified, write to output file
@@ -604,42 +577,30 @@ pub fn patch(args: BootPatchArgs) -> Result<()> {
     result
 }
 
-#[cfg(target_os = "android")]
-fn calculate_sha1(file_path: impl AsRef<Path>) -> Result<String> {
+/// Copy the stock image into `dir`, hashing it on the way so the image is
+/// only read once. Returns the SHA1 used to name the backup.
+#[cfg(any(target_os = "android", test))]
+fn backup_image(image: &Path, dir: &Path) -> Result<String> {
     use sha1::Digest;
-    use std::io::Read;
-    let mut file = std::fs::File::open(file_path.as_ref())?;
     let mut hasher = sha1::Sha1::new();
-    let mut buffer = [0; 1024];
-
-    loop {
-        let n = file.read(&mut buffer)?;
-        if n == 0 {
-            break;
-        }
-        hasher.update(&buffer[..n]);
+    let tmp = dir.join(format!("{KSU_BACKUP_FILE_PREFIX}tmp"));
+    let result = copy_image_with(image, &tmp, |chunk| hasher.update(chunk));
+    if let Err(e) = result {
+        let _ = std::fs::remove_file(&tmp);
+        return Err(e);
     }
-
-    let result = hasher.finalize();
-    Ok(format!("{result:x}"))
+    let sha1 = format!("{:x}", hasher.finalize());
+    let target = dir.join(format!("{KSU_BACKUP_FILE_PREFIX}{sha1}"));
+    std::fs::rename(&tmp, &target).with_context(|| format!("backup to {}", target.display()))?;
+    Ok(sha1)
 }
 
 #[cfg(target_os = "android")]
-fn do_backup(magiskboot: &Path, workdir: &Path, cpio_path: &Path, image: &Path) -> Result<()> {
-    let sha1 = calculate_sha1(image)?;
-    let filename = format!("{KSU_BACKUP_FILE_PREFIX}{sha1}");
-
+fn do_backup(cpio: &mut Cpio, image: &Path) -> Result<()> {
     println!("- Backup stock boot image");
-    // magiskboot cpio ramdisk.cpio 'add 0755 $BACKUP_FILENAME'
-    let target = format!("{KSU_BACKUP_DIR}{filename}");
-    std::fs::copy(image, &target).with_context(|| format!("backup to {target}"))?;
-    std::fs::write(workdir.join(BACKUP_FILENAME), sha1.as_bytes()).context("write sha1")?;
-    do_cpio_cmd(
-        magiskboot,
-        workdir,
-        cpio_path,
-        &format!("add 0755 {BACKUP_FILENAME} {BACKUP_FILENAME}"),
-    )?;
+    let sha1 = backup_image(image, Path::new(KSU_BACKUP_DIR))?;
+    let target = format!("{KSU_BACKUP_DIR}{KSU_BACKUP_FILE_PREFIX}{sha1}");
+    cpio.add(0o755, BACKUP_FILENAME, sha1.into_bytes());
     println!("- Stock image has been backup to");
     println!("- {target}");
     Ok(())
@@ -677,10 +638,68 @@ fn flash_boot(bootdevice: &Option<String>, new_boot: PathBuf) -> Result<()> {
         .arg(bootdevice)
         .status()?;
     ensure!(status.success(), "set boot device rw failed");
-    dd(new_boot, bootdevice).context("flash boot failed")?;
+    flash_image(&new_boot, Path::new(bootdevice)).context("flash boot failed")?;
     Ok(())
 }
 
+/// Write `image` to the start of `device` and read it back to verify.
+///
+/// The image is streamed in large chunks and hashed on the way. The
+/// read-back bypasses the page cache so the comparison is against what
+/// actually hit the device. Nothing is discarded: the partition keeps its
+/// old contents until they are overwritten, and whatever lies past the
+/// image, such as an AVB footer, is never touched.
+fn flash_image(image: &Path, device: &Path) -> Result<()> {
+    use sha1::Digest;
+    let len = std::fs::metadata(image)
+        .with_context(|| format!("stat {}", image.display()))?
+        .len();
+
+    let mut hasher = sha1::Sha1::new();
+    copy_image_with(image, device, |chunk| hasher.update(chunk))?;
+    let expected = hasher.finalize();
+
+    let actual = sha1_prefix(device, len)?;
+    ensure!(
+        expected == actual,
+        "verify {} failed: checksum mismatch",
+        device.display()
+    );
+    Ok(())
+}
+
+fn sha1_prefix(path: &Path, len: u64) -> Result<sha1::digest::Output<sha1::Sha1>> {
+    use sha1::Digest;
+    use std::io::Read;
+    let file = std::fs::File::open(path).with_context(|| format!("open {}", path.display()))?;
+    drop_page_cache(&file);
+
+    let mut reader = file.take(len);
+    let mut hasher = sha1::Sha1::new();
+    let mut buffer = vec![0u8; COPY_BUFFER_SIZE];
+    loop {
+        let n = match reader.read(&mut buffer) {
+            Ok(0) => break,
+            Ok(n) => n,
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(e).with_context(|| format!("read {}", path.display())),
+        };
+        hasher.update(&buffer[..n]);
+    }
+    Ok(hasher.finalize())
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn drop_page_cache(file: &std::fs::File) {
+    use std::os::fd::AsRawFd;
+    unsafe {
+        libc::posix_fadvise(file.as_raw_fd(), 0, 0, libc::POSIX_FADV_DONTNEED);
+    }
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn drop_page_cache(_file: &std::fs::File) {}
+
 fn find_magiskboot(magiskboot_path: Option<PathBuf>, workdir: &Path) -> Result<PathBuf> {
     let magiskboot = {
         if which("magiskboot").is_ok() {
@@ -731,7 +750,7 @@ fn find_boot_image(
         println!("- Bootdevice: {boot_partition}");
         let tmp_boot_path = workdir.join("boot.img");
 
-        dd(&boot_partition, &tmp_boot_path)?;
+        copy_image(&boot_partition, &tmp_boot_path)?;
 
         ensure!(tmp_boot_path.exists(), "boot image not found");
 
@@ -848,3 +867,116 @@ rm -f /data/adb/post-fs-data.d/post_ota.sh
 
     Ok(())
 }
+
+#[cfg(all(test, unix))]
+mod tests {
+    use super::*;
+
+    const IMAGE_SIZE: usize = 64 << 20;
+
+    /// Stands in for magiskboot: `unpack` takes the whole image as the
+    /// ramdisk, which parses up to its trailer, and `repack` puts the
+    /// edited ramdisk back in front of the image.
+    const MAGISKBOOT_STUB: &str = r#"#!/bin/sh
+case "$1" in
+unpack) cp "$2" ramdisk.cpio ;;
+repack) cat ramdisk.cpio "$2" > new-boot.img ;;
+*) exit 1 ;;
+esac
+"#;
+
+    // Incompressible filler, so nothing along the way gets a shortcut
+    fn fill(buf: &mut [u8], mut seed: u64) {
+        for chunk in buf.chunks_mut(8) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            chunk.copy_from_slice(&seed.to_le_bytes()[..chunk.len()]);
+        }
+    }
+
+    fn time<T>(what: &str, f: impl FnOnce() -> Result<T>) -> T {
+        let start = std::time::Instant::now();
+        let value = f().unwrap();
+        println!("boot patch: {what} {:?}", start.elapsed());
+        value
+    }
+
+    /// The file side of patching a 64 MiB boot image with magiskboot
+    /// stubbed out, run with
+    /// `cargo test --release boot_patch::tests::bench -- --ignored --nocapture`
+    #[test]
+    #[ignore = "benchmark"]
+    fn bench_patch_pipeline() {
+        let dir = tempfile::tempdir().unwrap();
+        let workdir = dir.path().join("work");
+        let backup_dir = dir.path().join("backup");
+        std::fs::create_dir(&workdir).unwrap();
+        std::fs::create_dir(&backup_dir).unwrap();
+
+        let magiskboot = dir.path().join("magiskboot");
+        std::fs::write(&magiskboot, MAGISKBOOT_STUB).unwrap();
+        std::fs::set_permissions(&magiskboot, std::fs::Permissions::from_mode(0o755)).unwrap();
+
+        // a first stage ramdisk with the stock init, padded to a boot
+        // partition with filler standing in for the kernel
+        let mut ramdisk = Cpio::default();
+        let mut data = vec![0; 2 << 20];
+        fill(&mut data, 1);
+        ramdisk.add(0o750, "init", data);
+        for i in 0..400 {
+            let mut data = vec![0; (i * 211) % 16384];
+            fill(&mut data, i as u64 + 2);
+            ramdisk.add(
+                0o644,
+                &format!("first_stage_ramdisk/lib{}/f{i}", i % 5),
+                data,
+            );
+        }
+        let mut image = ramdisk.dump();
+        let ramdisk_len = image.len();
+        let mut filler = vec![0; IMAGE_SIZE - ramdisk_len];
+        fill(&mut filler, 0x9e37_79b9_7f4a_7c15);
+        image.extend_from_slice(&filler);
+        let partition = dir.path().join("boot_a");
+        std::fs::write(&partition, &image).unwrap();
+        drop((image, filler));
+
+        let init = dir.path().join("ksuinit");
+        let kmod = dir.path().join("kernelsu.ko");
+        let mut data = vec![0; 1 << 20];
+        fill(&mut data, 3);
+        std::fs::write(&init, &data[..512 << 10]).unwrap();
+        std::fs::write(&kmod, &data).unwrap();
+
+        let total = std::time::Instant::now();
+        let bootimage = workdir.join("boot.img");
+        time("copy_image", || copy_image(&partition, &bootimage));
+        time("unpack", || {
+            magiskboot_unpack(&magiskboot, &workdir, &bootimage)
+        });
+        let ramdisk = find_ramdisk(&workdir).unwrap();
+        let mut cpio = time("cpio load", || Cpio::load(&ramdisk));
+        time("cpio edit", || {
+            cpio.mv("init", "init.real")?;
+            cpio.add_file(0o755, "init", &init)?;
+            cpio.add_file(0o755, "kernelsu.ko", &kmod)
+        });
+        let sha1 = time("backup_image", || backup_image(&bootimage, &backup_dir));
+        cpio.add(0o755, BACKUP_FILENAME, sha1.as_bytes().to_vec());
+        time("cpio save", || cpio.save(&ramdisk));
+        let new_boot = time("repack", || {
+            magiskboot_repack(&magiskboot, &workdir, &bootimage)
+        });
+        time("flash_image", || flash_image(&new_boot, &partition));
+        println!("boot patch: total {:?}", total.elapsed());
+
+        let patched = Cpio::load(&partition).unwrap();
+        assert!(patched.exists("init.real"));
+        assert!(patched.exists("kernelsu.ko"));
+        assert!(patched.exists(BACKUP_FILENAME));
+        let backup = backup_dir.join(format!("{KSU_BACKUP_FILE_PREFIX}{sha1}"));
+        assert_eq!(std::fs::metadata(backup).unwrap().len(), IMAGE_SIZE as u64);
+        assert!(std::fs::metadata(&partition).unwrap().len() > (IMAGE_SIZE + ramdisk_len) as u64);
+    }
+}
@@ -8,7 +8,9 @@ use android_logger::Config;
 use log::LevelFilter;
 
 use crate::boot_patch::{BootPatchArgs, BootRestoreArgs};
-use crate::{apk_sign, assets, debug, defs, init_event, ksucalls, module, module_config, utils};
+use crate::{
+    apk_sign, assets, audit, debug, defs, init_event, ksucalls, module, module_config, utils,
+};
 
 /// KernelSU userspace cli
 #[derive(Parser, Debug)]
@@ -147,13 +149,20 @@ enum Debug {
         #[command(subcommand)]
         command: MarkCommand,
     },
+
+    /// Print kernel events
+    Events {
+        /// keep waiting for new events
+        #[arg(short, long, default_value = "false")]
+        follow: bool,
+    },
 }
 
 #[derive(clap::Subcommand, Debug)]
 enum MarkCommand {
-    /// Get mark status for a process (or all)
+    /// Get mark status for a process
     Get {
-        /// target pid (0 for total count)
+        /// target pid
         #[arg(default_value = "0")]
         pid: i32,
     },
@@ -174,6 +183,16 @@ enum MarkCommand {
 
     /// Refresh mark for all running processes
     Refresh,
+
+    /// Count marked processes by category
+    Stats,
+
+    /// Time syscalls of this process marked and unmarked
+    Bench {
+        /// syscalls per measurement
+        #[arg(default_value = "1000000")]
+        iterations: u32,
+    },
 }
 
 #[derive(clap::Subcommand, Debug)]
@@ -376,22 +395,30 @@ enum Kernel {
     },
     /// Notify that module is mounted
     NotifyModuleMounted,
+    /// Print the su audit log: grants, denials, umount decisions and profile changes
+    Audit {
+        /// keep printing new records
+        #[arg(short, long)]
+        follow: bool,
+    },
 }
 
 #[derive(clap::Subcommand, Debug)]
 enum UmountOp {
     /// Add mount point to umount list
     Add {
-        /// mount point path
-        mnt: String,
+        /// mount point paths
+        #[arg(required = true)]
+        mnt: Vec<String>,
         /// umount flags (default: 0, MNT_DETACH: 2)
         #[arg(short, long, default_value = "0")]
         flags: u32,
     },
     /// Delete mount point from umount list
     Del {
-        /// mount point path
-        mnt: String,
+        /// mount point paths
+        #[arg(required = true)]
+        mnt: Vec<String>,
     },
     /// Wipe all entries from umount list
     Wipe,
@@ -583,7 +610,10 @@ pub fn run() -> Result<()> {
                 MarkCommand::Mark { pid } => debug::mark_set(pid),
                 MarkCommand::Unmark { pid } => debug::mark_unset(pid),
                 MarkCommand::Refresh => debug::mark_refresh(),
+                MarkCommand::Stats => debug::mark_stats(),
+                MarkCommand::Bench { iterations } => debug::mark_bench(iterations),
             },
+            Debug::Events { follow } => debug::events(follow),
         },
 
         Commands::BootPatch(boot_patch) => crate::boot_patch::patch(boot_patch),
@@ -640,6 +670,7 @@ pub fn run() -> Result<()> {
                 ksucalls::report_module_mounted();
                 Ok(())
             }
+            Kernel::Audit { follow } => audit::dump(follow),
         },
     };
 
@@ -0,0 +1,437 @@
+//! Minimal in-memory editor for `newc` cpio archives.
+//!
+//! This covers the subset of `magiskboot cpio` that boot patching needs
+//! (exists/add/mv/rm/extract/test), so the ramdisk is parsed once and
+//! written back once instead of spawning magiskboot for every command.
+//! The output layout follows magiskboot: entries sorted by name, fresh
+//! inode numbers, uid/gid/mtime zeroed.
+
+use std::collections::BTreeMap;
+use std::path::Path;
+
+use anyhow::Context;
+use anyhow::Result;
+use anyhow::bail;
+use anyhow::ensure;
+
+const HEADER_LEN: usize = 110;
+const MAGIC_NEWC: &[u8] = b"070701";
+const MAGIC_CRC: &[u8] = b"070702";
+const TRAILER: &str = "TRAILER!!!";
+
+const S_IFMT: u32 = 0o170_000;
+const S_IFREG: u32 = 0o100_000;
+const S_IFDIR: u32 = 0o040_000;
+
+/// Paths whose presence means the ramdisk was patched by Magisk,
+/// mirroring `magiskboot cpio test`.
+const MAGISK_PATCHED_PATHS: [&str; 3] = [
+    ".backup/.magisk",
+    "init.magisk.rc",
+    "overlay/init.magisk.rc",
+];
+
+#[derive(Clone, Debug)]
+pub struct Entry {
+    pub mode: u32,
+    pub uid: u32,
+    pub gid: u32,
+    pub rdevmajor: u32,
+    pub rdevminor: u32,
+    pub data: Vec<u8>,
+}
+
+#[derive(Default, Debug)]
+pub struct Cpio {
+    entries: BTreeMap<String, Entry>,
+}
+
+fn align4(n: usize) -> usize {
+    (n + 3) & !3
+}
+
+fn parse_hex(field: &[u8]) -> Result<u32> {
+    let s = std::str::from_utf8(field).context("invalid cpio header")?;
+    u32::from_str_radix(s, 16).with_context(|| format!("invalid cpio header field {s:?}"))
+}
+
+fn norm_path(path: &str) -> String {
+    path.trim_start_matches("./").trim_matches('/').to_string()
+}
+
+impl Cpio {
+    pub fn parse(buf: &[u8]) -> Result<Self> {
+        let mut entries = BTreeMap::new();
+        let mut pos = 0;
+        while pos + HEADER_LEN <= buf.len() {
+            let hdr = &buf[pos..pos + HEADER_LEN];
+            let magic = &hdr[..6];
+            ensure!(
+                magic == MAGIC_NEWC || magic == MAGIC_CRC,
+                "unsupported cpio format at offset {pos}"
+            );
+            let field = |i: usize| parse_hex(&hdr[6 + i * 8..6 + (i + 1) * 8]);
+            let mode = field(1)?;
+            let uid = field(2)?;
+            let gid = field(3)?;
+            let filesize = field(6)? as usize;
+            let rdevmajor = field(9)?;
+            let rdevminor = field(10)?;
+            let namesize = field(11)? as usize;
+
+            let name_start = pos + HEADER_LEN;
+            let name_end = name_start + namesize;
+            ensure!(
+                namesize > 0 && name_end <= buf.len(),
+                "truncated cpio entry name"
+            );
+            // namesize includes the trailing NUL
+            let name = std::str::from_utf8(&buf[name_start..name_end - 1])
+                .context("invalid cpio entry name")?;
+
+            let data_start = align4(name_end);
+            let data_end = data_start + filesize;
+            ensure!(data_end <= buf.len(), "truncated cpio entry {name}");
+            pos = align4(data_end);
+
+            if name == TRAILER {
+                break;
+            }
+            if name == "." || name == ".." {
+                continue;
+            }
+            entries.insert(
+                norm_path(name),
+                Entry {
+                    mode,
+                    uid,
+                    gid,
+                    rdevmajor,
+                    rdevminor,
+                    data: buf[data_start..data_end].to_vec(),
+                },
+            );
+        }
+        Ok(Self { entries })
+    }
+
+    /// Load a cpio archive, an absent file yields an empty archive.
+    pub fn load(path: &Path) -> Result<Self> {
+        match std::fs::read(path) {
+            Ok(buf) => Self::parse(&buf).with_context(|| format!("parse {}", path.display())),
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(Self::default()),
+            Err(e) => Err(e).with_context(|| format!("read {}", path.display())),
+        }
+    }
+
+    pub fn dump(&self) -> Vec<u8> {
+        let size: usize = self
+            .entries
+            .iter()
+            .map(|(name, e)| HEADER_LEN + align4(name.len() + 1) + align4(e.data.len()) + 4)
+            .sum();
+        let mut out = Vec::with_capacity(size + HEADER_LEN + 16);
+        let mut inode = 300_000;
+        for (name, entry) in &self.entries {
+            write_entry(&mut out, inode, name, entry);
+            inode += 1;
+        }
+        let trailer = Entry {
+            mode: 0o755,
+            uid: 0,
+            gid: 0,
+            rdevmajor: 0,
+            rdevminor: 0,
+            data: Vec::new(),
+        };
+        write_entry(&mut out, inode, TRAILER, &trailer);
+        out
+    }
+
+    pub fn save(&self, path: &Path) -> Result<()> {
+        std::fs::write(path, self.dump()).with_context(|| format!("write {}", path.display()))
+    }
+
+    pub fn exists(&self, path: &str) -> bool {
+        self.entries.contains_key(&norm_path(path))
+    }
+
+    /// Equivalent of `magiskboot cpio test` returning 1.
+    pub fn is_magisk_patched(&self) -> bool {
+        MAGISK_PATCHED_PATHS.iter().any(|p| self.exists(p))
+    }
+
+    pub fn add(&mut self, mode: u32, path: &str, data: Vec<u8>) {
+        self.entries.insert(
+            norm_path(path),
+            Entry {
+                mode: (mode & !S_IFMT) | S_IFREG,
+                uid: 0,
+                gid: 0,
+                rdevmajor: 0,
+                rdevminor: 0,
+                data,
+            },
+        );
+    }
+
+    pub fn add_file(&mut self, mode: u32, path: &str, file: &Path) -> Result<()> {
+        let data = std::fs::read(file).with_context(|| format!("read {}", file.display()))?;
+        self.add(mode, path, data);
+        Ok(())
+    }
+
+    pub fn mv(&mut self, from: &str, to: &str) -> Result<()> {
+        let Some(entry) = self.entries.remove(&norm_path(from)) else {
+            bail!("no such entry {from}");
+        };
+        self.entries.insert(norm_path(to), entry);
+        Ok(())
+    }
+
+    pub fn rm(&mut self, path: &str) -> bool {
+        self.entries.remove(&norm_path(path)).is_some()
+    }
+
+    pub fn get(&self, path: &str) -> Option<&Entry> {
+        self.entries
+            .get(&norm_path(path))
+            .filter(|e| e.mode & S_IFMT != S_IFDIR)
+    }
+}
+
+fn write_entry(out: &mut Vec<u8>, inode: u32, name: &str, entry: &Entry) {
+    use std::fmt::Write;
+    let mut hdr = String::with_capacity(HEADER_LEN);
+    let fields = [
+        inode,
+        entry.mode,
+        entry.uid,
+        entry.gid,
+        1, // nlink
+        0, // mtime
+        entry.data.len() as u32,
+        0, // devmajor
+        0, // devminor
+        entry.rdevmajor,
+        entry.rdevminor,
+        name.len() as u32 + 1,
+        0, // check
+    ];
+    hdr.push_str("070701");
+    for f in fields {
+        let _ = write!(hdr, "{f:08x}");
+    }
+    out.extend_from_slice(hdr.as_bytes());
+    out.extend_from_slice(name.as_bytes());
+    out.push(0);
+    out.resize(align4(out.len()), 0);
+    out.extend_from_slice(&entry.data);
+    out.resize(align4(out.len()), 0);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // One newc entry in the layout dump() writes, built independently of
+    // write_entry so the two can be checked against each other.
+    fn newc(out: &mut Vec<u8>, inode: u32, mode: u32, name: &str, data: &[u8]) {
+        let header = format!(
+            "070701{inode:08x}{mode:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}{:08x}",
+            0,
+            0,
+            1,
+            0,
+            data.len(),
+            0,
+            0,
+            0,
+            0,
+            name.len() + 1,
+            0
+        );
+        out.extend_from_slice(header.as_bytes());
+        out.extend_from_slice(name.as_bytes());
+        out.push(0);
+        out.resize(out.len().next_multiple_of(4), 0);
+        out.extend_from_slice(data);
+        out.resize(out.len().next_multiple_of(4), 0);
+    }
+
+    fn archive(entries: &[(u32, &str, &[u8])]) -> Vec<u8> {
+        let mut out = Vec::new();
+        let mut inode = 300_000;
+        for &(mode, name, data) in entries {
+            newc(&mut out, inode, mode, name, data);
+            inode += 1;
+        }
+        newc(&mut out, inode, 0o755, TRAILER, &[]);
+        out
+    }
+
+    // names and data of every length mod 4, sorted by name
+    const SAMPLE: [(u32, &str, &[u8]); 6] = [
+        (S_IFDIR | 0o755, "a", b""),
+        (S_IFREG | 0o644, "a/b", b"x"),
+        (S_IFREG | 0o644, "a/bc", b"xy"),
+        (S_IFREG | 0o750, "a/bcd", b"xyz"),
+        (S_IFREG | 0o640, "init", b"wxyz"),
+        (S_IFREG | 0o600, "init.rc", b"on boot\n"),
+    ];
+
+    #[test]
+    fn parse_dump_is_byte_identical() {
+        let buf = archive(&SAMPLE);
+        let cpio = Cpio::parse(&buf).unwrap();
+        assert_eq!(cpio.entries.len(), SAMPLE.len());
+        assert_eq!(cpio.dump(), buf);
+        assert_eq!(Cpio::parse(&cpio.dump()).unwrap().dump(), buf);
+    }
+
+    #[test]
+    fn dump_pads_to_four_bytes() {
+        for name_len in 1..=4 {
+            for data_len in 0..=4 {
+                let name = "n".repeat(name_len);
+                let data = vec![0xa5; data_len];
+                let mut cpio = Cpio::default();
+                cpio.add(0o644, &name, data.clone());
+                let out = cpio.dump();
+                assert_eq!(out.len() % 4, 0);
+                assert_eq!(out, archive(&[(S_IFREG | 0o644, &name, &data)]));
+
+                let data_start = align4(HEADER_LEN + name_len + 1);
+                assert_eq!(&out[data_start..data_start + data_len], &data[..]);
+                assert!(
+                    out[data_start + data_len..align4(data_start + data_len)]
+                        .iter()
+                        .all(|&b| b == 0)
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn dump_ends_with_trailer() {
+        for cpio in [Cpio::default(), Cpio::parse(&archive(&SAMPLE)).unwrap()] {
+            let out = cpio.dump();
+            let name_start = out.len() - align4(HEADER_LEN + TRAILER.len() + 1) + HEADER_LEN;
+            assert_eq!(
+                &out[name_start - HEADER_LEN..name_start - HEADER_LEN + 6],
+                MAGIC_NEWC
+            );
+            assert_eq!(
+                &out[name_start..name_start + TRAILER.len()],
+                TRAILER.as_bytes()
+            );
+            assert_eq!(out[name_start + TRAILER.len()], 0);
+        }
+        assert_eq!(Cpio::default().dump(), archive(&[]));
+    }
+
+    #[test]
+    fn parse_stops_at_trailer_and_skips_dot() {
+        let mut buf = Vec::new();
+        newc(&mut buf, 1, S_IFDIR | 0o755, ".", b"");
+        newc(&mut buf, 2, S_IFREG | 0o644, "./init", b"elf");
+        newc(&mut buf, 3, 0o755, TRAILER, b"");
+        newc(&mut buf, 4, S_IFREG | 0o644, "after", b"ignored");
+
+        let cpio = Cpio::parse(&buf).unwrap();
+        assert_eq!(cpio.entries.len(), 1);
+        assert_eq!(cpio.get("init").unwrap().data, b"elf");
+        assert!(!cpio.exists("after"));
+    }
+
+    #[test]
+    fn parse_rejects_bad_input() {
+        let buf = archive(&SAMPLE);
+        assert!(Cpio::parse(b"070707").is_ok()); // shorter than a header
+        assert!(Cpio::parse(&buf[..=HEADER_LEN]).is_err());
+        // cut into the data of the last entry before the trailer
+        let trailer = align4(HEADER_LEN + TRAILER.len() + 1);
+        assert!(Cpio::parse(&buf[..buf.len() - trailer - 2]).is_err());
+
+        let mut bad = buf.clone();
+        bad[..6].copy_from_slice(b"070707");
+        assert!(Cpio::parse(&bad).is_err());
+
+        let mut bad = buf;
+        bad[14] = b'g';
+        assert!(Cpio::parse(&bad).is_err());
+    }
+
+    #[test]
+    fn add_mv_rm_exists() {
+        let mut cpio = Cpio::parse(&archive(&SAMPLE)).unwrap();
+
+        assert!(cpio.exists("init"));
+        assert!(cpio.exists("/a/b/"));
+        assert!(cpio.exists("./a/bc"));
+        assert!(!cpio.exists("a/bcde"));
+        // directories exist but have no contents to get
+        assert!(cpio.exists("a"));
+        assert!(cpio.get("a").is_none());
+
+        cpio.add(0o040_750, "overlay.d/sbin/ksud", b"bin".to_vec());
+        let added = cpio.get("overlay.d/sbin/ksud").unwrap();
+        assert_eq!(added.mode, S_IFREG | 0o750);
+        assert_eq!(added.data, b"bin");
+
+        cpio.mv("init", "/init.real").unwrap();
+        assert!(!cpio.exists("init"));
+        assert_eq!(cpio.get("init.real").unwrap().data, b"wxyz");
+        assert!(cpio.mv("init", "init.real").is_err());
+
+        assert!(cpio.rm("a/b"));
+        assert!(!cpio.rm("a/b"));
+        assert!(!cpio.exists("a/b"));
+
+        assert!(!cpio.is_magisk_patched());
+        cpio.add(0o644, "overlay/init.magisk.rc", Vec::new());
+        assert!(cpio.is_magisk_patched());
+
+        let out = cpio.dump();
+        let expected = archive(&[
+            (S_IFDIR | 0o755, "a", b""),
+            (S_IFREG | 0o644, "a/bc", b"xy"),
+            (S_IFREG | 0o750, "a/bcd", b"xyz"),
+            (S_IFREG | 0o600, "init.rc", b"on boot\n"),
+            (S_IFREG | 0o640, "init.real", b"wxyz"),
+            (S_IFREG | 0o750, "overlay.d/sbin/ksud", b"bin"),
+            (S_IFREG | 0o644, "overlay/init.magisk.rc", b""),
+        ]);
+        assert_eq!(out, expected);
+        assert_eq!(Cpio::parse(&out).unwrap().dump(), expected);
+    }
+
+    /// Parse and dump a ramdisk sized archive, run with
+    /// `cargo test --release cpio::tests::bench -- --ignored --nocapture`
+    #[test]
+    #[ignore = "benchmark"]
+    #[allow(clippy::cast_precision_loss)]
+    fn bench_parse_dump() {
+        const ENTRIES: usize = 4000;
+        const ROUNDS: u32 = 20;
+
+        let mut cpio = Cpio::default();
+        for i in 0..ENTRIES {
+            let data = vec![0x5a; (i * 37) % 8192];
+            cpio.add(0o644, &format!("system/lib{}/file{i}.so", i % 7), data);
+        }
+        let buf = cpio.dump();
+
+        let start = std::time::Instant::now();
+        for _ in 0..ROUNDS {
+            let parsed = Cpio::parse(std::hint::black_box(&buf)).unwrap();
+            assert_eq!(parsed.dump().len(), buf.len());
+        }
+        let elapsed = start.elapsed() / ROUNDS;
+        let mb = buf.len() as f64 / f64::from(1 << 20);
+        println!(
+            "cpio: {ENTRIES} entries, {mb:.1} MiB, parse+dump {elapsed:?}, {:.0} MiB/s",
+            mb / elapsed.as_secs_f64()
+        );
+    }
+}
@@ -55,10 +55,10 @@ pub fn set_manager(pkg: &str) -> Result<()> {
 
 /// Get mark status for a process
 pub fn mark_get(pid: i32) -> Result<()> {
-    let result = ksucalls::mark_get(pid)?;
     if pid == 0 {
-        bail!("Please specify a pid to get its mark status");
+        bail!("Please specify a pid to get its mark status, or use `mark stats`");
     }
+    let result = ksucalls::mark_get(pid)?;
     println!(
         "Process {pid} mark status: {}",
         if result != 0 { "marked" } else { "unmarked" }
@@ -94,3 +94,87 @@ pub fn mark_refresh() -> Result<()> {
     println!("Refreshed mark for all running processes");
     Ok(())
 }
+
+/// Print how many tasks are marked and what the hooks have seen
+pub fn mark_stats() -> Result<()> {
+    let stats = ksucalls::mark_stats()?;
+    println!("marked tasks: {}", stats.marked);
+    for (name, count) in [
+        ("init", stats.init),
+        ("zygote", stats.zygote),
+        ("ksu domain", stats.ksu_domain),
+        ("shell", stats.shell),
+        ("allowed", stats.allowed),
+        ("other", stats.other),
+    ] {
+        println!("  {name:<11}{count:>6}");
+    }
+    println!("tracepoint users: {}", stats.tracepoint_reg_count);
+    println!("slow path syscalls: {}", stats.slow_path_syscalls);
+    println!("hooked syscalls: {}", stats.hooked_syscalls);
+    Ok(())
+}
+
+/// Time an unrelated syscall and a hooked one with this process marked and
+/// unmarked. Run it on kernels built with each hook backend to compare them.
+pub fn mark_bench(iterations: u32) -> Result<()> {
+    ensure!(iterations > 0, "iterations must be positive");
+    let pid = i32::try_from(std::process::id())?;
+    let was_marked = ksucalls::mark_get(pid)? != 0;
+    // not su, so the hooks only look at it
+    let probe = c"/system/bin/ksu-mark-bench";
+
+    for marked in [false, true] {
+        if marked {
+            ksucalls::mark_set(pid)?;
+        } else {
+            ksucalls::mark_unset(pid)?;
+        }
+        let getppid = time_per_call(iterations, || {
+            unsafe { libc::getppid() };
+        });
+        let fstatat = time_per_call(iterations, || {
+            let mut st = std::mem::MaybeUninit::<libc::stat>::uninit();
+            unsafe { libc::fstatat(libc::AT_FDCWD, probe.as_ptr(), st.as_mut_ptr(), 0) };
+        });
+        println!(
+            "{:<9} getppid {getppid:>8.1} ns  newfstatat {fstatat:>8.1} ns",
+            if marked { "marked" } else { "unmarked" }
+        );
+    }
+
+    if was_marked {
+        ksucalls::mark_set(pid)?;
+    } else {
+        ksucalls::mark_unset(pid)?;
+    }
+    Ok(())
+}
+
+fn time_per_call(iterations: u32, mut f: impl FnMut()) -> f64 {
+    let start = std::time::Instant::now();
+    for _ in 0..iterations {
+        f();
+    }
+    start.elapsed().as_secs_f64() * 1e9 / f64::from(iterations)
+}
+
+/// Print buffered kernel events, optionally waiting for more
+pub fn events(follow: bool) -> Result<()> {
+    loop {
+        let events = ksucalls::read_events(follow)?;
+        if events.is_empty() && !follow {
+            return Ok(());
+        }
+        for event in events {
+            println!(
+                "[{}] {}.{:09} {} {}",
+                event.seq,
+                event.timestamp / 1_000_000_000,
+                event.timestamp % 1_000_000_000,
+                event.name(),
+                event.data
+            );
+        }
+    }
+}
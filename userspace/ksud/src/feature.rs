@@ -150,10 +150,16 @@ pub fn save_binary_config(features: &HashMap<u32, u64>) -> Result<()> {
 pub fn apply_config(features: &HashMap<u32, u64>) {
     log::info!("Applying feature configuration to kernel...");
 
+    let mut batch = crate::ksucalls::Batch::new();
+    let features: Vec<(u32, u64)> = features.iter().map(|(&id, &value)| (id, value)).collect();
+    for &(id, value) in &features {
+        batch.set_feature(id, value);
+    }
+
     let mut applied = 0;
-    for (&id, &value) in features {
-        match crate::ksucalls::set_feature(id, value) {
-            Ok(()) => {
+    for ((id, value), result) in features.into_iter().zip(batch.submit()) {
+        match result {
+            Ok(_) => {
                 if let Some(feature_id) = FeatureId::from_u32(id) {
                     log::info!("Set feature {} to {value}", feature_id.name());
                 } else {
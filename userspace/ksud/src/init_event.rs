@@ -67,13 +67,17 @@ pub fn on_post_data_fs() -> Result<()> {
         warn!("restorecon failed: {e}");
     }
 
-    // load sepolicy.rule
-    if crate::module::load_sepolicy_rule().is_err() {
-        warn!("load sepolicy.rule failed");
-    }
-
-    if let Err(e) = crate::profile::apply_sepolies() {
-        warn!("apply root profile sepolicy failed: {e}");
+    // module sepolicy.rule and root profile rules, applied as one batch
+    let mut rule_files = crate::module::sepolicy_rule_files().unwrap_or_else(|e| {
+        warn!("collect sepolicy.rule failed: {e}");
+        Vec::new()
+    });
+    match crate::profile::sepolicy_files() {
+        Ok(files) => rule_files.extend(files),
+        Err(e) => warn!("collect root profile sepolicy failed: {e}"),
+    }
+    if let Err(e) = crate::sepolicy::apply_files(&rule_files) {
+        warn!("apply sepolicy rules failed: {e}");
     }
 
     // load feature config
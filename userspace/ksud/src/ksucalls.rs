@@ -8,6 +8,11 @@ use std::sync::OnceLock;
 const EVENT_POST_FS_DATA: u32 = 1;
 const EVENT_BOOT_COMPLETED: u32 = 2;
 const EVENT_MODULE_MOUNTED: u32 = 3;
+// Events only emitted by the kernel
+const EVENT_MANAGER_CHANGED: u32 = 4;
+const EVENT_ALLOWLIST_PRUNED: u32 = 5;
+const EVENT_SAFE_MODE: u32 = 6;
+const EVENT_APP_PROFILE_CHANGED: u32 = 7;
 
 const KSU_IOCTL_GRANT_ROOT: u32 = 0x00004b01; // _IOC(_IOC_NONE, 'K', 1, 0)
 const KSU_IOCTL_GET_INFO: u32 = 0x80004b02; // _IOC(_IOC_READ, 'K', 2, 0)
@@ -20,6 +25,10 @@ const KSU_IOCTL_GET_WRAPPER_FD: u32 = 0x40004b0f; // _IOC(_IOC_WRITE, 'K', 15, 0
 const KSU_IOCTL_MANAGE_MARK: u32 = 0xc0004b10; // _IOC(_IOC_READ|_IOC_WRITE, 'K', 16, 0)
 const KSU_IOCTL_NUKE_EXT4_SYSFS: u32 = 0x40004b11; // _IOC(_IOC_WRITE, 'K', 17, 0)
 const KSU_IOCTL_ADD_TRY_UMOUNT: u32 = 0x40004b12; // _IOC(_IOC_WRITE, 'K', 18, 0)
+const KSU_IOCTL_BATCH: u32 = 0xc0004b13; // _IOC(_IOC_READ|_IOC_WRITE, 'K', 19, 0)
+const KSU_IOCTL_MARK_STATS: u32 = 0x80004b14; // _IOC(_IOC_READ, 'K', 20, 0)
+const KSU_IOCTL_GET_AUDIT_FD: u32 = 0x80004b16; // _IOC(_IOC_READ, 'K', 22, 0)
+const KSU_IOCTL_GET_EVENT_FD: u32 = 0x00004b17; // _IOC(_IOC_NONE, 'K', 23, 0)
 
 #[repr(C)]
 #[derive(Clone, Copy, Default)]
@@ -76,6 +85,30 @@ struct ManageMarkCmd {
     result: u32,
 }
 
+/// Marked task census, see `ksu_mark_stats_cmd` in kernel/supercalls.h
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct MarkStats {
+    pub marked: u32,
+    pub init: u32,
+    pub zygote: u32,
+    pub ksu_domain: u32,
+    pub shell: u32,
+    pub allowed: u32,
+    pub other: u32,
+    pub tracepoint_reg_count: i32,
+    pub slow_path_syscalls: u64,
+    pub hooked_syscalls: u64,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct GetAuditFdCmd {
+    pub fd: i32,
+    pub nr_cpus: u32,
+    pub cpu_size: u32,
+}
+
 #[repr(C)]
 #[derive(Clone, Copy, Default)]
 pub struct NukeExt4SysfsCmd {
@@ -90,6 +123,51 @@ struct AddTryUmountCmd {
     mode: u8,   // denotes what to do with it 0:wipe_list 1:add_to_list 2:delete_entry
 }
 
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+struct BatchEntry {
+    cmd: u32,
+    result: i32,
+    arg: u64,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+struct BatchCmd {
+    entries: u64,
+    count: u32,
+    flags: u32,
+    completed: u32,
+}
+
+const KSU_BATCH_STOP_ON_ERROR: u32 = 1 << 0;
+const KSU_BATCH_MAX: usize = 1024;
+
+/// Record read from the driver fd, see kernel/event_queue.h
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct KsuEvent {
+    pub seq: u64,
+    pub timestamp: u64,
+    pub kind: u32,
+    pub data: u32,
+}
+
+impl KsuEvent {
+    pub const fn name(&self) -> &'static str {
+        match self.kind {
+            EVENT_POST_FS_DATA => "post-fs-data",
+            EVENT_BOOT_COMPLETED => "boot-completed",
+            EVENT_MODULE_MOUNTED => "module-mounted",
+            EVENT_MANAGER_CHANGED => "manager-changed",
+            EVENT_ALLOWLIST_PRUNED => "allowlist-pruned",
+            EVENT_SAFE_MODE => "safe-mode",
+            EVENT_APP_PROFILE_CHANGED => "app-profile-changed",
+            _ => "unknown",
+        }
+    }
+}
+
 // Mark operation constants
 const KSU_MARK_GET: u32 = 1;
 const KSU_MARK_MARK: u32 = 2;
@@ -150,12 +228,17 @@ fn init_driver_fd() -> Option<RawFd> {
     }
 }
 
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn driver_fd() -> RawFd {
+    *DRIVER_FD.get_or_init(|| init_driver_fd().unwrap_or(-1))
+}
+
 // ioctl wrapper using libc
 #[cfg(any(target_os = "linux", target_os = "android"))]
 fn ksuctl<T>(request: u32, arg: *mut T) -> std::io::Result<i32> {
     use std::io;
 
-    let fd = *DRIVER_FD.get_or_init(|| init_driver_fd().unwrap_or(-1));
+    let fd = driver_fd();
     unsafe {
         #[cfg(not(target_env = "gnu"))]
         let ret = libc::ioctl(fd as libc::c_int, request as i32, arg);
@@ -241,12 +324,6 @@ pub fn check_kernel_safemode() -> bool {
     false
 }
 
-pub fn set_sepolicy(cmd: &SetSepolicyCmd) -> std::io::Result<()> {
-    let mut ioctl_cmd = *cmd;
-    ksuctl(KSU_IOCTL_SET_SEPOLICY, &raw mut ioctl_cmd)?;
-    Ok(())
-}
-
 /// Get feature value and support status from kernel
 /// Returns (value, supported)
 pub fn get_feature(feature_id: u32) -> std::io::Result<(u64, bool)> {
@@ -273,6 +350,56 @@ pub fn get_wrapped_fd(fd: RawFd) -> std::io::Result<RawFd> {
     Ok(result)
 }
 
+// The event fd keeps our read cursor, so one is opened per process
+#[cfg(any(target_os = "linux", target_os = "android"))]
+static EVENT_FD: OnceLock<RawFd> = OnceLock::new();
+
+/// Read pending kernel events in order, waiting for the next one when
+/// `block` is set. Returns an empty list if nothing is pending otherwise.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+pub fn read_events(block: bool) -> std::io::Result<Vec<KsuEvent>> {
+    let fd = if let Some(fd) = EVENT_FD.get() {
+        *fd
+    } else {
+        // only the manager and root get one
+        let fd = ksuctl(KSU_IOCTL_GET_EVENT_FD, std::ptr::null_mut::<u8>())?;
+        let cached = *EVENT_FD.get_or_init(|| fd);
+        if cached != fd {
+            unsafe { libc::close(fd) };
+        }
+        cached
+    };
+    if !block {
+        let mut pfd = libc::pollfd {
+            fd,
+            events: libc::POLLIN,
+            revents: 0,
+        };
+        if unsafe { libc::poll(&raw mut pfd, 1, 0) } <= 0 {
+            return Ok(Vec::new());
+        }
+    }
+
+    let mut events = [KsuEvent::default(); 8];
+    let ret = unsafe {
+        libc::read(
+            fd,
+            events.as_mut_ptr().cast(),
+            std::mem::size_of_val(&events),
+        )
+    };
+    if ret < 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    let count = ret as usize / std::mem::size_of::<KsuEvent>();
+    Ok(events[..count].to_vec())
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+pub fn read_events(_block: bool) -> std::io::Result<Vec<KsuEvent>> {
+    Err(std::io::Error::from_raw_os_error(libc::ENOSYS))
+}
+
 /// Get mark status for a process (pid=0 returns total marked count)
 pub fn mark_get(pid: i32) -> std::io::Result<u32> {
     let mut cmd = ManageMarkCmd {
@@ -317,6 +444,20 @@ pub fn mark_refresh() -> std::io::Result<()> {
     Ok(())
 }
 
+/// Count marked tasks by category, with the hook counters
+pub fn mark_stats() -> std::io::Result<MarkStats> {
+    let mut stats = MarkStats::default();
+    ksuctl(KSU_IOCTL_MARK_STATS, &raw mut stats)?;
+    Ok(stats)
+}
+
+/// Get a read-only fd of the su audit rings, the caller owns `cmd.fd`
+pub fn get_audit_fd() -> std::io::Result<GetAuditFdCmd> {
+    let mut cmd = GetAuditFdCmd::default();
+    ksuctl(KSU_IOCTL_GET_AUDIT_FD, &raw mut cmd)?;
+    Ok(cmd)
+}
+
 pub fn nuke_ext4_sysfs(mnt: &str) -> anyhow::Result<()> {
     let c_mnt = std::ffi::CString::new(mnt)?;
     let mut ioctl_cmd = NukeExt4SysfsCmd {
@@ -337,26 +478,217 @@ pub fn umount_list_wipe() -> std::io::Result<()> {
     Ok(())
 }
 
-/// Add mount point to umount list
-pub fn umount_list_add(path: &str, flags: u32) -> anyhow::Result<()> {
-    let c_path = std::ffi::CString::new(path)?;
-    let mut cmd = AddTryUmountCmd {
-        arg: c_path.as_ptr() as u64,
-        flags,
-        mode: KSU_UMOUNT_ADD,
-    };
-    ksuctl(KSU_IOCTL_ADD_TRY_UMOUNT, &raw mut cmd)?;
+/// Add mount points to umount list
+pub fn umount_list_add(paths: &[String], flags: u32) -> anyhow::Result<()> {
+    let mut batch = Batch::new();
+    for path in paths {
+        batch.umount_list_add(path, flags)?;
+    }
+    check_batch(paths, batch.submit())
+}
+
+/// Delete mount points from umount list
+pub fn umount_list_del(paths: &[String]) -> anyhow::Result<()> {
+    let mut batch = Batch::new();
+    for path in paths {
+        batch.umount_list_del(path)?;
+    }
+    check_batch(paths, batch.submit())
+}
+
+// Collapse per-command results into one error naming every failed item.
+fn check_batch(items: &[String], results: Vec<std::io::Result<i32>>) -> anyhow::Result<()> {
+    let failed: Vec<String> = items
+        .iter()
+        .zip(results)
+        .filter_map(|(item, result)| result.err().map(|e| format!("{item}: {e}")))
+        .collect();
+    anyhow::ensure!(failed.is_empty(), "{}", failed.join(", "));
     Ok(())
 }
 
-/// Delete mount point from umount list
-pub fn umount_list_del(path: &str) -> anyhow::Result<()> {
-    let c_path = std::ffi::CString::new(path)?;
-    let mut cmd = AddTryUmountCmd {
-        arg: c_path.as_ptr() as u64,
-        flags: 0,
-        mode: KSU_UMOUNT_DEL,
+/// A command queued in a [`Batch`]. Payloads are boxed so the pointers
+/// handed to the kernel stay valid while the batch grows.
+enum BatchOp {
+    SetFeature(Box<SetFeatureCmd>),
+    Umount(Box<AddTryUmountCmd>, std::ffi::CString),
+    SetSepolicy(Box<SetSepolicyCmd>),
+}
+
+impl BatchOp {
+    const fn request(&self) -> u32 {
+        match self {
+            Self::SetFeature(_) => KSU_IOCTL_SET_FEATURE,
+            Self::Umount(..) => KSU_IOCTL_ADD_TRY_UMOUNT,
+            Self::SetSepolicy(_) => KSU_IOCTL_SET_SEPOLICY,
+        }
+    }
+
+    fn arg(&mut self) -> *mut u8 {
+        match self {
+            Self::SetFeature(cmd) => (&raw mut **cmd).cast(),
+            Self::Umount(cmd, _) => (&raw mut **cmd).cast(),
+            Self::SetSepolicy(cmd) => (&raw mut **cmd).cast(),
+        }
+    }
+}
+
+// cleared once the kernel rejects KSU_IOCTL_BATCH, so older kernels only
+// pay for the probe once
+static BATCH_SUPPORTED: std::sync::atomic::AtomicBool = std::sync::atomic::AtomicBool::new(true);
+
+/// Queue of driver commands submitted together.
+///
+/// Commands run in the order they were added and every one reports its own
+/// result. On kernels without `KSU_IOCTL_BATCH` the queue is replayed as
+/// individual ioctls, so callers do not need to care which path was taken.
+/// The lifetime ties the batch to data referenced by raw pointers in its
+/// commands (e.g. sepolicy rules), which must outlive [`Batch::submit`].
+#[derive(Default)]
+pub struct Batch<'a> {
+    ops: Vec<BatchOp>,
+    stop_on_error: bool,
+    _marker: std::marker::PhantomData<&'a ()>,
+}
+
+impl<'a> Batch<'a> {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Stop at the first failing command, later ones report `ECANCELED`.
+    pub const fn stop_on_error(mut self, stop: bool) -> Self {
+        self.stop_on_error = stop;
+        self
+    }
+
+    pub const fn is_empty(&self) -> bool {
+        self.ops.is_empty()
+    }
+
+    pub fn set_feature(&mut self, feature_id: u32, value: u64) -> &mut Self {
+        self.ops.push(BatchOp::SetFeature(Box::new(SetFeatureCmd {
+            feature_id,
+            value,
+        })));
+        self
+    }
+
+    pub fn umount_list_add(&mut self, path: &str, flags: u32) -> anyhow::Result<&mut Self> {
+        self.push_umount(path, flags, KSU_UMOUNT_ADD)
+    }
+
+    pub fn umount_list_del(&mut self, path: &str) -> anyhow::Result<&mut Self> {
+        self.push_umount(path, 0, KSU_UMOUNT_DEL)
+    }
+
+    fn push_umount(&mut self, path: &str, flags: u32, mode: u8) -> anyhow::Result<&mut Self> {
+        let c_path = std::ffi::CString::new(path)?;
+        let cmd = AddTryUmountCmd {
+            arg: c_path.as_ptr() as u64,
+            flags,
+            mode,
+        };
+        self.ops.push(BatchOp::Umount(Box::new(cmd), c_path));
+        Ok(self)
+    }
+
+    /// Queue a sepolicy rule; `policy` is passed to the kernel by address.
+    pub fn set_sepolicy<T>(&mut self, policy: &'a T) -> &mut Self {
+        let cmd = SetSepolicyCmd {
+            cmd: 0,
+            arg: std::ptr::from_ref(policy) as u64,
+        };
+        self.ops.push(BatchOp::SetSepolicy(Box::new(cmd)));
+        self
+    }
+
+    /// Submit all queued commands, returning one result per command in
+    /// the order they were queued.
+    pub fn submit(mut self) -> Vec<std::io::Result<i32>> {
+        let mut results = Vec::with_capacity(self.ops.len());
+        let stop_on_error = self.stop_on_error;
+        for chunk in self.ops.chunks_mut(KSU_BATCH_MAX) {
+            let failed = if BATCH_SUPPORTED.load(std::sync::atomic::Ordering::Relaxed) {
+                submit_chunk(chunk, stop_on_error, &mut results)
+            } else {
+                submit_each(chunk, stop_on_error, &mut results)
+            };
+            if failed && stop_on_error {
+                break;
+            }
+        }
+        while results.len() < self.ops.len() {
+            results.push(Err(std::io::Error::from_raw_os_error(libc::ECANCELED)));
+        }
+        results
+    }
+}
+
+// Returns true if a command in the chunk failed.
+fn submit_chunk(
+    ops: &mut [BatchOp],
+    stop_on_error: bool,
+    results: &mut Vec<std::io::Result<i32>>,
+) -> bool {
+    let mut entries: Vec<BatchEntry> = ops
+        .iter_mut()
+        .map(|op| BatchEntry {
+            cmd: op.request(),
+            result: 0,
+            arg: op.arg() as u64,
+        })
+        .collect();
+    let mut cmd = BatchCmd {
+        entries: entries.as_mut_ptr() as u64,
+        count: entries.len() as u32,
+        flags: if stop_on_error {
+            KSU_BATCH_STOP_ON_ERROR
+        } else {
+            0
+        },
+        completed: 0,
     };
-    ksuctl(KSU_IOCTL_ADD_TRY_UMOUNT, &raw mut cmd)?;
-    Ok(())
+
+    if let Err(e) = ksuctl(KSU_IOCTL_BATCH, &raw mut cmd) {
+        if e.raw_os_error() == Some(libc::ENOTTY) {
+            log::info!("kernel does not support batched ioctls, fall back");
+            BATCH_SUPPORTED.store(false, std::sync::atomic::Ordering::Relaxed);
+            return submit_each(ops, stop_on_error, results);
+        }
+        // the batch itself failed, report it for every command that did not run
+        let completed = cmd.completed as usize;
+        results.extend(entries[..completed].iter().map(entry_result));
+        results.extend((completed..entries.len()).map(|_| Err(std::io::Error::from(e.kind()))));
+        return true;
+    }
+
+    let completed = cmd.completed as usize;
+    results.extend(entries[..completed].iter().map(entry_result));
+    completed < entries.len() || entries.iter().any(|e| e.result < 0)
+}
+
+fn entry_result(entry: &BatchEntry) -> std::io::Result<i32> {
+    if entry.result < 0 {
+        Err(std::io::Error::from_raw_os_error(-entry.result))
+    } else {
+        Ok(entry.result)
+    }
+}
+
+fn submit_each(
+    ops: &mut [BatchOp],
+    stop_on_error: bool,
+    results: &mut Vec<std::io::Result<i32>>,
+) -> bool {
+    let mut failed = false;
+    for op in ops {
+        let result = ksuctl(op.request(), op.arg());
+        failed |= result.is_err();
+        results.push(result);
+        if failed && stop_on_error {
+            break;
+        }
+    }
+    failed
 }
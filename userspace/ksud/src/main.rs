@@ -12,8 +12,10 @@
 
 mod apk_sign;
 mod assets;
+mod audit;
 mod boot_patch;
 mod cli;
+mod cpio;
 mod debug;
 mod defs;
 mod feature;
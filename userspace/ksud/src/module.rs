@@ -3,7 +3,6 @@ use crate::utils::*;
 use crate::{
     assets, defs, ksucalls, metamodule,
     restorecon::{restore_syscon, setsyscon},
-    sepolicy,
 };
 
 use anyhow::{Context, Result, anyhow, bail, ensure};
@@ -146,21 +145,18 @@ fn foreach_active_module(f: impl FnMut(&Path) -> Result<()>) -> Result<()> {
     foreach_module(Active, f)
 }
 
-pub fn load_sepolicy_rule() -> Result<()> {
+/// `sepolicy.rule` files of all active modules.
+pub fn sepolicy_rule_files() -> Result<Vec<PathBuf>> {
+    let mut files = Vec::new();
     foreach_active_module(|path| {
         let rule_file = path.join("sepolicy.rule");
-        if !rule_file.exists() {
-            return Ok(());
-        }
-        info!("load policy: {}", &rule_file.display());
-
-        if sepolicy::apply_file(&rule_file).is_err() {
-            warn!("Failed to load sepolicy.rule for {}", &rule_file.display());
+        if rule_file.exists() {
+            files.push(rule_file);
         }
         Ok(())
     })?;
 
-    Ok(())
+    Ok(files)
 }
 
 pub fn exec_script<T: AsRef<Path>>(path: T, wait: bool) -> Result<()> {
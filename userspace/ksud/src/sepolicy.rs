@@ -675,8 +675,8 @@ const fn to_c_ptr(pol: &PolicyObject) -> *const ffi::c_char {
     }
 }
 
-impl From<AtomicStatement> for FfiPolicy {
-    fn from(policy: AtomicStatement) -> Self {
+impl From<&AtomicStatement> for FfiPolicy {
+    fn from(policy: &AtomicStatement) -> Self {
         Self {
             cmd: policy.cmd,
             subcmd: policy.subcmd,
@@ -691,17 +691,37 @@ impl From<AtomicStatement> for FfiPolicy {
     }
 }
 
+/// Apply statements to the live policy in one batched submission.
+/// The kernel resets the avc once for the whole batch instead of per rule.
 #[cfg(any(target_os = "linux", target_os = "android"))]
-fn apply_one_rule<'a>(statement: &'a PolicyStatement<'a>, strict: bool) -> Result<()> {
-    let policies: Vec<AtomicStatement> = statement.try_into()?;
-
-    for policy in policies {
-        let ffi_policy = FfiPolicy::from(policy);
-        let cmd = crate::ksucalls::SetSepolicyCmd {
-            cmd: 0,
-            arg: &raw const ffi_policy as u64,
+fn apply_rules(statements: &[PolicyStatement], strict: bool) -> Result<()> {
+    // (statement index, atomic rule); the rules must outlive the batch since
+    // the kernel reads the strings through the FfiPolicy pointers
+    let mut atomics = Vec::new();
+    for (index, statement) in statements.iter().enumerate() {
+        let policies: Vec<AtomicStatement> = match statement.try_into() {
+            Ok(policies) => policies,
+            Err(e) if !strict => {
+                log::warn!("skip rule {statement:?}: {e}");
+                continue;
+            }
+            Err(e) => return Err(e),
         };
-        if let Err(e) = crate::ksucalls::set_sepolicy(&cmd) {
+        atomics.extend(policies.into_iter().map(|policy| (index, policy)));
+    }
+    let ffi_policies: Vec<FfiPolicy> = atomics
+        .iter()
+        .map(|(_, policy)| FfiPolicy::from(policy))
+        .collect();
+
+    let mut batch = crate::ksucalls::Batch::new().stop_on_error(strict);
+    for ffi_policy in &ffi_policies {
+        batch.set_sepolicy(ffi_policy);
+    }
+
+    for ((index, _), result) in atomics.iter().zip(batch.submit()) {
+        if let Err(e) = result {
+            let statement = &statements[*index];
             log::warn!("apply rule {statement:?} failed: {e}");
             if strict {
                 return Err(anyhow::anyhow!("apply rule {:?} failed: {}", statement, e));
@@ -713,17 +733,16 @@ fn apply_one_rule<'a>(statement: &'a PolicyStatement<'a>, strict: bool) -> Resul
 }
 
 #[cfg(not(any(target_os = "linux", target_os = "android")))]
-fn apply_one_rule<'a>(_statement: &'a PolicyStatement<'a>, _strict: bool) -> Result<()> {
+fn apply_rules(_statements: &[PolicyStatement], _strict: bool) -> Result<()> {
     unimplemented!()
 }
 
 pub fn live_patch(policy: &str) -> Result<()> {
     let result = parse_sepolicy(policy.trim(), false)?;
-    for statement in result {
+    for statement in &result {
         println!("{statement:?}");
-        apply_one_rule(&statement, false)?;
     }
-    Ok(())
+    apply_rules(&result, false)
 }
 
 pub fn apply_file<P: AsRef<Path>>(path: P) -> Result<()> {
@@ -731,6 +750,30 @@ pub fn apply_file<P: AsRef<Path>>(path: P) -> Result<()> {
     live_patch(&input)
 }
 
+/// Apply several rule files in one batch, so boot pays for one submission and
+/// one avc reset instead of one per file. Unreadable files are skipped.
+pub fn apply_files<P: AsRef<Path>>(paths: &[P]) -> Result<()> {
+    let inputs: Vec<String> = paths
+        .iter()
+        .filter_map(|path| {
+            let path = path.as_ref();
+            log::info!("load policy: {}", path.display());
+            std::fs::read_to_string(path)
+                .inspect_err(|e| log::warn!("read {} failed: {e}", path.display()))
+                .ok()
+        })
+        .collect();
+
+    let mut statements = Vec::new();
+    for input in &inputs {
+        statements.extend(parse_sepolicy(input.trim(), false)?);
+    }
+    if statements.is_empty() {
+        return Ok(());
+    }
+    apply_rules(&statements, false)
+}
+
 pub fn check_rule(policy: &str) -> Result<()> {
     let path = Path::new(policy);
     let policy = if path.exists() {